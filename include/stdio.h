@@ -6,6 +6,14 @@
 
 #define EOF  (-1)
 
+#define BUFSIZ  (4096)
+
+enum {
+  _IOFBF,  // 0: Fully buffered
+  _IOLBF,  // 1: Line buffered
+  _IONBF,  // 2: Unbuffered
+};
+
 enum {
   SEEK_SET,  // 0
   SEEK_CUR,  // 1
@@ -33,6 +41,8 @@ int fclose(FILE *fp);
 size_t fwrite(const void *buffer, size_t size, size_t count, FILE *fp);
 size_t fread(void *buffer, size_t size, size_t count, FILE *fp);
 int fflush(FILE *fp);
+int setvbuf(FILE *fp, char *buf, int mode, size_t size);
+void setbuf(FILE *fp, char *buf);
 int fseek(FILE *fp, long offset, int origin);
 long ftell(FILE *fp);
 int remove(const char *fn);
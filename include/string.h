@@ -21,3 +21,4 @@ void* memmove(void* dst, const void* src, size_t);
 void* memset(void* buf, int val, size_t size);
 void *memchr(const void *buf, int c, size_t n);
 int memcmp(const void *buf1, const void *buf2, size_t n);
+void *memmem(const void *haystack, size_t hlen, const void *needle, size_t nlen);
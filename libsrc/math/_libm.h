@@ -0,0 +1,46 @@
+#pragma once
+
+#include "stdbool.h"
+#include "stdint.h"  // int64_t
+
+// Internal kernels shared among the libm functions.
+
+// Reduces x to y[0] + y[1] in [-pi/4, pi/4], returns the quadrant.
+int _rem_pio2(double x, double y[2]);
+
+// sin and cos on [-pi/4, pi/4], y is the tail of the reduced argument.
+double _sin_kernel(double x, double y);
+double _cos_kernel(double x, double y);
+// tan on [-pi/4, pi/4], or -1/tan if odd.
+double _tan_kernel(double x, double y, bool odd);
+
+// Natural logarithm of a positive finite x as hi + *lo.
+double _log_dd(double x, double *lo);
+
+// exp(hi + lo) for |lo| much smaller than |hi|.
+double _exp_dd(double hi, double lo);
+
+static inline double _from_bits(int64_t i) {
+  return *(double*)&i;
+}
+
+static inline int64_t _to_bits(double x) {
+  return *(int64_t*)&x;
+}
+
+// Splits x into hi + lo, each with at most 26 significant bits,
+// so that products of the halves are exact.
+static inline double _split(double x, double *lo) {
+  double t = x * 134217729.0;  // 2^27 + 1
+  double hi = t - (t - x);
+  *lo = x - hi;
+  return hi;
+}
+
+// Returns a + b rounded, and its rounding error in *err.
+static inline double _two_sum(double a, double b, double *err) {
+  double s = a + b;
+  double bb = s - a;
+  *err = (a - (s - bb)) + (b - bb);
+  return s;
+}
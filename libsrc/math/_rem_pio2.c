@@ -0,0 +1,158 @@
+#include "math.h"
+#include "stdbool.h"
+#include "stdint.h"
+#include "_ieee.h"
+#include "_libm.h"
+
+#ifndef __NO_FLONUM
+// Argument reduction by pi/2: Cody-Waite with pi/2 split into three
+// parts for moderate arguments, Payne-Hanek with the bits of 2/pi
+// for large ones. Either way the result is accurate to more than
+// 100 bits, so sin and cos keep their accuracy over the whole range.
+
+static const double INV_PIO2 = 6.36619772367581382433e-01;  // 2/pi
+static const double PIO2_1  = 1.57079632673412561417e+00;  // First 33 bits of pi/2
+static const double PIO2_1T = 6.07710050650619224932e-11;  // pi/2 - PIO2_1
+static const double PIO2_2  = 6.07710050630396597660e-11;  // Second 33 bits of pi/2
+static const double PIO2_2T = 2.02226624879595063154e-21;  // pi/2 - (PIO2_1 + PIO2_2)
+static const double PIO2_3  = 2.02226624871116645580e-21;  // Third 33 bits of pi/2
+static const double PIO2_3T = 8.47842766036889956997e-32;  // pi/2 - (PIO2_1 + PIO2_2 + PIO2_3)
+static const double PIO2_HI = 1.5707963267948966;
+static const double PIO2_LO = 6.123233995736766e-17;
+
+// Bits of 2/pi, the most significant bit first.
+static const uint64_t kTwoOverPi[] = {
+  0xA2F9836E4E441529, 0xFC2757D1F534DDC0, 0xDB6295993C439041, 0xFE5163ABDEBBC561,
+  0xB7246E3A424DD2E0, 0x06492EEA09D1921C, 0xFE1DEB1CB129A73E, 0xE88235F52EBB4484,
+  0xE99C7026B45F7E41, 0x3991D639835339F4, 0x9C845F8BBDF9283B, 0x1FF897FFDE05980F,
+  0xEF2F118B5A0A6D1F, 0x6D367ECF27CB09B7, 0x4F463F669E5FEA2D, 0x7527BAC7EBE5F17B,
+  0x3D0739F78A5292EA, 0x6BFB5FB11F8D5D08, 0x56033046FC7B6BAB, 0xF0CFBC209AF4361D,
+};
+
+static uint64_t mul_64x64(uint64_t a, uint64_t b, uint64_t *hi) {
+  uint64_t a0 = a & 0xffffffff, a1 = a >> 32;
+  uint64_t b0 = b & 0xffffffff, b1 = b >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  uint64_t mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+  *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+  return (mid << 32) | (p00 & 0xffffffff);
+}
+
+// Returns 64 bits of 2/pi from the bit of weight 2^-pos.
+static uint64_t two_over_pi_bits(int pos) {
+  if (pos <= -63)
+    return 0;
+  if (pos < 1)
+    return kTwoOverPi[0] >> (1 - pos);
+  int q = (pos - 1) / 64, r = (pos - 1) % 64;
+  uint64_t w = kTwoOverPi[q] << r;
+  if (r > 0)
+    w |= kTwoOverPi[q + 1] >> (64 - r);
+  return w;
+}
+
+static int rem_pio2_large(double x, double y[2]) {
+  int64_t hex = _to_bits(x);
+  uint64_t m = (hex & FRAC_MASK) | ((int64_t)1 << FRAC_BIT);
+  int e = GET_BIASED_EXPO(hex) - (EXPO_BIAS + 1) - FRAC_BIT;  // |x| = m * 2^e
+
+  // x * 2/pi modulo 4: bits of 2/pi above 2^(e-2) only add multiples of 4,
+  // so multiply m by the 192 bits below them, which puts the binary point
+  // at bit 190 of the product, and keep the low 192 bits.
+  uint64_t w0 = two_over_pi_bits(e - 1);
+  uint64_t w1 = two_over_pi_bits(e + 63);
+  uint64_t w2 = two_over_pi_bits(e + 127);
+  uint64_t hi, r0, r1, r2;
+  r0 = mul_64x64(m, w2, &r1);
+  uint64_t lo = mul_64x64(m, w1, &hi);
+  r1 += lo;
+  r2 = hi + (r1 < lo) + m * w0;
+
+  // Integer part is the quadrant, round the fraction to nearest.
+  int n = r2 >> 62;
+  r2 = (r2 << 2) | (r1 >> 62);
+  r1 = (r1 << 2) | (r0 >> 62);
+  r0 <<= 2;
+  bool neg = false;
+  if (r2 >> 63) {
+    ++n;
+    neg = true;
+    r0 = ~r0;
+    r1 = ~r1;
+    r2 = ~r2;
+    if (++r0 == 0 && ++r1 == 0)
+      ++r2;
+  }
+
+  int shift = 0;
+  while (r2 == 0) {
+    r2 = r1;
+    r1 = r0;
+    r0 = 0;
+    shift += 64;
+  }
+  int lz = 0;
+  while (!(r2 >> (63 - lz)))
+    ++lz;
+  if (lz > 0) {
+    r2 = (r2 << lz) | (r1 >> (64 - lz));
+    r1 = (r1 << lz) | (r0 >> (64 - lz));
+  }
+  shift += lz;
+
+  // Fraction is (fa + fb) * 2^-shift with 106 bits, multiply it by pi/2.
+  double fa = (double)(int64_t)(r2 >> 11) * (1.0 / ((int64_t)1 << 53));
+  double fb = (double)(int64_t)(((r2 & 0x7ff) << 42) | (r1 >> 22)) *
+              (1.0 / ((int64_t)1 << 53) / ((int64_t)1 << 53));
+  double a2, p2;
+  double a1 = _split(fa, &a2);
+  double p1 = _split(PIO2_HI, &p2);
+  double h = fa * PIO2_HI;
+  double l = (((a1 * p1 - h) + a1 * p2 + a2 * p1) + a2 * p2) + (fa * PIO2_LO + fb * PIO2_HI);
+  double scale = _from_bits((int64_t)(EXPO_BIAS + 1 - shift) << EXPO_POS);
+  double z = h + l;
+  y[0] = z * scale;
+  y[1] = (l - (z - h)) * scale;
+  if (neg) {
+    y[0] = -y[0];
+    y[1] = -y[1];
+  }
+
+  if (x < 0) {
+    y[0] = -y[0];
+    y[1] = -y[1];
+    return -n;
+  }
+  return n;
+}
+
+int _rem_pio2(double x, double y[2]) {
+  int64_t hex = _to_bits(x);
+  int ex = GET_BIASED_EXPO(hex);
+  if (ex >= EXPO_BIAS + 1 + 20)  // |x| >= 2^20
+    return rem_pio2_large(x, y);
+
+  int n = (int)(x * INV_PIO2 + (x < 0 ? -0.5 : 0.5));
+  double fn = n;
+  double r = x - fn * PIO2_1;  // Exact, fn has at most 20 bits.
+  double w = fn * PIO2_1T;
+  y[0] = r - w;
+  // Take more bits of pi/2 when x is close to a multiple of it.
+  if (ex - GET_BIASED_EXPO(_to_bits(y[0])) > 16) {
+    double t = r;
+    w = fn * PIO2_2;
+    r = t - w;
+    w = fn * PIO2_2T - ((t - r) - w);
+    y[0] = r - w;
+    if (ex - GET_BIASED_EXPO(_to_bits(y[0])) > 49) {
+      t = r;
+      w = fn * PIO2_3;
+      r = t - w;
+      w = fn * PIO2_3T - ((t - r) - w);
+      y[0] = r - w;
+    }
+  }
+  y[1] = (r - y[0]) - w;
+  return n;
+}
+#endif
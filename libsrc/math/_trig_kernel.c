@@ -0,0 +1,95 @@
+#include "math.h"
+#include "_libm.h"
+
+#ifndef __NO_FLONUM
+// Minimax polynomials for sin, cos and tan on [-pi/4, pi/4], from fdlibm.
+// Errors are below 2^-58 relative to the results.
+
+double _sin_kernel(double x, double y) {
+  static const double S1 = -1.66666666666666324348e-01;
+  static const double S2 =  8.33333333332248946124e-03;
+  static const double S3 = -1.98412698298579493134e-04;
+  static const double S4 =  2.75573137070700676789e-06;
+  static const double S5 = -2.50507602534068634195e-08;
+  static const double S6 =  1.58969099521155010221e-10;
+
+  double z = x * x;
+  double w = z * z;
+  double r = S2 + z * (S3 + z * S4) + z * w * (S5 + z * S6);
+  double v = z * x;
+  // sin(x + y) ~= sin(x) + y * cos(x), where cos(x) ~= 1 - x^2 / 2.
+  return x - ((z * (0.5 * y - v * r) - y) - v * S1);
+}
+
+double _cos_kernel(double x, double y) {
+  static const double C1 =  4.16666666666666019037e-02;
+  static const double C2 = -1.38888888888741095749e-03;
+  static const double C3 =  2.48015872894767294178e-05;
+  static const double C4 = -2.75573143513906633035e-07;
+  static const double C5 =  2.08757232129817482790e-09;
+  static const double C6 = -1.13596475577881948265e-11;
+
+  double z = x * x;
+  double w = z * z;
+  double r = z * (C1 + z * (C2 + z * C3)) + w * w * (C4 + z * (C5 + z * C6));
+  double hz = 0.5 * z;
+  w = 1.0 - hz;
+  // Recover the rounding error of 1 - hz, and cos(x + y) ~= cos(x) - y * x.
+  return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+double _tan_kernel(double x, double y, bool odd) {
+  static const double T[] = {
+     3.33333333333334091986e-01,
+     1.33333333333201242699e-01,
+     5.39682539762260521377e-02,
+     2.18694882948595424599e-02,
+     8.86323982359930005737e-03,
+     3.59207910759131235356e-03,
+     1.45620945432529025516e-03,
+     5.88041240820264096874e-04,
+     2.46463134818469906812e-04,
+     7.81794442939557092300e-05,
+     7.14072491382608190305e-05,
+    -1.85586374855275456654e-05,
+     2.59073051863633712884e-05,
+  };
+  static const double PIO4 = 7.85398163397448278999e-01;
+  static const double PIO4LO = 3.06161699786838301793e-17;
+
+  // Near pi/4, use tan(pi/4 - x) = (1 - tan(x)) / (1 + tan(x)) instead.
+  bool big = fabs(x) >= 0.6743354797363281;
+  bool neg = x < 0;
+  if (big) {
+    if (neg) {
+      x = -x;
+      y = -y;
+    }
+    x = (PIO4 - x) + (PIO4LO - y);
+    y = 0.0;
+  }
+  double z = x * x;
+  double w = z * z;
+  // Odd and even terms separately, to shorten the dependency chain.
+  double r = T[1] + w * (T[3] + w * (T[5] + w * (T[7] + w * (T[9] + w * T[11]))));
+  double v = z * (T[2] + w * (T[4] + w * (T[6] + w * (T[8] + w * (T[10] + w * T[12])))));
+  double s = z * x;
+  r = y + z * (s * (r + v) + y) + s * T[0];
+  w = x + r;
+  if (big) {
+    s = odd ? -1 : 1;
+    v = s - 2.0 * (x + (r - w * w / (w + s)));
+    return neg ? -v : v;
+  }
+  if (!odd)
+    return w;
+
+  // -1 / (x + r), computed with the upper halves split off to keep
+  // the error within 1ulp.
+  double w0 = _from_bits(_to_bits(w) & ~(int64_t)0xffffffff);
+  v = r - (w0 - x);  // w0 + v = x + r
+  double a = -1.0 / w;
+  double a0 = _from_bits(_to_bits(a) & ~(int64_t)0xffffffff);
+  return a0 + a * (1.0 + a0 * w0 + a0 * v);
+}
+#endif
@@ -1,31 +1,18 @@
 #include "math.h"
+#include "_libm.h"
 
 #ifndef __NO_FLONUM
-extern double normalize_radian(double x);
-
 double cos(double x) {
-  static const double TABLE[] = {
-     1 / 1.0,
-    -1 / (2.0 * 1),
-     1 / (4.0 * 3 * 2 * 1),
-    -1 / (6.0 * 5 * 4 * 3 * 2 * 1),
-     1 / (8.0 * 7 * 6 * 5 * 4 * 3 * 2 * 1),
-    -1 / (10.0 * 9 * 8 * 7 * 6 * 5 * 4 * 3 * 2 * 1),
-     1 / (12.0 * 11 * 10 * 9 * 8 * 7 * 6 * 5 * 4 * 3 * 2 * 1),
-    -1 / (14.0 * 13 * 12 * 11 * 10 * 9 * 8 * 7 * 6 * 5 * 4 * 3 * 2 * 1),
-     1 / (16.0 * 15 * 14 * 13 * 12 * 11 * 10 * 9 * 8 * 7 * 6 * 5 * 4 * 3 * 2 * 1),
-    -1 / (18.0 * 17 * 16 * 15 * 14 * 13 * 12 * 11 * 10 * 9 * 8 * 7 * 6 * 5 * 4 * 3 * 2 * 1),
-  };
-
-  x = normalize_radian(x);
+  if (!isfinite(x))
+    return x - x;  // NAN
 
-  double v = 0;
-  double xx = x * x;
-  x = 1;
-  for (int i = 0; i < (int)(sizeof(TABLE) / sizeof(*TABLE)); ++i) {
-     v += x * TABLE[i];
-    x *= xx;
+  double y[2];
+  switch (_rem_pio2(x, y) & 3) {
+  default:
+  case 0:  return  _cos_kernel(y[0], y[1]);
+  case 1:  return -_sin_kernel(y[0], y[1]);
+  case 2:  return -_cos_kernel(y[0], y[1]);
+  case 3:  return  _sin_kernel(y[0], y[1]);
   }
-  return v;
 }
 #endif
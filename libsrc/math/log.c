@@ -1,7 +1,158 @@
 #include "math.h"
+#include "stdint.h"
+#include "_ieee.h"
+#include "_libm.h"
 
 #ifndef __NO_FLONUM
-#define LOG2  0.693147180559945
+// log(x) = k * ln2 - log(c) + log(1 + z), where x = 2^k * m,
+// sqrt(2)/2 <= m < sqrt(2), c ~= 1/m comes from a table and z = m * c - 1
+// is computed exactly. |z| < 2^-7.4, so a short series for log(1 + z)
+// is enough, and the result is kept in double-double for pow.
+
+#define LOG_TABLE_BITS  (7)
+#define LOG_N           (1 << LOG_TABLE_BITS)
+#define LOG_TABLE_MIN   (-37)  // round((sqrt(2)/2 - 1) * N)
+
+static const double LN2_HI = 0.6931471806019545;       // ln2, upper 32 bits
+static const double LN2_LO = -4.2009150726810846e-11;  // ln2 - LN2_HI
+static const double SQRT2 = 1.4142135623730951;
+
+// {c, hi, lo}: c = 1 / (1 + i/N) rounded to 26 bits, log(c) = hi + lo.
+static const double kLogTable[][3] = {
+  {1.4065934121608734, 0.3411707613608881, -2.720015073814038e-17},
+  {1.3913043439388275, 0.33024168407660914, -1.4731449465701818e-17},
+  {1.376344084739685, 0.31943076983503865, 9.205759880013447e-19},
+  {1.3617021143436432, 0.3087354718707262, -8.501350972208366e-18},
+  {1.3473684191703796, 0.2981533709220925, -1.8182740630604382e-17},
+  {1.3333333432674408, 0.2876820799023615, -1.6839693133398402e-18},
+  {1.319587618112564, 0.27731927726716177, 1.4862175462667928e-17},
+  {1.3061224520206451, 0.2670627875773517, -1.0039420754326672e-17},
+  {1.2929292917251587, 0.25691041285370464, 2.4594752092261575e-17},
+  {1.280000001192093, 0.24686007886284836, 1.3183752848758742e-17},
+  {1.2673267424106598, 0.23690975476176893, 2.0641191874710716e-19},
+  {1.2549019753932953, 0.2270574622768782, -2.700068260440446e-18},
+  {1.2427184581756592, 0.21730128500320708, 1.3759909846478471e-17},
+  {1.2307692170143127, 0.20763935360237354, 5.114348847489803e-18},
+  {1.2190476059913635, 0.19806990305188413, 1.899699379718398e-18},
+  {1.2075471580028534, 0.18859116002866294, 2.656708937428109e-19},
+  {1.1962616741657257, 0.1792014227056223, -5.8247926183480606e-18},
+  {1.185185194015503, 0.16989904424597804, -4.868007385804725e-19},
+  {1.1743119359016418, 0.16068238960671533, -7.228050556887927e-18},
+  {1.1636363565921783, 0.1515498920736042, -1.3156057420490235e-17},
+  {1.1531531512737274, 0.14250006097746853, -1.1254535896963582e-17},
+  {1.1428571343421936, 0.133531385173942, -3.6644578015235204e-18},
+  {1.1327433586120605, 0.12464244148198629, 1.129981207733328e-18},
+  {1.1228070259094238, 0.11583182297570227, 4.33848450767153e-18},
+  {1.113043487071991, 0.10709814347260896, -5.3149180439991505e-18},
+  {1.1034482717514038, 0.09844006908796221, 2.4998842529991633e-18},
+  {1.0940170884132385, 0.08985632399958687, 1.3156545957200862e-19},
+  {1.0847457647323608, 0.08134564131659755, 3.342352882108479e-18},
+  {1.075630247592926, 0.07290676661713619, -1.2111100713876367e-18},
+  {1.0666666626930237, 0.06453851741228087, 4.684072249813657e-19},
+  {1.0578512251377106, 0.05623970458586801, -4.9169525049287e-19},
+  {1.0491803288459778, 0.04800922011768318, 1.0054094660042832e-18},
+  {1.0406503975391388, 0.03984589993246582, 1.396996176701524e-18},
+  {1.0322580635547638, 0.031748697383257724, 2.6045454392046194e-18},
+  {1.0239999890327454, 0.023716515907106377, 4.8878500343751566e-20},
+  {1.0158730149269104, 0.015748356036816593, 5.68476993789431e-19},
+  {1.0078740119934082, 0.007843173735735587, 2.764707981795609e-19},
+  {1.0, 0.0, 0.0},
+  {0.9922480583190918, -0.007782144167345254, 1.2819161890414368e-20},
+  {0.9846153855323792, -0.01550418560464268, -1.0584876643569432e-19},
+  {0.9770992398262024, -0.02316705602190537, -6.661891884743107e-19},
+  {0.969696968793869, -0.030771659598076262, -1.476854072164063e-18},
+  {0.9624060094356537, -0.03831887012290271, -7.048750456586731e-19},
+  {0.955223873257637, -0.04580954371470548, 3.2741053559477893e-18},
+  {0.9481481462717056, -0.053244516497872756, -2.9276435966206187e-19},
+  {0.9411764740943909, -0.06062461809114455, -2.642402576639764e-18},
+  {0.9343065619468689, -0.06795066982474966, -2.297653210503067e-18},
+  {0.9275362342596054, -0.07522341867645045, 2.6508926301244507e-18},
+  {0.9208633154630661, -0.08244366257540127, 3.905757417549624e-20},
+  {0.9142857193946838, -0.0896121531017517, 3.692089515849043e-18},
+  {0.9078014194965363, -0.0967296252943979, -1.1788660864853648e-19},
+  {0.9014084488153458, -0.10379679577711937, 6.204554248197629e-18},
+  {0.8951049000024796, -0.11081436086877, -2.2747267242879177e-18},
+  {0.8888888955116272, -0.11778302820580289, 1.1971687126228024e-18},
+  {0.882758617401123, -0.12470348222624754, -2.286632957490495e-18},
+  {0.8767123222351074, -0.1315763652392999, -1.1123001017593023e-17},
+  {0.870748296380043, -0.13840232623516346, -1.0146614983310811e-17},
+  {0.8648648709058762, -0.1451820028595786, -4.881391934721441e-18},
+  {0.8590604066848755, -0.15191603736922912, 1.0429690800029715e-17},
+  {0.8533333390951157, -0.15860502342454993, -6.29677883045059e-18},
+  {0.8476821184158325, -0.16524957382662975, 9.66125475305916e-18},
+  {0.8421052694320679, -0.17185024947607866, 6.0224539588748054e-18},
+  {0.8366013020277023, -0.17840766364283037, -6.601970680293003e-18},
+  {0.8311688303947449, -0.18492233942533456, -3.457342284620873e-18},
+  {0.8258064538240433, -0.19139485032207706, 8.5448534794114e-18},
+  {0.8205128163099289, -0.19782574845219406, 1.8155349107752833e-18},
+  {0.8152866214513779, -0.20421554480473522, -8.432665783825563e-18},
+  {0.8101265877485275, -0.210564762355261, 9.209630356461898e-18},
+  {0.8050314486026764, -0.21687393573947727, -7.830737759403073e-18},
+  {0.7999999970197678, -0.22314355503950006, 2.1523766761846407e-18},
+  {0.7950310558080673, -0.22937410118126114, -9.934448087556585e-18},
+  {0.790123462677002, -0.23556606386218634, 2.39433728738217e-18},
+  {0.7852760702371597, -0.2417199411945121, 9.577880728494393e-18},
+  {0.7804878056049347, -0.2478361629732587, 1.1998528709977586e-17},
+  {0.7757575809955597, -0.2539152032288748, -1.474725317947271e-17},
+  {0.77108433842659, -0.2599575230399422, -2.1673851344117536e-17},
+  {0.7664670646190643, -0.26596355012695244, -6.667527938869264e-18},
+  {0.7619047611951828, -0.27193371641496433, -1.2170005069609083e-18},
+  {0.7573964446783066, -0.27786845763912965, -2.1100062167518857e-17},
+  {0.7529411762952805, -0.28376817336347526, 2.0299550756950217e-17},
+  {0.7485380172729492, -0.2896332851324621, 7.219622533634173e-18},
+  {0.7441860437393188, -0.2954642166191262, 1.4707214682919743e-17},
+  {0.7398843914270401, -0.3012613327900529, 6.602279988770945e-18},
+  {0.7356321811676025, -0.3070250390202022, 5.381022278961806e-18},
+  {0.7314285784959793, -0.31275570034142525, 2.3347555273875277e-17},
+  {0.7272727340459824, -0.3184537218053089, -1.4971714766224065e-17},
+  {0.7231638431549072, -0.32411946679156683, 6.223490908071121e-18},
+  {0.7191011309623718, -0.3297532761279197, 9.137458251535428e-19},
+  {0.7150837928056717, -0.33535555041945636, 1.0547980487308961e-18},
+  {0.7111111134290695, -0.3409265837109642, -2.2779727077179e-17},
+  {0.7071823179721832, -0.3464667708386682, -1.638447308939311e-17},
+};
+
+double _log_dd(double x, double *lo) {
+  int64_t hex = _to_bits(x);
+  int k = 0;
+  if (GET_BIASED_EXPO(hex) == 0) {  // Subnormal.
+    x *= 18014398509481984.0;  // 2^54
+    hex = _to_bits(x);
+    k = -54;
+  }
+  k += GET_BIASED_EXPO(hex) - 1023;
+  double m = _from_bits((hex & FRAC_MASK) | ((int64_t)1023 << EXPO_POS));
+  if (m >= SQRT2) {
+    m *= 0.5;
+    ++k;
+  }
+
+  int i = (int)((m - 1) * LOG_N + 64.5) - 64;
+  const double *t = kLogTable[i - LOG_TABLE_MIN];
+  double c = t[0];
+  // Both products are exact: each half of m and c has at most 27 bits.
+  double mhi = _from_bits(_to_bits(m) & ~(((int64_t)1 << 27) - 1));
+  double zl;
+  double zh = _two_sum(mhi * c - 1, (m - mhi) * c, &zl);
+
+  // log(1 + z) = z - z^2/2 + z^3 * P(z), with z^2 split into two doubles.
+  double a2;
+  double a1 = _split(zh, &a2);
+  double sqh = zh * zh;
+  double sql = ((a1 * a1 - sqh) + 2 * a1 * a2) + a2 * a2;
+  double p = zh * sqh * (0.3333333333333333 - zh * (0.25 - zh * (0.2 - zh * (0.16666666666666666 -
+             zh * (0.14285714285714285 - zh * (0.125 - zh * (0.1111111111111111 -
+             zh * (0.1 - zh * 0.09090909090909091))))))));
+
+  double e1, e2, e3;
+  double s = _two_sum(k * LN2_HI, -t[1], &e1);
+  s = _two_sum(s, zh, &e2);
+  s = _two_sum(s, -0.5 * sqh, &e3);
+  double l = (e1 + e2 + e3) + (k * LN2_LO - t[2]) + (zl - 0.5 * sql + zl * (sqh - zh)) + p;
+  double hi = s + l;
+  *lo = l - (hi - s);
+  return hi;
+}
 
 double log(double x) {
   if (x <= 0)
@@ -9,17 +160,7 @@ double log(double x) {
   if (!isfinite(x))
     return x;
 
-  int n;
-  x = frexp(x, &n);
-  // 0.5 <= x < 1.0
-
-  double y = (x - 1) / (x + 1);
-  double yy = y * y;
-  double total = 0;
-  for (int i = 1; i <= 15; ++i) {
-    total += y / (i * 2 - 1);
-    y *= yy;
-  }
-  return 2 * total + n * LOG2;
+  double lo;
+  return _log_dd(x, &lo);
 }
 #endif
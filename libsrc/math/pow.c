@@ -1,25 +1,60 @@
 #include "math.h"
 #include "stdbool.h"
+#include "stdint.h"
+#include "_libm.h"
 
 #ifndef __NO_FLONUM
-double pow(double base, double x) {
-  bool neg = x < 0;
-  x = fabs(x);
-  unsigned int n = x;  // TODO: Care about overflow
-  double r = (x - n) * log(base);
+static bool is_odd_integer(double y) {
+  if (fabs(y) >= 9007199254740992.0)  // 2^53: All even.
+    return false;
+  int64_t i = (int64_t)y;
+  return (double)i == y && (i & 1) != 0;
+}
+
+// pow(x, y) = exp(y * log(x)), with log(x) and the product kept in
+// double-double so that the error is not magnified by large |y * log(x)|.
+double pow(double x, double y) {
+  if (y == 0 || x == 1)
+    return 1;
+  if (isnan(x) || isnan(y))
+    return x + y;
+
+  if (isinf(y)) {
+    double ax = fabs(x);
+    if (ax == 1)
+      return 1;
+    return (ax < 1) == (y < 0) ? HUGE_VAL : 0;
+  }
+
+  bool neg = false;
+  if (_to_bits(x) < 0) {  // Including -0.0
+    if (is_odd_integer(y))
+      neg = true;
+    else if (floor(y) != y && x != 0 && !isinf(x))
+      return NAN;
+    x = -x;
+    if (x == 1)
+      return neg ? -1 : 1;
+  }
 
-  double result = 1;
-  double y = 1;
-  for (int i = 1; i <= 15; ++i) {
-    y *= r / i;
-    result += y;
+  if (x == 0 || isinf(x)) {
+    double r = (x == 0) == (y < 0) ? HUGE_VAL : 0;
+    return neg ? -r : r;
   }
 
-  double poe = base;
-  for (; n > 0; n >>= 1, poe *= poe) {
-    if (n & 1)
-      result *= poe;
+  double ll;
+  double lh = _log_dd(x, &ll);
+  double ph = y * lh;
+  if (!(fabs(ph) < 1000)) {  // Overflow or underflow.
+    double r = ph > 0 ? HUGE_VAL : 0;
+    return neg ? -r : r;
   }
-  return neg ? 1.0 / result : result;
+  double y2, l2;
+  double y1 = _split(y, &y2);
+  double l1 = _split(lh, &l2);
+  double pl = (((y1 * l1 - ph) + y1 * l2 + y2 * l1) + y2 * l2) + y * ll;
+  double z = ph + pl;
+  double r = _exp_dd(z, pl - (z - ph));
+  return neg ? -r : r;
 }
 #endif
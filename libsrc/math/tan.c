@@ -1,7 +1,15 @@
 #include "math.h"
+#include "_libm.h"
 
 #ifndef __NO_FLONUM
 double tan(double x) {
-  return sin(x) / cos(x);  // TODO;
+  if (!isfinite(x))
+    return x - x;  // NAN
+  if (x == 0)
+    return x;  // Keep the sign.
+
+  double y[2];
+  int n = _rem_pio2(x, y);
+  return _tan_kernel(y[0], y[1], (n & 1) != 0);
 }
 #endif
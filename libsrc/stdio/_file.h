@@ -5,30 +5,32 @@
 #define FF_BINARY   (1 << 0)
 #define FF_MEMORY   (1 << 1)
 #define FF_GROWMEM  (1 << 2)
+#define FF_LINEBUF  (1 << 3)  // Flush at newline.
+#define FF_TTYCHECK (1 << 4)  // Set FF_LINEBUF at the first write if the stream is a tty.
+#define FF_USERBUF  (1 << 5)  // Buffer is given by setvbuf.
 
 struct FILE {
   int (*fputc)(int c, FILE *fp);
-  unsigned char *wbuf;
-  // TODO: fflush.
+  unsigned char *wbuf;  // Write buffer, or the memory for memory stream.
+  unsigned char *rbuf;
 
   int fd;
-  unsigned int rp, rs;
+  unsigned int rp, rs, rcap;
   unsigned int wp, ws;
+  unsigned int bufsiz;  // Size of the buffers allocated on first use.
   unsigned int flag;
 
-  // TODO: allocate buffers only if required.
-  union {
-    struct {
-      unsigned char rbuf[256];
-      unsigned char wwork[32];
-    };  // For file.
-    struct {
-      char **pmem;
-      size_t *psize;
-    };  // For memory.
-  };
+  unsigned char sbuf[1];  // For unbuffered stream.
+
+  // For memory.
+  char **pmem;
+  size_t *psize;
 };
 
 extern int _fputc(int c, FILE* fp);
+extern void _fsetup_write(FILE *fp);
+extern void _fsetup_read(FILE *fp);
+extern void _ffree_buffers(FILE *fp);
+extern int _ffill(FILE *fp);
 
 #define FPUTC(c, fp)  ((fp->fputc)(c, fp))
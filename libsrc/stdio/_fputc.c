@@ -1,17 +1,53 @@
 #include "stdio.h"
+#include "stdlib.h"  // malloc, free
+#include "unistd.h"  // isatty
 
 #include "./_file.h"
 
+static unsigned char *alloc_buffer(FILE *fp, unsigned int *psize) {
+  unsigned char *buf = fp->bufsiz > 1 ? malloc(fp->bufsiz) : NULL;
+  if (buf == NULL) {
+    *psize = sizeof(fp->sbuf);
+    return fp->sbuf;
+  }
+  *psize = fp->bufsiz;
+  return buf;
+}
+
+void _fsetup_write(FILE *fp) {
+  if (fp->flag & FF_TTYCHECK) {
+    fp->flag &= ~FF_TTYCHECK;
+#if !defined(__WASM)
+    if (isatty(fp->fd))
+      fp->flag |= FF_LINEBUF;
+#endif
+  }
+  fp->wbuf = alloc_buffer(fp, &fp->ws);
+}
+
+void _fsetup_read(FILE *fp) {
+  fp->rbuf = alloc_buffer(fp, &fp->rcap);
+}
+
+void _ffree_buffers(FILE *fp) {
+  if (!(fp->flag & (FF_MEMORY | FF_USERBUF))) {
+    if (fp->wbuf != fp->sbuf)
+      free(fp->wbuf);
+    if (fp->rbuf != fp->sbuf)
+      free(fp->rbuf);
+  }
+  fp->wbuf = fp->rbuf = NULL;
+  fp->wp = fp->ws = fp->rp = fp->rs = fp->rcap = 0;
+}
+
 int _fputc(int c, FILE* fp) {
-  if (fp->wp < fp->ws) {
-    fp->wbuf[fp->wp++] = c;
-    if (fp->wp >= fp->ws ||
-        (c == '\n' && !(fp->flag & FF_BINARY))) {
-      if (fflush(fp) == EOF)
-        return EOF;
-    }
-  } else {
-    // TODO: ?
+  if (fp->wbuf == NULL)
+    _fsetup_write(fp);
+  fp->wbuf[fp->wp++] = c;
+  if (fp->wp >= fp->ws ||
+      (c == '\n' && (fp->flag & FF_LINEBUF))) {
+    if (fflush(fp) == EOF)
+      return EOF;
   }
   return c;
 }
@@ -29,6 +29,7 @@ int fclose(FILE *fp) {
   fflush(fp);
   if (!(fp->flag & FF_MEMORY))
     close(fp->fd);
+  _ffree_buffers(fp);
   free(fp);
   return 0;
 }
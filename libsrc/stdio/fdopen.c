@@ -1,5 +1,5 @@
 #include "stdio.h"
-#include "stdlib.h"  // malloc, realloc
+#include "stdlib.h"  // calloc, realloc
 #include "string.h"
 
 #include "_file.h"
@@ -27,16 +27,13 @@ static void add_opened(FILE *fp) {
 FILE *fdopen(int fd, const char *mode) {
   // TODO: Validate fd.
 
-  FILE *fp = malloc(sizeof(*fp));
+  FILE *fp = calloc(1, sizeof(*fp));
   if (fp != NULL) {
     fp->fputc = _fputc;
     fp->fd = fd;
-    fp->rp = fp->rs = 0;
-    fp->wp = 0;
-    fp->wbuf = fp->wwork;
-    fp->ws = sizeof(fp->wwork);;
+    fp->bufsiz = BUFSIZ;  // Buffers are allocated on first use.
 
-    int flag = 0;
+    int flag = FF_TTYCHECK;  // Line buffered only for tty, otherwise fully buffered.
     if (strchr(mode, 'b') != NULL)
       flag |= FF_BINARY;
     fp->flag = flag;
@@ -3,7 +3,7 @@
 #include "./_file.h"
 
 int fgetc(FILE *fp) {
-  unsigned char c;
-  size_t count = fread(&c, 1, 1, fp);
-  return count == 1 ? c : EOF;
+  if (fp->rp >= fp->rs && _ffill(fp) <= 0)
+    return EOF;
+  return fp->rbuf[fp->rp++];
 }
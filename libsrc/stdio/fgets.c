@@ -1,14 +1,26 @@
 #include "stdio.h"
+#include "string.h"  // memchr, memcpy
+
+#include "./_file.h"
 
 char *fgets(char *s, int n, FILE *fp) {
   --n;
   char *p = s;
-  for (int i = 0; i < n; ++i) {
-    int c = fgetc(fp);
-    if (c == EOF)
+  while (n > 0) {
+    if (fp->rp >= fp->rs && _ffill(fp) <= 0)
       break;
-    *p++ = c;
-    if (c == '\n')
+
+    const unsigned char *start = &fp->rbuf[fp->rp];
+    size_t avail = fp->rs - fp->rp;
+    if (avail > (size_t)n)
+      avail = n;
+    const unsigned char *nl = memchr(start, '\n', avail);
+    size_t len = nl != NULL ? (size_t)(nl - start) + 1 : avail;
+    memcpy(p, start, len);
+    p += len;
+    n -= len;
+    fp->rp += len;
+    if (nl != NULL)
       break;
   }
   if (p == s)
@@ -2,5 +2,6 @@
 #include "string.h"
 
 int fputs(const char *s, FILE *fp) {
-  return fwrite(s, strlen(s), 1, fp) == 1 ? 1 : EOF;
+  size_t len = strlen(s);
+  return fwrite(s, 1, len, fp) == len ? 1 : EOF;
 }
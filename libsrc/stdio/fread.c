@@ -4,6 +4,21 @@
 
 #include "./_file.h"
 
+// Refill the read buffer, returns 0 at end of file or on error.
+int _ffill(FILE *fp) {
+  if (fp->flag & FF_MEMORY)
+    return 0;
+  if (fp == stdin && (stdout->flag & FF_LINEBUF))
+    fflush(stdout);  // Show prompt before waiting for input.
+  if (fp->rbuf == NULL)
+    _fsetup_read(fp);
+
+  ssize_t len = read(fp->fd, fp->rbuf, fp->rcap);
+  fp->rp = 0;
+  fp->rs = len > 0 ? len : 0;
+  return fp->rs;
+}
+
 size_t fread(void *buffer, size_t size, size_t count, FILE *fp) {
   // TODO
   if (fp->flag & FF_MEMORY)
@@ -11,35 +26,42 @@ size_t fread(void *buffer, size_t size, size_t count, FILE *fp) {
 
   unsigned char *p = buffer;
   size_t total = size * count;
-  if (fp->rs > 0) {
-    size_t d = fp->rs - fp->rp;
+  if (total == 0)
+    return 0;
+
+  size_t d = fp->rs - fp->rp;
+  if (d > 0) {
     if (total <= d) {
       memcpy(p, &fp->rbuf[fp->rp], total);
       fp->rp += total;
-      if (fp->rp >= fp->rs)
-        fp->rp = fp->rs = 0;
-      return total / size;
+      return count;
     }
     memcpy(p, &fp->rbuf[fp->rp], d);
     total -= d;
     p += d;
   }
+  fp->rp = fp->rs = 0;
 
-  if (total < sizeof(fp->rbuf) * 3 / 4) {
+  if (fp->rbuf == NULL)
+    _fsetup_read(fp);
+  if (total < fp->rcap) {
     // Read more than requested size and store them to the buffer.
-    ssize_t len = read(fp->fd, fp->rbuf, sizeof(fp->rbuf));
-    fp->rs = len;
-    size_t n = len < 0 || (size_t)len < total ? (size_t)len : total;
-    fp->rp = n;
-    if (n > 0) {
+    while (total > 0 && _ffill(fp) > 0) {
+      size_t n = fp->rs < total ? fp->rs : total;
       memcpy(p, fp->rbuf, n);
       p += n;
+      total -= n;
+      fp->rp = n;
     }
   } else {
     // Read to the given buffer directly.
-    ssize_t len = read(fp->fd, p, total);
-    p += len;
-    fp->rp = fp->rs = 0;
+    while (total > 0) {
+      ssize_t len = read(fp->fd, p, total);
+      if (len <= 0)
+        break;
+      p += len;
+      total -= len;
+    }
   }
 
   // TODO: Align by size.
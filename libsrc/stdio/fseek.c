@@ -5,6 +5,7 @@
 
 int fseek(FILE *fp, long offset, int origin) {
   fflush(fp);
+  fp->rp = fp->rs = 0;  // Discard read buffer.
   off_t result = lseek(fp->fd, offset, origin);
   if (result == -1)
     return 1;  // TODO:
@@ -1,16 +1,52 @@
 #include "stdio.h"
+#include "string.h"  // memcpy, memchr
 #include "unistd.h"  // write
 
 #include "./_file.h"
 
 size_t fwrite(const void *buffer, size_t size, size_t count, FILE *fp) {
-  int (*fputc)(int, FILE*) = fp->fputc;
   const unsigned char *src = (const unsigned char*)buffer;
-  size_t total = size * count, i;
-  for (i = 0; i < total; ++i) {
-    if (fputc(*src, fp) == EOF)
-      break;
-    ++src;
+  size_t total = size * count;
+  if (total == 0)
+    return 0;
+
+  if (fp->fputc != _fputc) {
+    // Stream with its own output function, e.g. memory.
+    int (*fputc)(int, FILE*) = fp->fputc;
+    size_t i;
+    for (i = 0; i < total; ++i) {
+      if (fputc(*src, fp) == EOF)
+        break;
+      ++src;
+    }
+    return i / size;
+  }
+
+  if (fp->wbuf == NULL)
+    _fsetup_write(fp);
+
+  if (total > fp->ws - fp->wp) {
+    if (fflush(fp) == EOF)
+      return 0;
+    if (total >= fp->ws) {
+      // Too large to buffer: write directly.
+      size_t written = 0;
+      while (written < total) {
+        ssize_t n = write(fp->fd, src + written, total - written);
+        if (n <= 0)
+          break;
+        written += n;
+      }
+      return written / size;
+    }
+  }
+
+  memcpy(&fp->wbuf[fp->wp], src, total);
+  fp->wp += total;
+  if (fp->wp >= fp->ws ||
+      ((fp->flag & FF_LINEBUF) && memchr(src, '\n', total) != NULL)) {
+    if (fflush(fp) == EOF)
+      return 0;
   }
-  return i;
+  return count;
 }
@@ -1,5 +1,8 @@
 #include "stdio.h"
 #include "stdlib.h"  // realloc
+#include "string.h"  // memchr, memcpy
+
+#include "./_file.h"
 
 ssize_t getline(char **lineptr, size_t *pcapa, FILE *stream) {
   const int MIN_CAPA = 16;
@@ -11,17 +14,24 @@ ssize_t getline(char **lineptr, size_t *pcapa, FILE *stream) {
     capa = 0;
   }
   for (;;) {
-    int c = fgetc(stream);
-    if (c == EOF) {
+    if (stream->rp >= stream->rs && _ffill(stream) <= 0) {
       if (size == 0)
         return -1;
       break;
     }
 
-    if (size + 1 >= capa) {
+    // Take characters up to newline from the buffer at once.
+    const unsigned char *start = &stream->rbuf[stream->rp];
+    size_t avail = stream->rs - stream->rp;
+    const unsigned char *nl = memchr(start, '\n', avail);
+    size_t n = nl != NULL ? (size_t)(nl - start) + 1 : avail;
+
+    if (size + (ssize_t)n >= capa) {
       ssize_t newcapa = capa * 2;
       if (newcapa < MIN_CAPA)
         newcapa = MIN_CAPA;
+      while (size + (ssize_t)n >= newcapa)
+        newcapa *= 2;
       char *reallocated = realloc(top, newcapa);
       if (reallocated == NULL) {
         *lineptr = top;
@@ -32,10 +42,11 @@ ssize_t getline(char **lineptr, size_t *pcapa, FILE *stream) {
       capa = newcapa;
     }
 
-    //assert(size < capa);
-    top[size++] = c;
+    memcpy(top + size, start, n);
+    size += n;
+    stream->rp += n;
 
-    if (c == '\n')
+    if (nl != NULL)
       break;
   }
 
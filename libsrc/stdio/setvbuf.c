@@ -0,0 +1,27 @@
+#include "stdio.h"
+
+#include "./_file.h"
+
+int setvbuf(FILE *fp, char *buf, int mode, size_t size) {
+  unsigned int flag;
+  switch (mode) {
+  case _IOFBF:  flag = 0; break;
+  case _IOLBF:  flag = FF_LINEBUF; break;
+  case _IONBF:  flag = 0; buf = NULL; size = 1; break;
+  default:  return EOF;
+  }
+  if (fp->flag & FF_MEMORY)
+    return EOF;
+
+  fflush(fp);
+  _ffree_buffers(fp);
+  fp->flag = (fp->flag & ~(FF_LINEBUF | FF_TTYCHECK | FF_USERBUF)) | flag;
+  fp->bufsiz = size;
+  if (buf != NULL && size > 0) {
+    // Shared for reading and writing: a stream has to be flushed or seeked to switch them.
+    fp->wbuf = fp->rbuf = (unsigned char*)buf;
+    fp->ws = fp->rcap = size;
+    fp->flag |= FF_USERBUF;
+  }
+  return 0;
+}
@@ -4,9 +4,15 @@
 #include "_file.h"
 #include "_fileman.h"
 
-static FILE _stdin = {.fd = STDIN_FILENO};
-static FILE _stdout = {.fputc = _fputc, .fd = STDOUT_FILENO, .wbuf = _stdout.wwork, .ws = sizeof(_stdout.wwork)};
-static FILE _stderr = {.fputc = _fputc, .fd = STDERR_FILENO, .wbuf = _stderr.wwork, .ws = sizeof(_stderr.wwork)};
+#if defined(__WASM)
+#define STDOUT_FLAG  FF_LINEBUF
+#else
+#define STDOUT_FLAG  FF_TTYCHECK
+#endif
+
+static FILE _stdin = {.fd = STDIN_FILENO, .bufsiz = BUFSIZ};
+static FILE _stdout = {.fputc = _fputc, .fd = STDOUT_FILENO, .bufsiz = BUFSIZ, .flag = STDOUT_FLAG};
+static FILE _stderr = {.fputc = _fputc, .fd = STDERR_FILENO, .bufsiz = BUFSIZ, .flag = FF_LINEBUF};
 FILE *stdin = &_stdin;
 FILE *stdout = &_stdout;
 FILE *stderr = &_stderr;
@@ -1,13 +1,14 @@
 #include "stdio.h"
 
 #include "stdlib.h"  // mkstemp
-#include "unistd.h"  // close
+#include "unistd.h"  // close, unlink
 
 FILE *tmpfile(void) {
   char template[] = "/tmp/tmpXXXXXX";
   int fd = mkstemp(template);
   FILE *fp = NULL;
   if (fd >= 0) {
+    unlink(template);  // Removed when closed.
     fp = fdopen(fd, "w+");
     if (fp == NULL) {
       close(fd);
@@ -22,9 +22,8 @@ static char kHexDigits[] = "0123456789abcdef";
 static char kUpperHexDigits[] = "0123456789ABCDEF";
 
 static void putnstr(FILE *fp, int n, const char *s) {
-  int c;
-  for (; (c = *s++) != '\0' && n > 0; --n)
-    FPUTC(c, fp);
+  if (n > 0)
+    fwrite(s, 1, n, fp);
 }
 
 static void putpadding(FILE *fp, int m, char padding) {
@@ -36,12 +35,14 @@ static int snprintullong(FILE *fp, unsigned long long x,
                          int base, const char* digits, int order, int padding) {
   char buf[32];
   STATIC_ASSERT(sizeof(buf) >= (sizeof(long long) * CHAR_BIT + 2) / 3);
-  unsigned int i = 0, o = 0;
+  char *p = buf + sizeof(buf);
+  unsigned int i, o = 0;
 
   do {
-    buf[i++] = digits[x % base];
+    *(--p) = digits[x % base];
     x /= base;
   } while (x != 0);
+  i = buf + sizeof(buf) - p;
 
   if (i < (unsigned int)order) {
     unsigned int d = (unsigned int)order - i;
@@ -49,10 +50,8 @@ static int snprintullong(FILE *fp, unsigned long long x,
     o += d;
   }
 
-  for (; i > 0; ++o)
-    FPUTC(buf[--i], fp);
-
-  return o;
+  fwrite(p, 1, i, fp);
+  return o + i;
 }
 
 char *snprintullong2(char *bufend, unsigned long long x, int base, const char *digits) {
@@ -100,98 +99,251 @@ static int sprintsign(FILE *fp, bool negative, bool force, int *porder) {
 }
 
 #ifndef __NO_FLONUM
-static double pow10(int order) {
-  double a = 1, x = 10;
-  for (; order > 0; order >>= 1) {
-    if ((order & 1) != 0)
-      a *= x;
-    x *= x;
+#define FLOAT_DIGITS  (800)  // Enough for the exact value of any double.
+#define BIG_LIMBS     (90)   // Base 10^9 limbs for the exact value.
+
+// Rounds the digits buf[0..n) to `keep` digits, half to even. `rest` tells
+// whether nonzero digits follow buf[n - 1]. Trailing zeros are dropped;
+// returns the new digit count.
+static int round_digits(char *buf, int n, int keep, bool rest, int *pdecpt) {
+  if (keep < n) {
+    if (keep < 0)
+      return 0;
+
+    char d = buf[keep];
+    bool up = d > '5';
+    if (d == '5') {
+      for (int i = keep + 1; i < n && !rest; ++i)
+        rest = buf[i] != '0';
+      up = rest || (keep > 0 && ((buf[keep - 1] - '0') & 1) != 0);
+    }
+    n = keep;
+    if (up) {
+      int i = keep;
+      while (--i >= 0 && buf[i] == '9')
+        ;
+      if (i < 0) {
+        buf[0] = '1';
+        ++*pdecpt;
+        i = 0;
+      } else {
+        ++buf[i];
+      }
+      n = i + 1;
+    }
   }
-  return a;
+  while (n > 0 && buf[n - 1] == '0')
+    --n;
+  return n;
 }
 
-static int printfloat(FILE *fp, double x,
-                      int order, int suborder, bool sign, bool leftalign, char padding) {
-  if (!isfinite(x)) {
-    const char *s = isnan(x) ? "nan" : x > 0 ? "inf" : "-inf";
-    return snprintstr(fp, s, order, suborder, leftalign, ' ');
+// Decimal digits of the exact value m * 2^e, using big integer arithmetic.
+static int big_float_digits(uint64_t m, int e, char *buf, int *pdecpt) {
+  uint32_t limbs[BIG_LIMBS];
+  int nl = 0;
+  for (; m != 0; m /= 1000000000)
+    limbs[nl++] = m % 1000000000;
+
+  // For e < 0: m * 2^e = m * 5^-e / 10^-e.
+  int k = e >= 0 ? e : -e;
+  while (k > 0) {
+    int step = k < 13 ? k : 13;
+    uint64_t mul = e >= 0 ? (uint64_t)1 << step : 1;
+    if (e < 0) {
+      for (int i = 0; i < step; ++i)
+        mul *= 5;
+    }
+    uint64_t carry = 0;
+    for (int i = 0; i < nl; ++i) {
+      uint64_t t = limbs[i] * mul + carry;
+      limbs[i] = t % 1000000000;
+      carry = t / 1000000000;
+    }
+    for (; carry != 0; carry /= 1000000000)
+      limbs[nl++] = carry % 1000000000;
+    k -= step;
   }
 
-  int o = sprintsign(fp, x < 0, sign, &order);
-  x = x < 0 ? -x : x;
+  char tmp[10];
+  int n = 0;
+  for (uint32_t x = limbs[nl - 1]; x != 0; x /= 10)
+    tmp[n++] = '0' + x % 10;
+  for (int i = 0; i < n; ++i)
+    buf[i] = tmp[n - 1 - i];
+  for (int i = nl - 1; --i >= 0;) {
+    uint32_t x = limbs[i];
+    for (int j = 9; --j >= 0; x /= 10)
+      buf[n + j] = '0' + x % 10;
+    n += 9;
+  }
+  *pdecpt = n + (e < 0 ? e : 0);
+  return n;
+}
 
-  unsigned long long int_part = x;
-  suborder = suborder > 0 ? suborder : 6;
-  double one = pow10(suborder);
-  unsigned long long fraction = (x - int_part) * one + 0.5;
-  if (fraction >= one) {
-    ++int_part;
-    fraction -= one;
+// Digits of a positive or zero double, rounded correctly to `ndigits`
+// significant digits, or to `ndigits` places after the decimal point if
+// `fixed` is true. The value is 0.buf * 10^decpt.
+static int float_digits(double x, bool fixed, int ndigits, char *buf, int *pdecpt) {
+  uint64_t bits = *(uint64_t*)&x;
+  uint64_t m = bits & (((uint64_t)1 << 52) - 1);
+  int e = (int)(bits >> 52) & 0x7ff;
+  if (e == 0) {
+    if (m == 0) {
+      *pdecpt = 1;
+      return 0;
+    }
+    e = 1;
+  } else {
+    m |= (uint64_t)1 << 52;
   }
-  o += snprintullong(fp, int_part, 10, kHexDigits, order, padding);
-  FPUTC('.', fp); ++o;
-  o += snprintullong(fp, fraction, 10, kHexDigits,
-                      suborder, '0');
-  return o;
+  e -= 1075;
+
+  if (e < -60 || e > 11) {
+    int n = big_float_digits(m, e, buf, pdecpt);
+    return round_digits(buf, n, fixed ? *pdecpt + ndigits : ndigits, false, pdecpt);
+  }
+
+  // Fits in 64 bits: integer part, and the fraction f / 2^s.
+  int s = e < 0 ? -e : 0;
+  uint64_t ip = e < 0 ? m >> s : m << e;
+  uint64_t mask = ((uint64_t)1 << s) - 1;
+  uint64_t f = m & mask;
+  int n = 0, decpt = 0;
+  if (ip != 0) {
+    char tmp[20];
+    for (; ip != 0; ip /= 10)
+      tmp[n++] = '0' + ip % 10;
+    for (int i = 0; i < n; ++i)
+      buf[i] = tmp[n - 1 - i];
+    decpt = n;
+  } else {
+    // Skip leading zeros of the fraction.
+    for (;;) {
+      f *= 10;
+      char d = f >> s;
+      f &= mask;
+      if (d != 0) {
+        buf[n++] = '0' + d;
+        break;
+      }
+      --decpt;
+    }
+  }
+  int keep = fixed ? decpt + ndigits : ndigits;
+  while (n <= keep && f != 0) {
+    f *= 10;
+    buf[n++] = '0' + (f >> s);
+    f &= mask;
+  }
+  *pdecpt = decpt;
+  return round_digits(buf, n, keep, f != 0, pdecpt);
 }
 
-static int normalize_float(double *px) {
-  double x = *px;
-  int exp = 0;
-  if (x >= 1e6) {
-    do {
-      x /= 10;
-      ++exp;
-    } while (x >= 10);
+// Outputs buf[from..from + count), where digits out of [0, n) are zero.
+static void put_digits(FILE *fp, const char *buf, int n, int from, int count) {
+  if (from < 0) {
+    int z = MIN(-from, count);
+    putpadding(fp, z, '0');
+    from += z;
+    count -= z;
   }
-  if (x > 0 && x <= 1e-4) {
-    do {
-      x *= 10;
-      --exp;
-    } while (x < 1.0);
+  if (from < n && count > 0) {
+    int k = MIN(n - from, count);
+    fwrite(buf + from, 1, k, fp);
+    count -= k;
   }
-  *px = x;
-  return exp;
+  putpadding(fp, count, '0');
 }
 
-static int printscientific(
-    FILE *fp, double x,
-    int order, int suborder, bool sign, bool leftalign, char padding) {
+// %f, %e and %g (and upper case).
+static int printfloat(FILE *fp, double x, int c, int order, int precision, bool sign,
+                      bool leftalign, char padding) {
+  uint64_t bits = *(uint64_t*)&x;
+  bool negative = (bits >> 63) != 0;
+  bool upper = c >= 'A' && c <= 'Z';
   if (!isfinite(x)) {
-    const char *s = isnan(x) ? "nan" : x > 0 ? "inf" : "-inf";
-    return snprintstr(fp, s, order, suborder, leftalign, ' ');
+    const char *s = isnan(x) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+    char buf[8], *p = buf;
+    if (negative && !isnan(x))
+      *p++ = '-';
+    else if (sign)
+      *p++ = '+';
+    strcpy(p, s);
+    return snprintstr(fp, buf, order, 0, leftalign, ' ');
   }
 
-  int o = sprintsign(fp, x < 0, sign, &order);
-  x = x < 0 ? -x : x;
-
-  int e = normalize_float(&x);
-  unsigned long long int_part = x;
-  suborder = suborder > 0 ? suborder : 6;
-  double one = pow10(suborder);
-  unsigned long long fraction = (x - int_part) * one + 0.5;
-  if (fraction >= one) {
-    ++int_part;
-    fraction -= one;
+  bits &= ~((uint64_t)1 << 63);
+  x = *(double*)&bits;
+  if (precision < 0)
+    precision = 6;
+
+  char buf[FLOAT_DIGITS];
+  int n, decpt;
+  int style = tolower(c);
+  if (style == 'g') {
+    int p = precision > 0 ? precision : 1;
+    n = float_digits(x, false, p, buf, &decpt);
+    int exp = decpt - 1;
+    int frac;
+    if (exp < p && exp >= -4) {
+      style = 'f';
+      precision = p - 1 - exp;
+      frac = n - decpt;
+    } else {
+      style = 'e';
+      precision = p - 1;
+      frac = n - 1;
+    }
+    // Drop trailing zeros.
+    precision = MIN(precision, frac > 0 ? frac : 0);
+  } else if (style == 'e') {
+    n = float_digits(x, false, precision + 1, buf, &decpt);
+  } else {
+    n = float_digits(x, true, precision, buf, &decpt);
   }
-  while (fraction % 10 == 0 && suborder > 0) {
-    fraction /= 10;
-    --suborder;
+  if (n == 0)
+    decpt = 1;
+
+  int exp = decpt - 1, len;
+  if (style == 'f') {
+    len = (decpt > 0 ? decpt : 1) + (precision > 0 ? precision + 1 : 0);
+  } else {
+    int aexp = exp < 0 ? -exp : exp;
+    len = 1 + (precision > 0 ? precision + 1 : 0) + 2 + (aexp >= 100 ? 3 : 2);
   }
-  o += snprintullong(fp, int_part, 10, kHexDigits, order, padding);
-  if (fraction != 0) {
-    FPUTC('.', fp); ++o;
-    o += snprintullong(fp, fraction, 10, kHexDigits,
-                       suborder, '0');
+  len += negative || sign;
+
+  int pad = order > len ? order - len : 0;
+  if (!leftalign && padding != '0')
+    putpadding(fp, pad, ' ');
+  if (negative || sign)
+    FPUTC(negative ? '-' : '+', fp);
+  if (!leftalign && padding == '0')
+    putpadding(fp, pad, '0');
+
+  if (style == 'f') {
+    if (decpt > 0)
+      put_digits(fp, buf, n, 0, decpt);
+    else
+      FPUTC('0', fp);
+    if (precision > 0) {
+      FPUTC('.', fp);
+      put_digits(fp, buf, n, decpt, precision);
+    }
+  } else {
+    put_digits(fp, buf, n, 0, 1);
+    if (precision > 0) {
+      FPUTC('.', fp);
+      put_digits(fp, buf, n, 1, precision);
+    }
+    FPUTC(upper ? 'E' : 'e', fp);
+    FPUTC(exp < 0 ? '-' : '+', fp);
+    snprintullong(fp, exp < 0 ? -exp : exp, 10, kHexDigits, 2, '0');
   }
 
-  if (e != 0) {
-    FPUTC('e', fp); ++o;
-    o += sprintsign(fp, e < 0, true, &order);
-    e = e < 0 ? -e : e;
-    o += snprintullong(fp, e, 10, kHexDigits, 2, '0');
-  }
-  return o;
+  if (leftalign)
+    putpadding(fp, pad, ' ');
+  return len + pad;
 }
 #endif
 
@@ -207,14 +359,18 @@ int vfprintf(FILE *fp, const char *fmt_, va_list ap) {
   for (i = o = 0; fmt[i] != '\0'; i++) {
     c = fmt[i];
     if (c != '%') {
-      FPUTC(c, fp);
-      ++o;
+      // Output plain characters up to the next '%' at once.
+      int j = i;
+      while (fmt[i + 1] != '\0' && fmt[i + 1] != '%')
+        ++i;
+      fwrite(&fmt[j], 1, i - j + 1, fp);
+      o += i - j + 1;
       continue;
     }
 
     // Handle '%'
     char padding = ' ';
-    int order = 0, suborder = 0;
+    int order = 0, suborder = -1;
     bool sign = false;
     bool leftalign = false;
     int nlong = 0;
@@ -240,6 +396,7 @@ int vfprintf(FILE *fp, const char *fmt_, va_list ap) {
       c = fmt[++i];
     }
     if (c == '.') {
+      suborder = 0;
       c = fmt[++i];
       if (isdigit(c)) {
         do {
@@ -327,13 +484,9 @@ int vfprintf(FILE *fp, const char *fmt_, va_list ap) {
       ++o;
       break;
 #ifndef __NO_FLONUM
-    case 'f': {
-      double x = va_arg(ap, double);
-      o += printfloat(fp, x, order, suborder, sign, leftalign, padding);
-    } break;
-    case 'g': {
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
       double x = va_arg(ap, double);
-      o += printscientific(fp, x, order, suborder, sign, leftalign, padding);
+      o += printfloat(fp, x, c, order, suborder, sign, leftalign, padding);
     } break;
 #endif
     default:
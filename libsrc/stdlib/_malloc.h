@@ -1,11 +1,17 @@
 #pragma once
 
-typedef long Align;
-
-typedef union header {
-  struct {
-    union header *ptr;
-    unsigned int size;
-  } s;
-  Align x;
+#include <stdbool.h>
+#include <stddef.h>  // size_t
+
+#define PAGESIZE  (4096)
+#define MAX_ALLOC  ((size_t)-1 / 4)
+
+// Every block has a header in front of the memory returned to the user.
+typedef struct Header {
+  size_t size;  // Usable size in bytes.
+  size_t cls;   // Size class index, or LARGE_CLASS for a mapped block.
 } Header;
+
+#define LARGE_CLASS  ((size_t)-1)
+
+bool _malloc_expand(Header *h, size_t size);
@@ -1,73 +1,137 @@
 #include "_malloc.h"
+#include "stdint.h"  // intptr_t
 #include "stdlib.h"
 #include "unistd.h"  // for sbrk
+#if !defined(__WASM)
+#include "sys/mman.h"
+#endif
 
-// Memory allocator by Kernighan and Ritchie,
-// The C programming Language, 2nd ed.  Section 8.7.
+// Segregated size class allocator:
+//   A request is rounded up to its size class and served from the free list
+//   of that class, so both malloc and free are O(1). Empty free lists are
+//   refilled from chunks taken by sbrk. Large requests are mapped directly
+//   with mmap and given back to the OS on free.
 
-#define PAGESIZE  (4096)
+#define CHUNK_SIZE  (64 * 1024)
+#define MMAP_THRESHOLD  (128 * 1024)
 
-static Header base = {.s={.ptr=&base, .size=0}};
-static Header *freep = &base;
+// 16, 32, ..., 128, then two classes for each power of two: 192, 256, 384, 512, ...
+#define SMALL_CLASS_COUNT  (8)
+#define CLASS_COUNT  (SMALL_CLASS_COUNT + 2 * 56)
 
-void free(void *ap) {
-  Header *bp, *p;
+// Freed block keeps its header, and the link to the next one is stored in its body.
+#define NEXT_FREE(h)  (*(Header**)((h) + 1))
 
-  if (ap == 0)
-    return;
+static Header *free_lists[CLASS_COUNT];
+static char *arena_ptr, *arena_end;
+
+static size_t size_to_class(size_t size) {
+  if (size <= 16 * SMALL_CLASS_COUNT)
+    return size > 0 ? (size - 1) / 16 : 0;
 
-  bp = (Header*)ap - 1;
-  for (p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
-    if (p >= p->s.ptr && (bp > p || bp < p->s.ptr))
-      break;
-  if (bp + bp->s.size == p->s.ptr) {
-    bp->s.size += p->s.ptr->s.size;
-    bp->s.ptr = p->s.ptr->s.ptr;
-  } else
-    bp->s.ptr = p->s.ptr;
-  if (p + p->s.size == bp) {
-    p->s.size += bp->s.size;
-    p->s.ptr = bp->s.ptr;
-  } else
-    p->s.ptr = bp;
-  freep = p;
+  size_t base = 16 * SMALL_CLASS_COUNT;
+  size_t cls = SMALL_CLASS_COUNT;
+  while (base * 2 < size) {
+    base *= 2;
+    cls += 2;
+  }
+  return size <= base + base / 2 ? cls : cls + 1;
 }
 
-static Header *morecore(size_t nu) {
-  size_t size;
-  char *p;
-  Header *hp;
-
-  size = (nu * sizeof(Header) + (PAGESIZE - 1)) & -PAGESIZE;
-  p = sbrk(size);
-  if (p == (char*)-1)
-    return 0;
-  hp = (Header*)p;
-  hp->s.size = size / sizeof(Header);
-  free((void*)(hp + 1));
-  return freep;
+static size_t class_size(size_t cls) {
+  if (cls < SMALL_CLASS_COUNT)
+    return 16 * (cls + 1);
+  size_t base = (size_t)(16 * SMALL_CLASS_COUNT) << ((cls - SMALL_CLASS_COUNT) / 2);
+  return (cls - SMALL_CLASS_COUNT) % 2 == 0 ? base + base / 2 : base * 2;
 }
 
-void *malloc(size_t nbytes) {
-  Header *p, *prevp;
-  size_t nunits;
-
-  nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
-  prevp = freep;
-  for (p = prevp->s.ptr; ; prevp = p, p = p->s.ptr) {
-    if (p->s.size >= nunits) {
-      if (p->s.size == nunits)
-        prevp->s.ptr = p->s.ptr;
-      else {
-        p->s.size -= nunits;
-        p += p->s.size;
-        p->s.size = nunits;
-      }
-      freep = prevp;
-      return (void*)(p + 1);
+static bool reserve_arena(size_t bytes) {
+  if ((size_t)(arena_end - arena_ptr) < bytes) {
+    size_t size = (bytes + sizeof(Header) + (PAGESIZE - 1)) & -PAGESIZE;
+    if (size < CHUNK_SIZE)
+      size = CHUNK_SIZE;
+    char *p = sbrk(size);
+    if (p == (char*)-1)
+      return false;
+    if (p != arena_end) {
+      // Not adjacent to the current chunk: the rest of it is abandoned.
+      arena_ptr = (char*)(((intptr_t)p + (sizeof(Header) - 1)) & -(intptr_t)sizeof(Header));
     }
-    if (p == freep)
-      if ((p = morecore(nunits)) == 0)
-        return 0;
+    arena_end = p + size;
+  }
+  return true;
+}
+
+static Header *alloc_from_arena(size_t bytes) {
+  if (!reserve_arena(bytes))
+    return NULL;
+  Header *h = (Header*)arena_ptr;
+  arena_ptr += bytes;
+  return h;
+}
+
+// Grow the block in place, when it is the last one taken from the arena.
+bool _malloc_expand(Header *h, size_t size) {
+  char *end = (char*)(h + 1) + h->size;
+  if (h->cls == LARGE_CLASS || end != arena_ptr || size > MAX_ALLOC)
+    return false;
+#if !defined(__WASM)
+  if (size >= MMAP_THRESHOLD)
+    return false;
+#endif
+
+  size_t cls = size_to_class(size);
+  size_t csize = class_size(cls);
+  if (!reserve_arena(csize - h->size) || arena_ptr != end)
+    return false;
+  arena_ptr = (char*)(h + 1) + csize;
+  h->size = csize;
+  h->cls = cls;
+  return true;
+}
+
+void *malloc(size_t size) {
+  if (size > MAX_ALLOC)
+    return NULL;
+
+#if !defined(__WASM)
+  if (size >= MMAP_THRESHOLD) {
+    size_t bytes = (size + sizeof(Header) + (PAGESIZE - 1)) & -PAGESIZE;
+    Header *h = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (h == MAP_FAILED)
+      return NULL;
+    h->size = bytes - sizeof(Header);
+    h->cls = LARGE_CLASS;
+    return h + 1;
+  }
+#endif
+
+  size_t cls = size_to_class(size);
+  Header *h = free_lists[cls];
+  if (h != NULL) {
+    free_lists[cls] = NEXT_FREE(h);
+  } else {
+    size_t csize = class_size(cls);
+    h = alloc_from_arena(sizeof(Header) + csize);
+    if (h == NULL)
+      return NULL;
+    h->size = csize;
+    h->cls = cls;
+  }
+  return h + 1;
+}
+
+void free(void *ptr) {
+  if (ptr == NULL)
+    return;
+
+  Header *h = (Header*)ptr - 1;
+#if !defined(__WASM)
+  if (h->cls == LARGE_CLASS) {
+    munmap(h, h->size + sizeof(Header));
+    return;
   }
+#endif
+  NEXT_FREE(h) = free_lists[h->cls];
+  free_lists[h->cls] = h;
 }
@@ -1,45 +1,156 @@
 #include "stdlib.h"
+#include "stdbool.h"
+#include "stdint.h"  // uintptr_t
 
-void qsort(void *base, size_t nmemb, size_t size, int (*compare)(const void *, const void *)) {
-  if (nmemb <= 1)
-    return;
+// Introsort: quicksort with median-of-three pivots, falling back to heapsort
+// when the recursion gets too deep, and insertion sort for small ranges.
+
+#define INSERTION_SORT_SIZE  (16)
+
+typedef int (*Compare)(const void *, const void *);
+
+typedef struct {
+  size_t size;
+  Compare compare;
+  size_t swap_unit;  // Swap elements in long, int or byte units.
+} SortContext;
+
+static void qsort_swap(const SortContext *ctx, char *p, char *q) {
+  size_t unit = ctx->swap_unit;
+  if (unit == sizeof(long)) {
+    long *lp = (long*)p, *lq = (long*)q;
+    for (size_t n = ctx->size / sizeof(long); n > 0; --n) {
+      long t = *lp;
+      *lp++ = *lq;
+      *lq++ = t;
+    }
+  } else if (unit == sizeof(int)) {
+    int *ip = (int*)p, *iq = (int*)q;
+    for (size_t n = ctx->size / sizeof(int); n > 0; --n) {
+      int t = *ip;
+      *ip++ = *iq;
+      *iq++ = t;
+    }
+  } else {
+    for (size_t n = ctx->size; n > 0; --n) {
+      char t = *p;
+      *p++ = *q;
+      *q++ = t;
+    }
+  }
+}
+
+static void insertion_sort(const SortContext *ctx, char *a, size_t nmemb) {
+  size_t size = ctx->size;
+  char *end = a + nmemb * size;
+  for (char *p = a + size; p < end; p += size) {
+    for (char *q = p; q > a && ctx->compare(q - size, q) > 0; q -= size)
+      qsort_swap(ctx, q - size, q);
+  }
+}
+
+static void sift_down(const SortContext *ctx, char *a, size_t i, size_t nmemb) {
+  size_t size = ctx->size;
+  for (;;) {
+    size_t child = i * 2 + 1;
+    if (child >= nmemb)
+      break;
+    if (child + 1 < nmemb && ctx->compare(&a[child * size], &a[(child + 1) * size]) < 0)
+      ++child;
+    if (ctx->compare(&a[i * size], &a[child * size]) >= 0)
+      break;
+    qsort_swap(ctx, &a[i * size], &a[child * size]);
+    i = child;
+  }
+}
 
-  char *a = base;
+static void heap_sort(const SortContext *ctx, char *a, size_t nmemb) {
+  for (size_t i = nmemb / 2; i > 0; --i)
+    sift_down(ctx, a, i - 1, nmemb);
+  for (size_t n = nmemb; n > 1; --n) {
+    qsort_swap(ctx, a, &a[(n - 1) * ctx->size]);
+    sift_down(ctx, a, 0, n - 1);
+  }
+}
 
-  size_t mid = nmemb >> 1;
-  const char *px = &a[mid * size];
-  size_t i = 0;
-  size_t j = nmemb - 1;
+static char *median_of_three(Compare compare, char *p, char *q, char *r) {
+  if (compare(p, q) < 0) {
+    if (compare(q, r) < 0)
+      return q;
+    return compare(p, r) < 0 ? r : p;
+  } else {
+    if (compare(p, r) < 0)
+      return p;
+    return compare(q, r) < 0 ? r : q;
+  }
+}
+
+// Partitions around the pivot placed at a[0], stopping on equal elements
+// so that many duplicates still split evenly. Returns the final position
+// of the pivot.
+static char *partition(const SortContext *ctx, char *a, size_t nmemb) {
+  size_t size = ctx->size;
+  Compare compare = ctx->compare;
+  char *last = a + (nmemb - 1) * size;
+  char *p = a, *q = last + size;
   for (;;) {
-    while (i < mid && compare(&a[i * size], px) < 0)
-      ++i;
-    while (j > mid && compare(px, &a[j * size]) < 0)
-      --j;
-    if (i >= j)
+    while ((p += size) < last && compare(p, a) < 0)
+      ;
+    while ((q -= size) > a && compare(a, q) < 0)
+      ;
+    if (p >= q)
       break;
+    qsort_swap(ctx, p, q);
+  }
+  qsort_swap(ctx, a, q);
+  return q;
+}
 
-    char *pi = &a[i * size];
-    char *pj = &a[j * size];
-    for (size_t k = 0; k < size; ++k) {
-      char t = pi[k];
-      pi[k] = pj[k];
-      pj[k] = t;
+static void intro_sort(const SortContext *ctx, char *a, size_t nmemb, int depth) {
+  size_t size = ctx->size;
+  while (nmemb > INSERTION_SORT_SIZE) {
+    if (depth <= 0) {
+      heap_sort(ctx, a, nmemb);
+      return;
     }
-    if (px == pi) {
-      px = pj;
-      mid = j;
-      ++i;
-    } else if (px == pj) {
-      px = pi;
-      mid = i;
-      --j;
+    --depth;
+
+    char *pivot = median_of_three(ctx->compare, a, &a[(nmemb / 2) * size], &a[(nmemb - 1) * size]);
+    if (pivot != a)
+      qsort_swap(ctx, a, pivot);
+    size_t m = (partition(ctx, a, nmemb) - a) / size;
+
+    // Recurse on the smaller side and loop on the larger one,
+    // which bounds the stack depth to O(log n).
+    size_t right = nmemb - m - 1;
+    if (m < right) {
+      intro_sort(ctx, a, m, depth);
+      a += (m + 1) * size;
+      nmemb = right;
     } else {
-      ++i;
-      --j;
+      intro_sort(ctx, &a[(m + 1) * size], right, depth);
+      nmemb = m;
     }
   }
-  if (i > 1)
-    qsort(a, i, size, compare);
-  if ((size_t)(j + 2) < nmemb)
-    qsort(&a[(j + 1) * size], nmemb - j - 1, size, compare);
+  insertion_sort(ctx, a, nmemb);
+}
+
+void qsort(void *base, size_t nmemb, size_t size, int (*compare)(const void *, const void *)) {
+  if (nmemb <= 1 || size == 0)
+    return;
+
+  size_t swap_unit = 1;
+  if (size % sizeof(long) == 0 && (uintptr_t)base % sizeof(long) == 0)
+    swap_unit = sizeof(long);
+  else if (size % sizeof(int) == 0 && (uintptr_t)base % sizeof(int) == 0)
+    swap_unit = sizeof(int);
+  SortContext ctx = {
+    .size = size,
+    .compare = compare,
+    .swap_unit = swap_unit,
+  };
+  int depth = 0;
+  for (size_t n = nmemb; n > 1; n >>= 1)
+    depth += 2;
+  intro_sort(&ctx, base, nmemb, depth);
 }
@@ -1,21 +1,44 @@
 #include "_malloc.h"
 #include "stdlib.h"
 #include "string.h"  // memcpy
+#if !defined(__WASM)
+#include "sys/mman.h"
+#endif
 
 void *realloc(void* p, size_t size) {
+  if (p == NULL)
+    return malloc(size);
+
   if (size <= 0) {
     free(p);
     return NULL;
   }
 
-  if (p == NULL)
-    return malloc(size);
+  if (size > MAX_ALLOC)
+    return NULL;
+
+  Header* h = (Header*)p - 1;
+#if !defined(__WASM)
+  if (h->cls == LARGE_CLASS) {
+    // Remap the pages instead of copying them; shrinking never moves.
+    size_t bytes = (size + sizeof(Header) + (PAGESIZE - 1)) & -PAGESIZE;
+    size_t old_bytes = h->size + sizeof(Header);
+    if (bytes == old_bytes)
+      return p;
+    Header *q = mremap(h, old_bytes, bytes, MREMAP_MAYMOVE);
+    if (q == MAP_FAILED)
+      return bytes < old_bytes ? p : NULL;
+    q->size = bytes - sizeof(Header);
+    return q + 1;
+  }
+#endif
+
+  if (size <= h->size || _malloc_expand(h, size))
+    return p;
 
   void* buf = malloc(size);
   if (buf != NULL) {
-    Header* h = (Header*)p - 1;
-    size_t s = (h->s.size - 1) * sizeof(Header);
-    memcpy(buf, p, size > s ? s : size);
+    memcpy(buf, p, h->size);
     free(p);
   }
   return buf;
@@ -1,51 +1,274 @@
 #include "stdlib.h"
 #include "ctype.h"  // isspace
+#include "errno.h"
 #include "stdbool.h"
+#include "stdint.h"
 #include "string.h"
 
 bool parse_sign(const char **pp);
 
 #ifndef __NO_FLONUM
-static double ipow(double base, long x) {
-  double result = 1;
-  double a = base;
-  for (; x > 0; x >>= 1, a *= a) {
-    if ((x & 1) != 0)
-      result *= a;
-  }
-  return result;
+#include "_pow10.h"
+
+#define MANT_BITS  (52)
+#define EXP_BIAS   (1023)
+#define EXP_MAX    (0x7ff)
+#define SIGN_BIT   ((uint64_t)1 << 63)
+
+#define MAX_MANT_DIGITS  (19)  // Decimal digits which always fit in uint64_t.
+
+static double bits_to_double(uint64_t bits) {
+  return *(double*)&bits;
 }
 
-static double strtod_i(const char *p, const char **pp) {
-  double result = 0;
-  for (;; ++p) {
-    char c = *p;
-    if (!(c >= '0' && c <= '9'))
-      break;
-    result = result * 10 + (c - '0');
+// Exact powers of ten representable in double.
+static const double kExactPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+  1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// High 64 bits of the 128 bit product.
+static uint64_t mul128(uint64_t a, uint64_t b, uint64_t *plo) {
+  uint64_t al = (uint32_t)a, ah = a >> 32;
+  uint64_t bl = (uint32_t)b, bh = b >> 32;
+  uint64_t p0 = al * bl, p1 = al * bh, p2 = ah * bl, p3 = ah * bh;
+  uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+  *plo = (mid << 32) | (uint32_t)p0;
+  return p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+}
+
+static int count_leading_zeros(uint64_t x) {
+  int n = 0;
+  for (int shift = 32; shift > 0; shift >>= 1) {
+    if ((x >> (64 - shift)) == 0) {
+      x <<= shift;
+      n += shift;
+    }
+  }
+  return n;
+}
+
+// Eisel-Lemire: mant * 10^exp10 rounded to the nearest double, using a 128
+// bit approximation of the power of ten. Returns false if the result cannot
+// be decided that way (halfway cases, subnormals, overflow).
+static bool eisel_lemire(uint64_t mant, int exp10, uint64_t *pbits) {
+  if (exp10 < POW10_MIN_EXP || exp10 > POW10_MAX_EXP)
+    return false;
+
+  int clz = count_leading_zeros(mant);
+  mant <<= clz;
+  // floor(log2(10) * exp10) + 64 + bias.
+  int exp2 = ((217706 * exp10) >> 16) + 64 + EXP_BIAS - clz;
+
+  const uint64_t *pow10 = kPow10Table[exp10 - POW10_MIN_EXP];
+  uint64_t lo, hi = mul128(mant, pow10[0], &lo);
+  if ((hi & 0x1ff) == 0x1ff && lo + mant < mant) {
+    // The truncated product may be off by one in the lowest bits:
+    // take the low half of the power into account.
+    uint64_t ylo, yhi = mul128(mant, pow10[1], &ylo);
+    uint64_t merged_lo = lo + yhi;
+    if (merged_lo < lo)
+      ++hi;
+    if ((hi & 0x1ff) == 0x1ff && merged_lo + 1 == 0 && ylo + mant < mant)
+      return false;
+    lo = merged_lo;
+  }
+
+  // Take 54 bits, then round to 53 bits.
+  int msb = (int)(hi >> 63);
+  uint64_t m = hi >> (msb + 9);
+  exp2 -= 1 ^ msb;
+  if (lo == 0 && (hi & 0x1ff) == 0 && (m & 3) == 1)
+    return false;  // Halfway: depends on the truncated bits.
+  m = (m + (m & 1)) >> 1;
+  if ((m >> (MANT_BITS + 1)) != 0) {
+    m >>= 1;
+    ++exp2;
   }
-  *pp = p;
-  return result;
+  if (exp2 <= 0 || exp2 >= EXP_MAX)
+    return false;
+  *pbits = ((uint64_t)exp2 << MANT_BITS) | (m & (((uint64_t)1 << MANT_BITS) - 1));
+  return true;
 }
 
-static double strtod_i2(const char *p, const char **pp) {
-  const char *q = p, *r = p;
-  for (;;) {
-    char c = *q;
-    if (!(c >= '0' && c <= '9'))
+// Slow path: arbitrary precision decimal, shifted by powers of two until it
+// fits in the mantissa.
+
+#define DECIMAL_DIGITS  (800)
+#define MAX_SHIFT       (60)  // 10 << MAX_SHIFT fits in uint64_t.
+
+typedef struct {
+  unsigned char d[DECIMAL_DIGITS];  // Digits (0-9), without leading zeros.
+  int nd;  // Number of digits.
+  int dp;  // Decimal point: value = 0.d[0]d[1]... * 10^dp.
+  bool trunc;  // Nonzero digits were discarded.
+} Decimal;
+
+static void decimal_trim(Decimal *a) {
+  while (a->nd > 0 && a->d[a->nd - 1] == 0)
+    --a->nd;
+  if (a->nd == 0)
+    a->dp = 0;
+}
+
+static void decimal_right_shift(Decimal *a, int k) {
+  int r = 0, w = 0;
+  uint64_t n = 0;
+  for (; (n >> k) == 0; ++r) {
+    if (r >= a->nd) {
+      if (n == 0) {
+        a->nd = 0;
+        return;
+      }
+      for (; (n >> k) == 0; ++r)
+        n *= 10;
       break;
-    ++q;
-    if (c != '0')
-      r = q;
+    }
+    n = n * 10 + a->d[r];
+  }
+  a->dp -= r - 1;
+
+  uint64_t mask = ((uint64_t)1 << k) - 1;
+  for (; r < a->nd; ++r) {
+    a->d[w++] = n >> k;
+    n = (n & mask) * 10 + a->d[r];
+  }
+  for (; n > 0; n = (n & mask) * 10) {
+    unsigned char dig = n >> k;
+    if (w < DECIMAL_DIGITS)
+      a->d[w++] = dig;
+    else if (dig > 0)
+      a->trunc = true;
+  }
+  a->nd = w;
+  decimal_trim(a);
+}
+
+static void decimal_left_shift(Decimal *a, int k) {
+  // Produce the digits from the lowest one into a temporary buffer.
+  unsigned char buf[DECIMAL_DIGITS + 20];
+  int w = sizeof(buf);
+  uint64_t n = 0;
+  for (int r = a->nd; --r >= 0 || n > 0;) {
+    if (r >= 0)
+      n += (uint64_t)a->d[r] << k;
+    buf[--w] = n % 10;
+    n /= 10;
+  }
+
+  int nd = sizeof(buf) - w;
+  a->dp += nd - a->nd;
+  if (nd > DECIMAL_DIGITS) {
+    for (int i = DECIMAL_DIGITS; i < nd; ++i) {
+      if (buf[w + i] != 0)
+        a->trunc = true;
+    }
+    nd = DECIMAL_DIGITS;
+  }
+  memcpy(a->d, &buf[w], nd);
+  a->nd = nd;
+  decimal_trim(a);
+}
+
+static void decimal_shift(Decimal *a, int k) {
+  if (a->nd == 0)
+    return;
+  for (; k > MAX_SHIFT; k -= MAX_SHIFT)
+    decimal_left_shift(a, MAX_SHIFT);
+  if (k > 0)
+    decimal_left_shift(a, k);
+  for (; k < -MAX_SHIFT; k += MAX_SHIFT)
+    decimal_right_shift(a, MAX_SHIFT);
+  if (k < 0)
+    decimal_right_shift(a, -k);
+}
+
+// Integer part, rounded half to even.
+static uint64_t decimal_rounded_integer(const Decimal *a) {
+  uint64_t n = 0;
+  int i;
+  for (i = 0; i < a->dp && i < a->nd; ++i)
+    n = n * 10 + a->d[i];
+  for (; i < a->dp; ++i)
+    n *= 10;
+  if (a->dp >= 0 && a->dp < a->nd) {
+    unsigned char d = a->d[a->dp];
+    if (d > 5 || (d == 5 && (a->trunc || a->dp + 1 < a->nd || (n & 1) != 0)))
+      ++n;
+  }
+  return n;
+}
+
+static uint64_t decimal_to_bits(Decimal *a) {
+  static const int kPowTab[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+  const int npowtab = sizeof(kPowTab) / sizeof(*kPowTab);
+
+  if (a->nd == 0 || a->dp < -330)
+    return 0;
+  if (a->dp > 310)
+    return (uint64_t)EXP_MAX << MANT_BITS;
+
+  // Scale into [0.5, 1).
+  int exp = 0;
+  while (a->dp > 0) {
+    int n = a->dp >= npowtab ? 27 : kPowTab[a->dp];
+    decimal_shift(a, -n);
+    exp += n;
+  }
+  while (a->dp < 0 || (a->dp == 0 && a->d[0] < 5)) {
+    int n = -a->dp >= npowtab ? 27 : kPowTab[-a->dp];
+    decimal_shift(a, n);
+    exp -= n;
   }
+  --exp;  // Into [1, 2).
 
-  double result = 0;
-  for (size_t order = r - p; r > p; --order) {
-    char c = *(--r);
-    result += (c - '0') / ipow(10, order);
+  // Subnormal: shift so that the exponent is the minimum.
+  if (exp < 1 - EXP_BIAS) {
+    decimal_shift(a, -(1 - EXP_BIAS - exp));
+    exp = 1 - EXP_BIAS;
+  }
+  if (exp + EXP_BIAS >= EXP_MAX)
+    return (uint64_t)EXP_MAX << MANT_BITS;
+
+  decimal_shift(a, MANT_BITS + 1);
+  uint64_t mant = decimal_rounded_integer(a);
+  if (mant == (uint64_t)2 << MANT_BITS) {
+    mant >>= 1;
+    if (++exp + EXP_BIAS >= EXP_MAX)
+      return (uint64_t)EXP_MAX << MANT_BITS;
+  }
+  if ((mant & ((uint64_t)1 << MANT_BITS)) == 0)
+    exp = -EXP_BIAS;  // Subnormal.
+  return ((uint64_t)(exp + EXP_BIAS) << MANT_BITS) | (mant & (((uint64_t)1 << MANT_BITS) - 1));
+}
+
+static uint64_t slow_strtod(const char *p, long exp10) {
+  Decimal a;
+  a.nd = a.dp = 0;
+  a.trunc = false;
+  bool dot = false;
+  for (;; ++p) {
+    char c = *p;
+    if (c == '.' && !dot) {
+      dot = true;
+      a.dp = a.nd;
+      continue;
+    }
+    if (!isdigit(c))
+      break;
+    if (c == '0' && a.nd == 0) {
+      --a.dp;  // Leading zero.
+    } else if (a.nd < DECIMAL_DIGITS) {
+      a.d[a.nd++] = c - '0';
+    } else if (c != '0') {
+      a.trunc = true;
+    }
   }
-  *pp = q;
-  return result;
+  if (!dot)
+    a.dp = a.nd;
+  a.dp += exp10;
+  decimal_trim(&a);
+  return decimal_to_bits(&a);
 }
 
 double strtod(const char* /*restrict*/ p, char ** /*restrict*/ pp) {
@@ -75,35 +298,88 @@ double strtod(const char* /*restrict*/ p, char ** /*restrict*/ pp) {
     }
   }
 
-  const char *op = p;
-  double result = strtod_i(p, &p);
-  if (*p == '.') {
-    const char *q = p + 1;
-    double frac = strtod_i2(q, &p);
-    result += frac;
+  // Keep the first significant digits in `mant`, so that the value is
+  // approximately mant * 10^exp10.
+  const char *digits = p;
+  uint64_t mant = 0;
+  int nd = 0;
+  long exp10 = 0;
+  bool dot = false, any = false, trunc = false;
+  for (;; ++p) {
+    char c = *p;
+    if (c == '.' && !dot) {
+      dot = true;
+      continue;
+    }
+    if (!isdigit(c))
+      break;
+    any = true;
+    if (nd < MAX_MANT_DIGITS) {
+      if (mant != 0 || c != '0') {
+        mant = mant * 10 + (c - '0');
+        ++nd;
+      }
+      if (dot)
+        --exp10;
+    } else {
+      trunc |= c != '0';
+      if (!dot)
+        ++exp10;
+    }
   }
+  if (!any) {
+    if (pp != 0)
+      *pp = (char*)orig;
+    return 0;
+  }
+
+  long exp_part = 0;
   if (*p == 'e' || *p == 'E') {
     const char *q = p + 1;
     bool neg2 = parse_sign(&q);
-    double order = strtod_i(q, &p);
-    if (q == p) {
-      // Error.
-    } else {
-      double k = ipow(10, order);
+    if (isdigit(*q)) {
+      for (; isdigit(*q); ++q) {
+        if (exp_part < 100000)
+          exp_part = exp_part * 10 + (*q - '0');
+      }
       if (neg2)
-        result /= k;
-      else
-        result *= k;
+        exp_part = -exp_part;
+      exp10 += exp_part;
+      p = q;
     }
   }
-  if (p == op)
-    p = orig;
-  if (neg)
-    result = -result;
-
   if (pp != 0)
     *pp = (char*)p;
 
-  return result;
+  uint64_t bits;
+  if (mant == 0) {
+    bits = 0;
+  } else if (!trunc && mant <= ((uint64_t)1 << (MANT_BITS + 1)) &&
+             exp10 >= -22 && exp10 <= 22) {
+    // Both the mantissa and the power of ten are exact, so a single
+    // operation rounds correctly.
+    double result = (double)mant;
+    if (exp10 >= 0)
+      result *= kExactPow10[exp10];
+    else
+      result /= kExactPow10[-exp10];
+    return neg ? -result : result;
+  } else if (exp10 < POW10_MIN_EXP) {
+    bits = 0;
+  } else if (exp10 > POW10_MAX_EXP) {
+    bits = (uint64_t)EXP_MAX << MANT_BITS;
+  } else {
+    uint64_t bits2;
+    if (!eisel_lemire(mant, exp10, &bits) ||
+        // Truncated digits: the value is in [mant, mant + 1) * 10^exp10.
+        (trunc && (!eisel_lemire(mant + 1, exp10, &bits2) || bits != bits2)))
+      bits = slow_strtod(digits, exp_part);
+  }
+
+  if (mant != 0 && (bits == 0 || bits == (uint64_t)EXP_MAX << MANT_BITS))
+    errno = ERANGE;
+  if (neg)
+    bits |= SIGN_BIT;
+  return bits_to_double(bits);
 }
 #endif
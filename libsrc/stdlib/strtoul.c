@@ -1,10 +1,15 @@
 #include "stdlib.h"
+#include "ctype.h"  // isspace
 #include "limits.h"  // CHAR_BIT
 
 extern unsigned long long strtoull_sub(const char *p, char **pp, int base, unsigned long long max);
 
 unsigned long strtoul(const char *p, char **pp, int base) {
   const char *orig = p;
+
+  for (; isspace(*p); ++p)
+    ;
+
   if (*p == '+')
     ++p;
   char *q;
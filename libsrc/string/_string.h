@@ -0,0 +1,26 @@
+#pragma once
+
+#include "stdbool.h"
+#include "stddef.h"  // size_t
+#include "stdint.h"  // uintptr_t
+
+// Word-at-a-time helpers.
+
+typedef unsigned long Word;
+
+#define WORD_SIZE  (sizeof(Word))
+#define WORD_ONES  ((Word)-1 / 0xff)  // 0x0101...01
+#define WORD_HIGHS  (WORD_ONES * 0x80)  // 0x8080...80
+
+// Non-zero if any byte in the word is zero.
+#define HAS_ZERO(x)  (((x) - WORD_ONES) & ~(x) & WORD_HIGHS)
+
+#define IS_ALIGNED(p)  (((uintptr_t)(p) & (WORD_SIZE - 1)) == 0)
+
+// Block size to use string instructions (`rep movsq`, `rep stosq`) on x64,
+// below which their startup cost is larger than a word loop.
+#define REP_MIN_SIZE  (128)
+
+// Substring search in linear time, shared by strstr and memmem.
+char *_two_way(const unsigned char *h, const unsigned char *z, const unsigned char *n, size_t l,
+               bool terminated);
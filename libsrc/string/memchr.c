@@ -1,8 +1,22 @@
 #include "string.h"
+#include "_string.h"
 
 void *memchr(const void *buf, int c, size_t n) {
-  for (const char *p = buf, *e = p + n; p < e; ++p) {
-    if (*p == c)
+  const unsigned char *p = buf;
+  unsigned char ch = c;
+  for (; n > 0 && !IS_ALIGNED(p); --n, ++p) {
+    if (*p == ch)
+      return (void*)p;
+  }
+
+  Word mask = WORD_ONES * ch;
+  for (; n >= WORD_SIZE; n -= WORD_SIZE, p += WORD_SIZE) {
+    if (HAS_ZERO(*(const Word*)p ^ mask))
+      break;
+  }
+
+  for (; n > 0; --n, ++p) {
+    if (*p == ch)
       return (void*)p;
   }
   return NULL;
@@ -1,13 +1,19 @@
 #include "string.h"
+#include "_string.h"
 
 int memcmp(const void *buf1, const void *buf2, size_t n) {
   const unsigned char *p = buf1;
   const unsigned char *q = buf2;
-  int d;
-  for (size_t i = 0; i < n; ++i, ++p, ++q) {
-    d = (int)*(unsigned char*)p - (int)*(unsigned char*)q;
-    if (d != 0)
+  // Skip equal words; x64 and aarch64 allow unaligned access.
+  for (; n >= WORD_SIZE; n -= WORD_SIZE, p += WORD_SIZE, q += WORD_SIZE) {
+    if (*(const Word*)p != *(const Word*)q)
       break;
   }
-  return d;
+
+  for (; n > 0; --n, ++p, ++q) {
+    int d = (int)*p - (int)*q;
+    if (d != 0)
+      return d;
+  }
+  return 0;
 }
@@ -1,4 +1,21 @@
 #include "string.h"
+#include "_string.h"
+
+#if defined(__x86_64__)
+static void copy_words(void *dst, const void *src, size_t count) {
+#if defined(__GNUC__)
+  // Bind the registers explicitly: the function can be inlined.
+  __asm volatile("rep movsq"
+                 : "+D"(dst), "+S"(src), "+c"(count)
+                 :
+                 : "memory");
+#else
+  __asm("mov %rdx, %rcx\n"
+        "rep\n"
+        "movsq");
+#endif
+}
+#endif
 
 void *memcpy(void *dst, const void *src, size_t n) {
 #if defined(__WASM)
@@ -13,8 +30,22 @@ void *memcpy(void *dst, const void *src, size_t n) {
       S(OP_LOCAL_GET) ",2,"  // local.get 2
       S(OP_EXTENSION) "," S(OPEX_MEMORY_COPY) ",0,0");  // memory.copy
 #else
-  const char *s = src;
-  char *d = dst;
+  const unsigned char *s = src;
+  unsigned char *d = dst;
+#if defined(__x86_64__)
+  if (n >= REP_MIN_SIZE) {
+    for (; !IS_ALIGNED(d); --n)
+      *d++ = *s++;
+    size_t m = n & -WORD_SIZE;
+    copy_words(d, s, m / WORD_SIZE);
+    s += m;
+    d += m;
+    n -= m;
+  }
+#endif
+  // Copy a word at a time; x64 and aarch64 allow unaligned access.
+  for (; n >= WORD_SIZE; n -= WORD_SIZE, s += WORD_SIZE, d += WORD_SIZE)
+    *(Word*)d = *(const Word*)s;
   while (n-- > 0)
     *d++ = *s++;
 #endif
@@ -0,0 +1,121 @@
+#include "string.h"
+#include "_string.h"
+
+#define BITS_PER_WORD  (sizeof(Word) * 8)
+
+static size_t max_suffix(const unsigned char *n, size_t l, bool rev, size_t *pperiod) {
+  // Indices are offset by one so that the start (-1) fits in size_t.
+  size_t ip = 0, jp = 1, k = 1, p = 1;
+  while (jp + k <= l) {
+    unsigned char a = n[ip + k - 1], b = n[jp + k - 1];
+    if (a == b) {
+      if (k == p) {
+        jp += p;
+        k = 1;
+      } else {
+        ++k;
+      }
+    } else if (rev ? a < b : a > b) {
+      jp += k;
+      k = 1;
+      p = jp - ip;
+    } else {
+      ip = jp++;
+      k = p = 1;
+    }
+  }
+  *pperiod = p;
+  return ip;
+}
+
+// Two-Way string matching (Crochemore and Perrin), combined with a skip
+// on the last byte of the window.
+// If `terminated` is true, the haystack ends at the first nul byte and
+// `z` is only a lower bound of its end, which is extended lazily.
+char *_two_way(const unsigned char *h, const unsigned char *z, const unsigned char *n, size_t l,
+               bool terminated) {
+  Word byteset[256 / BITS_PER_WORD];
+  size_t shift[256];
+  memset(byteset, 0, sizeof(byteset));
+  for (size_t i = 0; i < l; ++i) {
+    byteset[n[i] / BITS_PER_WORD] |= (Word)1 << (n[i] % BITS_PER_WORD);
+    shift[n[i]] = i + 1;
+  }
+
+  // Critical factorization: `ms` is the length of the left half.
+  size_t p, p2;
+  size_t ms = max_suffix(n, l, false, &p);
+  size_t ms2 = max_suffix(n, l, true, &p2);
+  if (ms2 > ms) {
+    ms = ms2;
+    p = p2;
+  }
+
+  // `mem` is the prefix length known to match after a shift by the period.
+  size_t mem0;
+  if (memcmp(n, n + p, ms) == 0) {
+    mem0 = l - p;
+  } else {
+    mem0 = 0;
+    p = ms > l - ms ? ms : l - ms + 1;
+  }
+
+  for (size_t mem = 0;;) {
+    if ((size_t)(z - h) < l) {
+      if (!terminated)
+        return NULL;
+      size_t grow = l | 63;
+      const unsigned char *e = memchr(z, '\0', grow);
+      if (e != NULL) {
+        z = e;
+        if ((size_t)(z - h) < l)
+          return NULL;
+      } else {
+        z += grow;
+      }
+    }
+
+    unsigned char c = h[l - 1];
+    if (!(byteset[c / BITS_PER_WORD] & ((Word)1 << (c % BITS_PER_WORD)))) {
+      h += l;
+      mem = 0;
+      continue;
+    }
+    size_t k = l - shift[c];
+    if (k > 0) {
+      h += k < mem ? mem : k;
+      mem = 0;
+      continue;
+    }
+
+    // Right half.
+    for (k = ms > mem ? ms : mem; k < l && n[k] == h[k]; ++k)
+      ;
+    if (k < l) {
+      h += k - ms + 1;
+      mem = 0;
+      continue;
+    }
+    // Left half.
+    for (k = ms; k > mem && n[k - 1] == h[k - 1]; --k)
+      ;
+    if (k <= mem)
+      return (char*)h;
+    h += p;
+    mem = mem0;
+  }
+}
+
+void *memmem(const void *haystack, size_t hlen, const void *needle, size_t nlen) {
+  const unsigned char *h = haystack, *n = needle;
+  if (nlen == 0)
+    return (void*)h;
+  if (hlen < nlen)
+    return NULL;
+
+  h = memchr(h, *n, hlen - nlen + 1);
+  if (h == NULL || nlen == 1)
+    return (void*)h;
+  hlen -= h - (const unsigned char*)haystack;
+  return _two_way(h, h + hlen, n, nlen, false);
+}
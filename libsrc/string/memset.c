@@ -1,4 +1,22 @@
 #include "string.h"
+#include "_string.h"
+
+#if defined(__x86_64__)
+static void fill_words(void *dst, size_t count, unsigned long pattern) {
+#if defined(__GNUC__)
+  // Bind the registers explicitly: the function can be inlined.
+  __asm volatile("rep stosq"
+                 : "+D"(dst), "+c"(count)
+                 : "a"(pattern)
+                 : "memory");
+#else
+  __asm("mov %rsi, %rcx\n"
+        "mov %rdx, %rax\n"
+        "rep\n"
+        "stosq");
+#endif
+}
+#endif
 
 void *memset(void *buf, int val, size_t size) {
 #if defined(__WASM)
@@ -15,7 +33,22 @@ void *memset(void *buf, int val, size_t size) {
 #else
   unsigned char *p = buf;
   unsigned char v = val;
-  for (size_t i = 0; i < size; ++i)
+  for (; size > 0 && !IS_ALIGNED(p); --size)
+    *p++ = v;
+
+  Word w = WORD_ONES * v;
+#if defined(__x86_64__)
+  if (size >= REP_MIN_SIZE) {
+    size_t m = size & -WORD_SIZE;
+    fill_words(p, m / WORD_SIZE, w);
+    p += m;
+    size -= m;
+  }
+#endif
+  for (; size >= WORD_SIZE; size -= WORD_SIZE, p += WORD_SIZE)
+    *(Word*)p = w;
+
+  while (size-- > 0)
     *p++ = v;
 #endif
   return buf;
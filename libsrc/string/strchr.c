@@ -1,8 +1,24 @@
 #include "string.h"
+#include "_string.h"
 
 char *strchr(const char *s, int c) {
-  for (; *s != '\0'; ++s)
-    if (*s == c)
+  unsigned char ch = c;
+  for (; !IS_ALIGNED(s); ++s) {
+    if (*(unsigned char*)s == ch)
       return (char*)s;
-  return 0;
+    if (*s == '\0')
+      return NULL;
+  }
+
+  Word mask = WORD_ONES * ch;
+  const Word *w = (const Word*)s;
+  for (Word x; x = *w, !HAS_ZERO(x) && !HAS_ZERO(x ^ mask); )
+    ++w;
+
+  for (s = (const char*)w; ; ++s) {
+    if (*(unsigned char*)s == ch)
+      return (char*)s;
+    if (*s == '\0')
+      return NULL;
+  }
 }
@@ -1,8 +1,19 @@
 #include "string.h"
+#include "_string.h"
 
 size_t strlen(const char *s) {
   const char *p;
-  for (p = s; *p != '\0'; ++p)
+  for (p = s; !IS_ALIGNED(p); ++p) {
+    if (*p == '\0')
+      return p - s;
+  }
+
+  // Aligned word never crosses a page, so reading beyond the terminator is safe.
+  const Word *w = (const Word*)p;
+  while (!HAS_ZERO(*w))
+    ++w;
+
+  for (p = (const char*)w; *p != '\0'; ++p)
     ;
   return p - s;
 }
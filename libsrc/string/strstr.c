@@ -1,9 +1,13 @@
 #include "string.h"
+#include "_string.h"
 
 char *strstr(const char *s1, const char *s2) {
-  for (size_t len = strlen(s2); *s1 != '\0'; ++s1) {
-    if (strncmp(s1, s2, len) == 0)
-      return (char*)s1;
-  }
-  return NULL;
+  const unsigned char *n = (const unsigned char*)s2;
+  if (*n == '\0')
+    return (char*)s1;
+
+  const unsigned char *h = (const unsigned char*)strchr(s1, *n);
+  if (h == NULL || n[1] == '\0')
+    return (char*)h;
+  return _two_way(h, h + 1, n, strlen(s2), true);
 }
@@ -9,6 +9,20 @@
 #include "./xtest.h"
 
 #define EXPECT(expected, actual)  EXPECT_DEQ(expected, actual)
+#define EXPECT_ULP(expected, actual)  expect_ulp(#actual, expected, actual)
+
+static int64_t ordered_bits(double x) {
+  int64_t i = *(int64_t*)&x;
+  return i < 0 ? -(i & ~SIGN_MASK) : i;
+}
+
+// Accepts an error of 1ulp from the correctly rounded result.
+static void expect_ulp(const char *title, double expected, double actual) {
+  begin_test(title);
+  int64_t e = ordered_bits(expected), a = ordered_bits(actual);
+  if (!(e >= a - 1 && e <= a + 1))
+    fail("%s, %.17g expected, but got %.17g\n", title, expected, actual);
+}
 
 TEST(misc) {
   EXPECT_NEAR(1.41421356, sqrt(2.0));
@@ -30,6 +44,85 @@ TEST(misc) {
   EXPECT_NEAR(-1.14, fmod(-12.34, -5.6));
 } END_TEST()
 
+TEST(sin_cos) {
+  EXPECT_ULP(0.8414709848078965, sin(1.0));
+  EXPECT_ULP(0.1411200080598672, sin(3.0));
+  EXPECT_ULP(-0.479425538604203, sin(-0.5));
+  EXPECT_ULP(-0.34999350217129294, sin(1e6));
+  EXPECT_ULP(-0.8522008497671888, sin(1e22));
+  EXPECT_ULP(-0.8178819121159085, sin(1e300));
+  EXPECT_ULP(0.8775825618903728, cos(0.5));
+  EXPECT_ULP(-0.8390715290764524, cos(10.0));
+  EXPECT_ULP(6.123233995736766e-17, cos(1.5707963267948966));
+  EXPECT_ULP(0.523214785395139, cos(1e22));
+  EXPECT_ULP(-0.5753861119575491, cos(1e300));
+  EXPECT_ULP(1.5574077246549023, tan(1.0));
+  EXPECT_ULP(0.9999999999999999, tan(0.7853981633974483));
+  EXPECT_ULP(1.633123935319537e+16, tan(1.5707963267948966));
+  EXPECT_ULP(-0.4116229628832498, tan(1e100));
+  EXPECT_NAN(sin(HUGE_VAL));
+  EXPECT_NAN(cos(NAN));
+
+  bool ok = true;
+  for (int i = 0; i < 10000; ++i) {
+    double x = i * 0.0123 - 60;
+    double s = sin(x), c = cos(x);
+    double d = s * s + c * c - 1;
+    ok = ok && d >= -4e-16 && d <= 4e-16 && sin(-x) == -s && cos(-x) == c;
+  }
+  EXPECT_TRUE(ok);
+} END_TEST()
+
+TEST(exp_log) {
+  EXPECT_ULP(2.718281828459045, exp(1.0));
+  EXPECT_ULP(0.6065306597126334, exp(-0.5));
+  EXPECT_ULP(1.0000000001, exp(1e-10));
+  EXPECT_ULP(1.6549840276802644e+308, exp(709.7));
+  EXPECT_ULP(2.006132305331306e-308, exp(-708.5));
+  EXPECT_ULP(5e-324, exp(-745.0));
+  EXPECT(HUGE_VAL, exp(710.0));
+  EXPECT(0.0, exp(-746.0));
+  EXPECT(0.0, exp(-HUGE_VAL));
+
+  EXPECT_ULP(0.6931471805599453, log(2.0));
+  EXPECT_ULP(2.302585092994046, log(10.0));
+  EXPECT_ULP(-0.6931471805599453, log(0.5));
+  EXPECT_ULP(1.000000082690371e-10, log(1.0000000001));
+  EXPECT_ULP(-713.8013788281542, log(1e-310));
+  EXPECT_ULP(709.1962086421661, log(1e308));
+  EXPECT(0.0, log(1.0));
+  EXPECT(-HUGE_VAL, log(0.0));
+  EXPECT_NAN(log(-1.0));
+
+  bool ok = true;
+  for (int i = 0; i <= 10000; ++i) {
+    double x = 0.5 + i * (1.5 / 10000);  // |log(x)| < 1 keeps its rounding error within 1ulp.
+    int64_t d = ordered_bits(exp(log(x))) - ordered_bits(x);
+    ok = ok && d >= -2 && d <= 2;
+  }
+  EXPECT_TRUE(ok);
+} END_TEST()
+
+TEST(pow) {
+  EXPECT_ULP(1.4142135623730951, pow(2.0, 0.5));
+  EXPECT_ULP(0.001, pow(10.0, -3.0));
+  EXPECT_ULP(1.858729691979481, pow(1.2, 3.4));
+  EXPECT_ULP(2.6881038582144647e+43, pow(1.0000001, 1e9));
+  EXPECT_ULP(2.8513900904532174e-275, pow(0.9, 6000.0));
+  EXPECT(5e-324, pow(2.0, -1074.0));
+  EXPECT(-8.0, pow(-2.0, 3.0));
+  EXPECT(0.25, pow(-2.0, -2.0));
+  EXPECT_NAN(pow(-8.0, 1.0 / 3));
+  EXPECT(1.0, pow(NAN, 0.0));
+  EXPECT(1.0, pow(1.0, NAN));
+  EXPECT(1.0, pow(-1.0, HUGE_VAL));
+  EXPECT(HUGE_VAL, pow(0.0, -1.0));
+  EXPECT(-HUGE_VAL, pow(-0.0, -3.0));
+  EXPECT(0.0, pow(0.5, HUGE_VAL));
+  EXPECT(HUGE_VAL, pow(2.0, 1024.0));
+  EXPECT(-HUGE_VAL, pow(-HUGE_VAL, 3.0));
+} END_TEST()
+
 TEST(floor) {
   EXPECT(1.0, floor(1.999999));
   EXPECT(0.0, floor(0.999999));
@@ -114,6 +207,9 @@ TEST(isnan) {
 int main() {
   return RUN_ALL_TESTS(
     test_misc,
+    test_sin_cos,
+    test_exp_log,
+    test_pow,
     test_floor,
     test_ceil,
     test_modf,
@@ -108,6 +108,15 @@ TEST(vsnprintf) {
   EXPECT("Float:0.000000", "Float:0.000000", 0.0);
   EXPECT("inf:inf", "inf:%f", HUGE_VAL);
   EXPECT("nan:nan", "nan:%f", NAN);
+  EXPECT("Round:2 0 1.00 2.67", "Round:%.0f %.0f %.2f %.2f", 2.5, 0.5, 1.005, 2.675);  // Exact value, ties to even.
+  EXPECT("Large:1000000000000000000000.000000", "Large:%f", 1e21);
+  EXPECT("Small:0.000000000000000000001000", "Small:%.24f", 1e-21);
+  EXPECT("Width:[   1.500|1.500   |-001.500]", "Width:[%8.3f|%-8.3f|%08.3f]", 1.5, 1.5, -1.5);
+  EXPECT("Negative zero:-0.0", "Negative zero:%.1f", -0.0);
+
+  EXPECT("Exponent:1.234568e+08", "Exponent:%e", 123456789.0);
+  EXPECT("Exponent:5E-324", "Exponent:%.0E", 5e-324);
+  EXPECT("Exponent:1.797693e+308", "Exponent:%e", 1.7976931348623157e308);
 
   EXPECT("Scientific:0.999999", "Scientific:%g", 0.999999);
   EXPECT("Scientific:1", "Scientific:%g", 0.9999999);
@@ -115,10 +124,12 @@ TEST(vsnprintf) {
   EXPECT("Scientific:0", "Scientific:%g", 0.0);
   EXPECT("Scientific:123400", "Scientific:%g", 1.234e5);
   EXPECT("Scientific:1.234e+06", "Scientific:%g", 1.234e6);
-  // EXPECT("Scientific:0.0001234", "Scientific:%g", 1.234e-4);
+  EXPECT("Scientific:0.0001234", "Scientific:%g", 1.234e-4);
   EXPECT("Scientific:1.234e-05", "Scientific:%g", 1.234e-5);
   EXPECT("Scientific:-inf", "Scientific:%g", -HUGE_VAL);
   EXPECT("Scientific:nan", "Scientific:%g", NAN);
+  EXPECT("RoundTrip:0.10000000000000001", "RoundTrip:%.17g", 0.1);
+  EXPECT("RoundTrip:9.9999999999999992e+22", "RoundTrip:%.17g", 1e23);
 #endif
 #undef EXPECT
 } END_TEST()
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 
+#include <errno.h>
 #include <limits.h>
 
 #include "./xtest.h"
@@ -69,6 +70,16 @@ TEST(strtoll) {
   EXPECT_EQ(987, strtoll(s="987", NULL, 10));  // Null accepted
 } END_TEST()
 
+TEST(strtoul) {
+  char *p, *s;
+  EXPECT_EQ(123, strtoul(s="123", &p, 10));
+  EXPECT_PTREQ(s + 3, p);
+  EXPECT_EQ(4567, strtoul(s="\t\n  004567.789", &p, 10));
+  EXPECT_PTREQ(s + 10, p);
+  EXPECT_EQ(0, strtoul(s="+ 333", &p, 10));
+  EXPECT_PTREQ(s, p);
+} END_TEST()
+
 TEST(strtoull) {
   char *p, *s;
   EXPECT_EQ(123, strtoull(s="123", &p, 10));
@@ -104,9 +115,142 @@ TEST(strtod) {
   EXPECT_EQ(0, strtod(s="+ 333.33", &p));
   EXPECT_PTREQ(s, p);
   EXPECT_DEQ(987.06125, strtod(s="987.06125", NULL));  // Null accepted
+
+  // Correctly rounded.
+  EXPECT_DEQ(0.1, strtod("0.1", NULL));
+  EXPECT_DEQ(1e23, strtod("1e23", NULL));
+  EXPECT_DEQ(9007199254740992.0, strtod("9007199254740993", NULL));  // Tie, to even.
+  EXPECT_DEQ(9007199254740994.0, strtod("9007199254740993.0000000000000000000001", NULL));
+  EXPECT_DEQ(1.2345678901234568e+29, strtod("123456789012345678901234567890", NULL));
+  EXPECT_DEQ(2.2250738585072014e-308, strtod("2.2250738585072012e-308", NULL));
+  EXPECT_DEQ(4.9406564584124654e-324, strtod("4.9e-324", NULL));
+  EXPECT_DEQ(1.7976931348623157e308, strtod("1.7976931348623157e308", NULL));
+
+  errno = 0;
+  EXPECT_DEQ(HUGE_VAL, strtod("1e309", NULL));
+  EXPECT_EQ(ERANGE, errno);
+  errno = 0;
+  EXPECT_DEQ(0.0, strtod("1e-400", NULL));
+  EXPECT_EQ(ERANGE, errno);
 #endif
 } END_TEST()
 
+TEST(malloc) {
+  static const size_t kSizes[] = {0, 1, 15, 16, 17, 100, 128, 129, 1000, 4096, 70000, 200000, 1 << 20};
+  char *blocks[sizeof(kSizes) / sizeof(*kSizes)];
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(*kSizes); ++i) {
+    char *p = malloc(kSizes[i]);
+    EXPECT_NOT_NULL(p);
+    EXPECT_EQ(0, (intptr_t)p & 15);
+    memset(p, (int)i, kSizes[i]);
+    blocks[i] = p;
+  }
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(*kSizes); ++i) {
+    size_t n = kSizes[i];
+    EXPECT_TRUE(n == 0 || (blocks[i][0] == (char)i && blocks[i][n - 1] == (char)i));
+    free(blocks[i]);
+  }
+
+  char *p = malloc(40);
+  free(p);
+  EXPECT_PTREQ(p, malloc(48));  // Same size class is reused.
+
+  free(NULL);
+
+  char *q = malloc(10);
+  strcpy(q, "123456789");
+  q = realloc(q, 300000);
+  EXPECT_STREQ("realloc small to large", "123456789", q);
+  q = realloc(q, 5);
+  EXPECT_EQ(0, memcmp(q, "12345", 5));
+  free(q);
+} END_TEST()
+
+TEST(realloc) {
+  // Grow a buffer step by step like getline does, across the mmap threshold.
+  size_t size = 16;
+  char *buf = malloc(size);
+  for (size_t i = 0; i < size; ++i)
+    buf[i] = (char)i;
+  while (size < (1 << 21)) {
+    size_t old = size;
+    size *= 2;
+    buf = realloc(buf, size);
+    EXPECT_NOT_NULL(buf);
+    for (size_t i = old; i < size; ++i)
+      buf[i] = (char)i;
+  }
+  bool ok = true;
+  for (size_t i = 0; i < size; ++i)
+    ok = ok && buf[i] == (char)i;
+  EXPECT_TRUE(ok);
+
+  char *p = realloc(buf, 100);  // Shrink never moves.
+  EXPECT_PTREQ(buf, p);
+  EXPECT_EQ(99, p[99]);
+  free(p);
+
+  p = malloc(32);
+  strcpy(p, "abc");
+  EXPECT_PTREQ(p, realloc(p, 20));
+  free(p);
+} END_TEST()
+
+static int compare_int(const void *pa, const void *pb) {
+  int a = *(const int*)pa, b = *(const int*)pb;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static int compare_bytes3(const void *pa, const void *pb) {
+  return memcmp(pa, pb, 3);
+}
+
+TEST(qsort) {
+  static int a[1000];
+  const size_t N = sizeof(a) / sizeof(*a);
+  unsigned int r = 1;
+  bool ok = true;
+  // Random, sorted, reversed, all equal and organ pipe.
+  for (int pattern = 0; pattern < 5; ++pattern) {
+    for (size_t n = 0; n <= N; n += n < 40 ? 1 : 97) {
+      for (size_t i = 0; i < n; ++i) {
+        r = r * 1103515245U + 12345U;
+        switch (pattern) {
+        case 0:  a[i] = (r >> 8) % 100; break;
+        case 1:  a[i] = i; break;
+        case 2:  a[i] = n - i; break;
+        case 3:  a[i] = 7; break;
+        default: a[i] = i < n / 2 ? i : n - i; break;
+        }
+      }
+      long sum = 0;
+      for (size_t i = 0; i < n; ++i)
+        sum += a[i];
+
+      qsort(a, n, sizeof(*a), compare_int);
+
+      for (size_t i = 1; i < n; ++i)
+        ok = ok && a[i - 1] <= a[i];
+      for (size_t i = 0; i < n; ++i)
+        sum -= a[i];
+      ok = ok && sum == 0;
+    }
+  }
+  EXPECT_TRUE(ok);
+
+  // Element size which is not a multiple of the word size.
+  static char b[300 * 3];
+  for (size_t i = 0; i < sizeof(b); ++i) {
+    r = r * 1103515245U + 12345U;
+    b[i] = 'a' + (r >> 8) % 4;
+  }
+  qsort(b, sizeof(b) / 3, 3, compare_bytes3);
+  ok = true;
+  for (size_t i = 3; i < sizeof(b); i += 3)
+    ok = ok && memcmp(&b[i - 3], &b[i], 3) <= 0;
+  EXPECT_TRUE(ok);
+} END_TEST()
+
 int main() {
   return RUN_ALL_TESTS(
     test_atoi,
@@ -114,7 +258,11 @@ int main() {
     test_atoll,
     test_atof,
     test_strtoll,
+    test_strtoul,
     test_strtoull,
     test_strtod,
+    test_malloc,
+    test_realloc,
+    test_qsort,
   );
 }
@@ -0,0 +1,172 @@
+#include <string.h>
+
+#include "./xtest.h"
+
+// Run each check at every alignment and at lengths around word boundaries.
+#define FOR_ALIGN_LEN(body) \
+  for (size_t align = 0; align < 8; ++align) \
+    for (size_t len = 0; len < 300; len += len < 40 ? 1 : 37) { body }
+
+static char buf1[512], buf2[512];
+
+static void fill(char *p, size_t n, int seed) {
+  for (size_t i = 0; i < n; ++i)
+    p[i] = (char)('a' + (i * 7 + seed) % 26);
+}
+
+TEST(strlen) {
+  bool ok = true;
+  FOR_ALIGN_LEN({
+    fill(buf1, sizeof(buf1), 0);
+    buf1[align + len] = '\0';
+    ok = ok && strlen(buf1 + align) == len;
+  })
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(0, strlen(""));
+} END_TEST()
+
+TEST(strchr) {
+  bool ok = true;
+  FOR_ALIGN_LEN({
+    fill(buf1, sizeof(buf1), 0);
+    buf1[align + len] = '\0';
+    char *s = buf1 + align;
+    for (size_t i = 0; i < len; ++i) {
+      if (strchr(s, s[i]) != memchr(s, s[i], len))
+        ok = false;
+    }
+    ok = ok && strchr(s, '\0') == s + len;
+    ok = ok && strchr(s, 'A') == NULL;
+  })
+  EXPECT_TRUE(ok);
+  EXPECT_PTREQ(NULL, strchr("abc\xff", 'x'));
+  char s[] = "abc\xff";
+  EXPECT_PTREQ(s + 3, strchr(s, 0xff));
+} END_TEST()
+
+TEST(memchr) {
+  bool ok = true;
+  FOR_ALIGN_LEN({
+    memset(buf1, 0, sizeof(buf1));
+    buf1[align + len] = 'x';
+    ok = ok && memchr(buf1 + align, 'x', len) == NULL;
+    ok = ok && memchr(buf1 + align, 'x', len + 1) == buf1 + align + len;
+  })
+  EXPECT_TRUE(ok);
+  char s[] = "ab\x80" "cd";
+  EXPECT_PTREQ(s + 2, memchr(s, 0x80, 5));
+} END_TEST()
+
+TEST(memcmp) {
+  bool ok = true;
+  FOR_ALIGN_LEN({
+    fill(buf1, sizeof(buf1), 3);
+    fill(buf2, sizeof(buf2), 3);
+    ok = ok && memcmp(buf1 + align, buf2 + align, len) == 0;
+    if (len > 0) {
+      buf2[align + len - 1] = '\xff';
+      ok = ok && memcmp(buf1 + align, buf2 + align, len) < 0;
+      ok = ok && memcmp(buf2 + align, buf1 + align, len) > 0;
+    }
+  })
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(0, memcmp("a", "b", 0));
+} END_TEST()
+
+TEST(memcpy) {
+  bool ok = true;
+  FOR_ALIGN_LEN({
+    fill(buf1, sizeof(buf1), 5);
+    memset(buf2, '-', sizeof(buf2));
+    memcpy(buf2 + 1 + align, buf1 + align, len);
+    ok = ok && memcmp(buf2 + 1 + align, buf1 + align, len) == 0;
+    ok = ok && buf2[align] == '-' && buf2[1 + align + len] == '-';
+  })
+  EXPECT_TRUE(ok);
+} END_TEST()
+
+TEST(memset) {
+  bool ok = true;
+  FOR_ALIGN_LEN({
+    memset(buf1, '-', sizeof(buf1));
+    memset(buf1 + 1 + align, 0xa5, len);
+    for (size_t i = 0; i < len; ++i)
+      ok = ok && (unsigned char)buf1[1 + align + i] == 0xa5;
+    ok = ok && buf1[align] == '-' && buf1[1 + align + len] == '-';
+  })
+  EXPECT_TRUE(ok);
+} END_TEST()
+
+static const char *naive_search(const char *h, size_t hlen, const char *n, size_t nlen) {
+  for (size_t i = 0; i + nlen <= hlen; ++i) {
+    if (memcmp(h + i, n, nlen) == 0)
+      return h + i;
+  }
+  return NULL;
+}
+
+TEST(strstr) {
+  // Small alphabets to produce many partial and periodic matches.
+  bool ok = true;
+  unsigned int r = 1;
+  for (int alphabet = 2; alphabet <= 4; ++alphabet) {
+    for (int i = 0; i < 2000; ++i) {
+      size_t hlen = (r >> 8) % 200, nlen = (r >> 16) % 12;
+      for (size_t j = 0; j < hlen; ++j) {
+        r = r * 1103515245U + 12345U;
+        buf1[j] = 'a' + (r >> 16) % alphabet;
+      }
+      buf1[hlen] = '\0';
+      for (size_t j = 0; j < nlen; ++j) {
+        r = r * 1103515245U + 12345U;
+        buf2[j] = 'a' + (r >> 16) % alphabet;
+      }
+      buf2[nlen] = '\0';
+      r = r * 1103515245U + 12345U;
+
+      const char *expected = naive_search(buf1, hlen, buf2, nlen);
+      if (strstr(buf1, buf2) != expected || memmem(buf1, hlen, buf2, nlen) != expected)
+        ok = false;
+    }
+  }
+  EXPECT_TRUE(ok);
+
+  char s[] = "abaababaabab";
+  EXPECT_NULL(strstr("", "a"));
+  EXPECT_PTREQ(s, strstr(s, ""));
+  EXPECT_PTREQ(s, strstr(s, "abaabab"));
+  EXPECT_PTREQ(s + 2, strstr(s, "aab"));
+  EXPECT_PTREQ(s + 4, strstr(s, "babaa"));
+  EXPECT_NULL(strstr(s, "abaababaababa"));
+} END_TEST()
+
+TEST(memmem) {
+  // Worst case for a naive search: many near matches.
+  size_t hlen = sizeof(buf1), nlen = 64;
+  memset(buf1, 'a', hlen);
+  memset(buf2, 'a', nlen);
+  buf2[nlen - 1] = 'b';
+  EXPECT_NULL(memmem(buf1, hlen, buf2, nlen));
+  buf1[hlen - 1] = 'b';
+  EXPECT_PTREQ(buf1 + hlen - nlen, memmem(buf1, hlen, buf2, nlen));
+  EXPECT_PTREQ(buf1, memmem(buf1, hlen, buf2, 0));
+  EXPECT_NULL(memmem(buf1, 3, buf2, 4));
+
+  // Nul bytes are not special.
+  char s[] = "ab\0cd\0ce";
+  EXPECT_PTREQ(s + 2, memmem(s, 8, "\0c", 2));
+  EXPECT_PTREQ(s + 5, memmem(s + 3, 5, "\0ce", 3));
+} END_TEST()
+
+int main() {
+  return RUN_ALL_TESTS(
+    test_strlen,
+    test_strchr,
+    test_memchr,
+    test_memcmp,
+    test_memcpy,
+    test_memset,
+    test_strstr,
+    test_memmem,
+  );
+}
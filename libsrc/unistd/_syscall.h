@@ -18,7 +18,10 @@
 #define __NR_open    2
 #define __NR_close   3
 #define __NR_lseek   8
+#define __NR_mmap    9
+#define __NR_munmap  11
 #define __NR_brk     12
+#define __NR_mremap  25
 #define __NR_ioctl   16
 #define __NR_pipe    22
 #define __NR_dup     32
@@ -53,7 +56,10 @@
 #define __NR_close   57
 #define __NR_lseek   62
 #define __NR_brk     214
-//#define __NR_ioctl   16
+#define __NR_munmap  215
+#define __NR_mremap  216
+#define __NR_mmap    222
+#define __NR_ioctl   29
 #define __NR_pipe2    59
 #define __NR_dup     23
 //#define __NR_clone    220
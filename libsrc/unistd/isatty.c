@@ -1,6 +1,7 @@
 #if !defined(__WASM)
 #include "unistd.h"
 #include "sys/ioctl.h"  // termio
+#include "_syscall.h"  // __NR_ioctl
 
 int isatty(int fd) {
 #if defined(__NR_ioctl)
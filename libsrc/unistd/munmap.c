@@ -0,0 +1,19 @@
+#if !defined(__WASM) && !defined(__APPLE__)
+#include "sys/mman.h"
+#include "_syscall.h"
+#include "errno.h"
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+int munmap(void *addr, size_t length) {
+  int ret;
+  SYSCALL_RET(__NR_munmap, ret);
+  if (ret < 0) {
+    errno = -ret;
+    ret = -1;
+  }
+  return ret;
+}
+#endif
@@ -54,6 +54,10 @@ static void dump_ir(FILE *fp, IR *ir) {
   case IR_CMP:    fprintf(fp, "\tCMP\t"); dump_vreg(fp, ir->opr1); fprintf(fp, " - "); dump_vreg(fp, ir->opr2); fprintf(fp, "\n"); break;
   case IR_NEG:    fprintf(fp, "\tNEG\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = -"); dump_vreg(fp, ir->opr1); fprintf(fp, "\n"); break;
   case IR_BITNOT: fprintf(fp, "\tBITNOT\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = ~"); dump_vreg(fp, ir->opr1); fprintf(fp, "\n"); break;
+  case IR_SQRT:   fprintf(fp, "\tSQRT\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = sqrt "); dump_vreg(fp, ir->opr1); fprintf(fp, "\n"); break;
+  case IR_FABS:   fprintf(fp, "\tFABS\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = fabs "); dump_vreg(fp, ir->opr1); fprintf(fp, "\n"); break;
+  case IR_FLOOR:  fprintf(fp, "\tFLOOR\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = floor "); dump_vreg(fp, ir->opr1); fprintf(fp, "\n"); break;
+  case IR_CEIL:   fprintf(fp, "\tCEIL\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = ceil "); dump_vreg(fp, ir->opr1); fprintf(fp, "\n"); break;
   case IR_COND:   fprintf(fp, "\tCOND\t"); dump_vreg(fp, ir->dst); fprintf(fp, " = %s\n", kCond[ir->cond.kind]); break;
   case IR_JMP:    fprintf(fp, "\tJ%s\t%.*s\n", kCond[ir->jmp.cond], ir->jmp.bb->label->bytes, ir->jmp.bb->label->chars); break;
   case IR_TJMP:
@@ -219,6 +223,10 @@ static void compile1(FILE *ifp, const char *filename, Vector *decls) {
 
 int main(int argc, char *argv[]) {
   int iarg = 1;
+  for (; iarg < argc && argv[iarg][0] == '-'; ++iarg) {
+    if (strncmp(argv[iarg], "-O", 2) == 0)
+      optimize_level = argv[iarg][2] != '\0' ? atoi(&argv[iarg][2]) : 1;
+  }
 
   // Compile.
   init_compiler();
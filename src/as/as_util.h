@@ -0,0 +1,16 @@
+// Assembler: Used by as, and by xcc to assemble compiler output directly
+
+#pragma once
+
+#include <stdio.h>  // FILE
+
+void init_assembler(void);
+void assemble_file(FILE *fp, const char *filename);
+
+// Receive code from the compiler by each instruction: operand texts are parsed one by one,
+// and only directives and inline assembly are joined into lines.
+void assemble_label(const char *label);
+void assemble_op(const char *op, const char **operands, int count);
+
+// Resolve addresses and write an ELF object file (stdout if `ofn` is NULL).
+int output_object(const char *ofn);
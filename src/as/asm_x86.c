@@ -43,7 +43,7 @@ static bool opr_reg8(const Reg *reg) {
 }
 
 static bool assemble_error(const ParseInfo *info, const char *message) {
-  parse_error(info, message);
+  parse_asm_error(info, message);
   return false;
 }
 
@@ -589,6 +589,53 @@ static unsigned char *asm_sqrtsd_xx(Inst *inst, Code *code) {
   return p;
 }
 
+static unsigned char *asm_andpd_xx(Inst *inst, Code *code) {
+  unsigned char sno = inst->src.regxmm - XMM0;
+  unsigned char dno = inst->dst.regxmm - XMM0;
+  short buf[] = {
+    0x66,
+    sno >= 8 || dno >= 8 ? (unsigned char)0x40 | ((sno & 8) >> 3) | ((dno & 8) >> 1) : -1,
+    0x0f,
+    0x54,
+    (unsigned char)0xc0 | ((dno & 7) << 3) | (sno & 7),
+  };
+  unsigned char *p = code->buf;
+  p = put_code_filtered(p, buf, ARRAY_SIZE(buf));
+  return p;
+}
+
+static unsigned char *asm_roundsd_xx(Inst *inst, Code *code) {
+  unsigned char sno = inst->src.regxmm - XMM0;
+  unsigned char dno = inst->dst.regxmm - XMM0;
+  short buf[] = {
+    0x66,
+    sno >= 8 || dno >= 8 ? (unsigned char)0x40 | ((sno & 8) >> 3) | ((dno & 8) >> 1) : -1,
+    0x0f,
+    0x3a,
+    0x0b,
+    (unsigned char)0xc0 | ((dno & 7) << 3) | (sno & 7),
+    (unsigned char)IM8(inst->imm.immediate),
+  };
+  unsigned char *p = code->buf;
+  p = put_code_filtered(p, buf, ARRAY_SIZE(buf));
+  return p;
+}
+
+static unsigned char *asm_movq_rx(Inst *inst, Code *code) {
+  unsigned char sno = opr_regno(&inst->src.reg);
+  unsigned char dno = inst->dst.regxmm - XMM0;
+  short buf[] = {
+    0x66,
+    (unsigned char)0x48 | ((sno & 8) >> 3) | ((dno & 8) >> 1),
+    0x0f,
+    0x6e,
+    (unsigned char)0xc0 | ((dno & 7) << 3) | (sno & 7),
+  };
+  unsigned char *p = code->buf;
+  p = put_code_filtered(p, buf, ARRAY_SIZE(buf));
+  return p;
+}
+
 #endif
 
 static long signed_immediate(long value, enum RegSize size) {
@@ -1381,6 +1428,21 @@ static unsigned char *asm_syscall(Inst *inst, Code *code) {
   return code->buf;
 }
 
+static unsigned char *asm_rep(Inst *inst, Code *code) {
+  MAKE_CODE(inst, code, 0xf3);
+  return code->buf;
+}
+
+static unsigned char *asm_movsq(Inst *inst, Code *code) {
+  MAKE_CODE(inst, code, 0x48, 0xa5);
+  return code->buf;
+}
+
+static unsigned char *asm_stosq(Inst *inst, Code *code) {
+  MAKE_CODE(inst, code, 0x48, 0xab);
+  return code->buf;
+}
+
 ////////////////////////////////////////////////
 
 enum {
@@ -1389,6 +1451,7 @@ enum {
   SRC_REG8_ONLY = 1 << 2,
   SRC_REG64_ONLY = 1 << 3,
   DST_REG64_ONLY = 1 << 4,
+  IMM8_OPERAND = 1 << 5,  // Takes a leading 8bit immediate as the third operand.
 };
 
 typedef unsigned char * (*AsmInstFunc)(Inst *inst, Code *code);
@@ -1434,7 +1497,13 @@ static const AsmInstTable *table[] = {
     {asm_mov_dr, DIRECT, REG},
     {asm_mov_rd, REG, DIRECT},
     {NULL} },
-  [MOVB] = table_movbwlq,  [MOVW] = table_movbwlq,  [MOVL] = table_movbwlq,  [MOVQ] = table_movbwlq,
+  [MOVB] = table_movbwlq,  [MOVW] = table_movbwlq,  [MOVL] = table_movbwlq,
+  [MOVQ] = (const AsmInstTable[]){
+    {asm_movbwlq_imi, IMMEDIATE, INDIRECT},
+#ifndef __NO_FLONUM
+    {asm_movq_rx, REG, REG_XMM, SRC_REG64_ONLY},
+#endif
+    {NULL} },
   [MOVSX] = table_movszx,  [MOVZX] = table_movszx,
   [LEA] = (const AsmInstTable[]){
     {asm_lea_ir, INDIRECT, REG, DST_REG64_ONLY},
@@ -1523,6 +1592,9 @@ static const AsmInstTable *table[] = {
   [POP] = (const AsmInstTable[]){ {asm_pop_r, REG, NOOPERAND, SRC_REG64_ONLY}, {NULL} },
   [INT] = (const AsmInstTable[]){ {asm_int_im, IMMEDIATE, NOOPERAND}, {NULL} },
   [SYSCALL] = (const AsmInstTable[]){ {asm_syscall, NOOPERAND, NOOPERAND}, {NULL} },
+  [REP] = (const AsmInstTable[]){ {asm_rep, NOOPERAND, NOOPERAND}, {NULL} },
+  [MOVSQ] = (const AsmInstTable[]){ {asm_movsq, NOOPERAND, NOOPERAND}, {NULL} },
+  [STOSQ] = (const AsmInstTable[]){ {asm_stosq, NOOPERAND, NOOPERAND}, {NULL} },
 #ifndef __NO_FLONUM
   [MOVSD] = (const AsmInstTable[]){
     {asm_movsd_xx, REG_XMM, REG_XMM},
@@ -1551,6 +1623,8 @@ static const AsmInstTable *table[] = {
   [CVTSD2SS] = (const AsmInstTable[]){ {asm_cvtsd2ss_xx, REG_XMM, REG_XMM}, {NULL} },
   [CVTSS2SD] = (const AsmInstTable[]){ {asm_cvtss2sd_xx, REG_XMM, REG_XMM}, {NULL} },
   [SQRTSD] = (const AsmInstTable[]){ {asm_sqrtsd_xx, REG_XMM, REG_XMM}, {NULL} },
+  [ANDPD] = (const AsmInstTable[]){ {asm_andpd_xx, REG_XMM, REG_XMM}, {NULL} },
+  [ROUNDSD] = (const AsmInstTable[]){ {asm_roundsd_xx, REG_XMM, REG_XMM, IMM8_OPERAND}, {NULL} },
 #endif
 };
 
@@ -1581,7 +1655,9 @@ void assemble_inst(Inst *inst, const ParseInfo *info, Code *code) {
     }
     if (((pt->flag & SRC_REG8_ONLY) && inst->src.reg.size != REG8) ||
         ((pt->flag & SRC_REG64_ONLY) && inst->src.reg.size != REG64) ||
-        ((pt->flag & DST_REG64_ONLY) && inst->dst.reg.size != REG64)) {
+        ((pt->flag & DST_REG64_ONLY) && inst->dst.reg.size != REG64) ||
+        (inst->imm.type != ((pt->flag & IMM8_OPERAND) ? IMMEDIATE : NOOPERAND)) ||
+        ((pt->flag & IMM8_OPERAND) && !is_im8(inst->imm.immediate))) {
       assemble_error(info, "Illegal opeand");
       return;
     }
@@ -90,6 +90,9 @@ enum Opcode {
 
   INT,
   SYSCALL,
+  REP,
+  MOVSQ,
+  STOSQ,
 
 #ifndef __NO_FLONUM
   MOVSD,
@@ -101,6 +104,8 @@ enum Opcode {
   CVTSI2SD,
   CVTTSD2SI,
   SQRTSD,
+  ANDPD,
+  ROUNDSD,
 
   MOVSS,
   ADDSS,
@@ -304,6 +309,7 @@ typedef struct Inst {
   enum Opcode op;
   Operand src;
   Operand dst;
+  Operand imm;  // Leading immediate of a three-operand instruction, e.g. `roundsd $9, %xmm0, %xmm1`.
 } Inst;
 
 enum DirectiveType {
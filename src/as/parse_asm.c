@@ -99,6 +99,9 @@ static const char *kOpTable[] = {
 
   "int",
   "syscall",
+  "rep",
+  "movsq",
+  "stosq",
 
 #ifndef __NO_FLONUM
   "movsd",
@@ -110,6 +113,8 @@ static const char *kOpTable[] = {
   "cvtsi2sd",
   "cvttsd2si",
   "sqrtsd",
+  "andpd",
+  "roundsd",
 
   "movss",
   "addss",
@@ -239,7 +244,7 @@ static const char *kDirectiveTable[] = {
 
 bool err;
 
-void parse_error(const ParseInfo *info, const char *message) {
+void parse_asm_error(const ParseInfo *info, const char *message) {
   fprintf(stderr, "%s(%d): %s\n", info->filename, info->lineno, message);
   fprintf(stderr, "%s\n", info->rawline);
   err = true;
@@ -464,7 +469,7 @@ static enum RegType parse_direct_register(ParseInfo *info, Operand *operand) {
     size = REG64;
     no = reg - RAX;
   } else {
-    parse_error(info, "Illegal register");
+    parse_asm_error(info, "Illegal register");
     return false;
   }
 
@@ -486,23 +491,23 @@ static bool parse_indirect_register(ParseInfo *info, Expr *offset, Operand *oper
     info->p = skip_whitespaces(info->p + 1);
     if (*info->p != '%' ||
         (++info->p, index_reg = find_register(&info->p), !is_reg64(index_reg)))
-      parse_error(info, "Register expected");
+      parse_asm_error(info, "Register expected");
     info->p = skip_whitespaces(info->p);
     if (*info->p == ',') {
       info->p = skip_whitespaces(info->p + 1);
       scale = parse_expr(info);
       if (scale->kind != EX_FIXNUM)
-        parse_error(info, "constant value expected");
+        parse_asm_error(info, "constant value expected");
       info->p = skip_whitespaces(info->p);
     }
   }
   if (*info->p != ')')
-    parse_error(info, "`)' expected");
+    parse_asm_error(info, "`)' expected");
   else
     ++info->p;
 
   if (!(is_reg64(base_reg) || (base_reg == RIP && index_reg == NOREG)))
-    parse_error(info, "Register expected");
+    parse_asm_error(info, "Register expected");
 
   if (index_reg == NOREG) {
     char no = base_reg - RAX;
@@ -513,7 +518,7 @@ static bool parse_indirect_register(ParseInfo *info, Expr *offset, Operand *oper
     operand->indirect.offset = offset;
   } else {
     if (!is_reg64(index_reg))
-      parse_error(info, "Register expected");
+      parse_asm_error(info, "Register expected");
 
     operand->type = INDIRECT_WITH_INDEX;
     operand->indirect_with_index.offset = offset;
@@ -534,7 +539,7 @@ static bool parse_indirect_register(ParseInfo *info, Expr *offset, Operand *oper
 static enum RegType parse_deref_register(ParseInfo *info, Operand *operand) {
   enum RegType reg = find_register(&info->p);
   if (!is_reg64(reg))
-    parse_error(info, "Illegal register");
+    parse_asm_error(info, "Illegal register");
 
   char no = reg - RAX;
   operand->type = DEREF_REG;
@@ -548,11 +553,11 @@ static bool parse_deref_indirect(ParseInfo *info, Operand *operand) {
   Expr *offset = parse_expr(info);
   info->p = skip_whitespaces(info->p);
   if (*info->p != '(') {
-    parse_error(info, "direct number not implemented");
+    parse_asm_error(info, "direct number not implemented");
     return false;
   }
   if (info->p[1] != '%') {
-    parse_error(info, "Register expected");
+    parse_asm_error(info, "Register expected");
     return false;
   }
   info->p += 2;
@@ -567,23 +572,23 @@ static bool parse_deref_indirect(ParseInfo *info, Operand *operand) {
     info->p = skip_whitespaces(info->p + 1);
     if (*info->p != '%' ||
         (++info->p, index_reg = find_register(&info->p), !is_reg64(index_reg)))
-      parse_error(info, "Register expected");
+      parse_asm_error(info, "Register expected");
     info->p = skip_whitespaces(info->p);
     if (*info->p == ',') {
       info->p = skip_whitespaces(info->p + 1);
       scale = parse_expr(info);
       if (scale->kind != EX_FIXNUM)
-        parse_error(info, "constant value expected");
+        parse_asm_error(info, "constant value expected");
       info->p = skip_whitespaces(info->p);
     }
   }
   if (*info->p != ')')
-    parse_error(info, "`)' expected");
+    parse_asm_error(info, "`)' expected");
   else
     ++info->p;
 
   if (!is_reg64(base_reg) || (index_reg != NOREG && !is_reg64(index_reg)))
-    parse_error(info, "Register expected");
+    parse_asm_error(info, "Register expected");
 
   if (index_reg == NOREG) {
     operand->type = DEREF_INDIRECT;
@@ -803,7 +808,7 @@ static Expr *parse_mul(ParseInfo *info) {
          (tok = match(info, TK_DIV)) != NULL) {
     Expr *rhs = unary(info);
     if (rhs == NULL) {
-      parse_error(info, "expression error");
+      parse_asm_error(info, "expression error");
       break;
     }
 
@@ -833,7 +838,7 @@ static Expr *parse_add(ParseInfo *info) {
          (tok = match(info, TK_SUB)) != NULL) {
     Expr *rhs = parse_mul(info);
     if (rhs == NULL) {
-      parse_error(info, "expression error");
+      parse_asm_error(info, "expression error");
       break;
     }
 
@@ -879,7 +884,7 @@ static bool parse_operand(ParseInfo *info, Operand *operand) {
   if (*p == '$') {
     info->p = p + 1;
     if (!immediate(&info->p, &operand->immediate))
-      parse_error(info, "Syntax error");
+      parse_asm_error(info, "Syntax error");
     operand->type = IMMEDIATE;
     return true;
   }
@@ -893,7 +898,7 @@ static bool parse_operand(ParseInfo *info, Operand *operand) {
         operand->direct.expr = expr;
         return true;
       }
-      parse_error(info, "direct number not implemented");
+      parse_asm_error(info, "direct number not implemented");
     }
   } else {
     if (info->p[1] == '%') {
@@ -920,18 +925,52 @@ static void parse_inst(ParseInfo *info, Inst *inst) {
         info->p = skip_whitespaces(info->p + 1);
         parse_operand(info, &inst->dst);
         info->p = skip_whitespaces(info->p);
+        if (*info->p == ',' && inst->src.type == IMMEDIATE) {
+          // Three operands: shift the leading immediate out.
+          inst->imm = inst->src;
+          inst->src = inst->dst;
+          info->p = skip_whitespaces(info->p + 1);
+          parse_operand(info, &inst->dst);
+          info->p = skip_whitespaces(info->p);
+        }
       }
     }
   }
 }
 
+bool parse_inst_operands(ParseInfo *info, const char *op, const char **operands, int count,
+                         Inst *inst) {
+  static Table op_table;
+  if (op_table.entries == NULL) {
+    table_init(&op_table);
+    for (int i = 0, n = sizeof(kOpTable) / sizeof(*kOpTable); i < n; ++i)
+      table_put(&op_table, alloc_name(kOpTable[i], NULL, false), (void*)(intptr_t)(i + 1));
+  }
+
+  enum Opcode opcode = (intptr_t)table_get(&op_table, alloc_name(op, NULL, true));
+  if (opcode == NOOP || count > 2)
+    return false;
+
+  inst->op = opcode;
+  inst->src.type = inst->dst.type = inst->imm.type = NOOPERAND;
+  Operand *dsts[] = {&inst->src, &inst->dst};
+  for (int i = 0; i < count; ++i) {
+    info->rawline = info->p = operands[i];
+    if (!parse_operand(info, dsts[i]) || *skip_whitespaces(info->p) != '\0') {
+      parse_asm_error(info, "Syntax error");
+      break;
+    }
+  }
+  return true;
+}
+
 int current_section = SEC_CODE;
 
 Line *parse_line(ParseInfo *info) {
   Line *line = malloc_or_die(sizeof(*line));
   line->label = NULL;
   line->inst.op = NOOP;
-  line->inst.src.type = line->inst.dst.type = NOOPERAND;
+  line->inst.src.type = line->inst.dst.type = line->inst.imm.type = NOOPERAND;
   line->dir = NODIRECTIVE;
 
   const char *p = skip_whitespaces(info->rawline);
@@ -940,7 +979,7 @@ Line *parse_line(ParseInfo *info) {
   if (*r == ':') {
     const Name *label = unquote_label(p, q);
     if (label == NULL) {
-      parse_error(info, "Illegal label");
+      parse_asm_error(info, "Illegal label");
       err = true;
     } else {
       info->p = p;
@@ -951,7 +990,7 @@ Line *parse_line(ParseInfo *info) {
     if (*p == '.') {
       enum DirectiveType dir = find_directive(p + 1, q - p - 1);
       if (dir == NODIRECTIVE) {
-        parse_error(info, "Unknown directive");
+        parse_asm_error(info, "Unknown directive");
         return NULL;
       }
       line->dir = dir;
@@ -960,7 +999,7 @@ Line *parse_line(ParseInfo *info) {
       info->p = p;
       parse_inst(info, &line->inst);
       if (*info->p != '\0' && !(*info->p == '/' && info->p[1] == '/')) {
-        parse_error(info, "Syntax error");
+        parse_asm_error(info, "Syntax error");
         err = true;
       }
     }
@@ -994,7 +1033,7 @@ static char unescape_char(ParseInfo *info) {
   case 'v':  return '\v';
 
   default:
-    parse_error(info, "Illegal escape");
+    parse_asm_error(info, "Illegal escape");
     // Fallthrough
   case '\'': case '"': case '\\':
     return c;
@@ -1006,7 +1045,7 @@ static size_t unescape_string(ParseInfo *info, char *dst) {
   for (; *info->p != '"'; ++info->p, ++len) {
     char c = *info->p;
     if (c == '\0')
-      parse_error(info, "string not closed");
+      parse_asm_error(info, "string not closed");
     if (c == '\\') {
       ++info->p;
       c = unescape_char(info);
@@ -1026,7 +1065,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
   case DT_ASCII:
     {
       if (*info->p != '"')
-        parse_error(info, "`\"' expected");
+        parse_asm_error(info, "`\"' expected");
       ++info->p;
       const char *p = info->p;
       size_t len = unescape_string(info, NULL);
@@ -1042,14 +1081,14 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     {
       const Name *label = parse_label(info);
       if (label == NULL)
-        parse_error(info, ".comm: label expected");
+        parse_asm_error(info, ".comm: label expected");
       info->p = skip_whitespaces(info->p);
       if (*info->p != ',')
-        parse_error(info, ".comm: `,' expected");
+        parse_asm_error(info, ".comm: `,' expected");
       info->p = skip_whitespaces(info->p + 1);
       long count;
       if (!immediate(&info->p, &count)) {
-        parse_error(info, ".comm: count expected");
+        parse_asm_error(info, ".comm: count expected");
         return;
       }
 
@@ -1057,7 +1096,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
       if (*info->p == ',') {
         info->p = skip_whitespaces(info->p + 1);
         if (!immediate(&info->p, &align) || align < 1) {
-          parse_error(info, ".comm: optional alignment expected");
+          parse_asm_error(info, ".comm: optional alignment expected");
           return;
         }
       }
@@ -1086,7 +1125,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     {
       long align;
       if (!immediate(&info->p, &align))
-        parse_error(info, ".align: number expected");
+        parse_asm_error(info, ".align: number expected");
       vec_push(irs, new_ir_align(align));
     }
     break;
@@ -1094,7 +1133,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     {
       long align;
       if (!immediate(&info->p, &align))
-        parse_error(info, ".align: number expected");
+        parse_asm_error(info, ".align: number expected");
       vec_push(irs, new_ir_align(1 << align));
     }
     break;
@@ -1106,7 +1145,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     {
       Expr *expr = parse_expr(info);
       if (expr == NULL) {
-        parse_error(info, "expression expected");
+        parse_asm_error(info, "expression expected");
         break;
       }
 
@@ -1133,7 +1172,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     {
       Expr *expr = parse_expr(info);
       if (expr == NULL) {
-        parse_error(info, "expression expected");
+        parse_asm_error(info, "expression expected");
         break;
       }
 
@@ -1166,7 +1205,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
       if (label == NULL) {
         char buf[32];
         snprintf(buf, sizeof(buf), "%s: label expected", dir == DT_GLOBL ? ".globl" : ".local");
-        parse_error(info, buf);
+        parse_asm_error(info, buf);
         return;
       }
 
@@ -1179,13 +1218,13 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     {
       const Name *name = parse_section_name(info);
       if (name == NULL) {
-        parse_error(info, ".section: section name expected");
+        parse_asm_error(info, ".section: section name expected");
         return;
       }
       if (equal_name(name, alloc_name(".rodata", NULL, false))) {
         current_section = SEC_RODATA;
       } else {
-        parse_error(info, "Unknown section name");
+        parse_asm_error(info, "Unknown section name");
         return;
       }
     }
@@ -1195,7 +1234,7 @@ void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_
     break;
 
   default:
-    parse_error(info, "Unhandled directive");
+    parse_asm_error(info, "Unhandled directive");
     break;
   }
 }
@@ -31,6 +31,10 @@ extern int current_section;  // enum SectionType
 extern bool err;
 
 Line *parse_line(ParseInfo *info);
+// Parse an instruction whose operands are already split, without joining them into a line.
+// Returns false if `op` is not an instruction, e.g. a directive.
+bool parse_inst_operands(ParseInfo *info, const char *op, const char **operands, int count,
+                         Inst *inst);
 void handle_directive(ParseInfo *info, enum DirectiveType dir, Vector **section_irs,
                       Table *label_table);
-void parse_error(const ParseInfo *info, const char *message);
+void parse_asm_error(const ParseInfo *info, const char *message);
@@ -277,6 +277,10 @@
 #define FMUL(o1, o2, o3)   EMIT_ASM("fmul", o1, o2, o3)
 #define FDIV(o1, o2, o3)   EMIT_ASM("fdiv", o1, o2, o3)
 #define FCMP(o1, o2)       EMIT_ASM("fcmp", o1, o2)
+#define FSQRT(o1, o2)      EMIT_ASM("fsqrt", o1, o2)
+#define FABS(o1, o2)       EMIT_ASM("fabs", o1, o2)
+#define FRINTM(o1, o2)     EMIT_ASM("frintm", o1, o2)  // Round toward minus infinity
+#define FRINTP(o1, o2)     EMIT_ASM("frintp", o1, o2)  // Round toward plus infinity
 
 #define SCVTF(o1, o2)      EMIT_ASM("scvtf", o1, o2)  // float <- int
 #define UCVTF(o1, o2)      EMIT_ASM("ucvtf", o1, o2)  // float <- unsigned int
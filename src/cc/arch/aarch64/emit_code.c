@@ -416,13 +416,17 @@ static void put_args_to_stack(Function *func) {
     assert(0 <= size && size < kPow2TableSize);
     int pow = kPow2Table[size];
     const char *src = kRegTable[pow][0];
-    int offset = varinfo->local.reg->offset;
-    const char *dst = IMMEDIATE_OFFSET(FP, offset);
-    switch (pow) {
-    case 0:          STRB(src, dst); break;
-    case 1:          STRH(src, dst); break;
-    case 2: case 3:  STR(src, dst); break;
-    default: assert(false); break;
+    VReg *vreg = varinfo->local.reg;
+    if (vreg->flag & VRF_SPILLED) {
+      const char *dst = IMMEDIATE_OFFSET(FP, vreg->offset);
+      switch (pow) {
+      case 0:          STRB(src, dst); break;
+      case 1:          STRH(src, dst); break;
+      case 2: case 3:  STR(src, dst); break;
+      default: assert(false); break;
+      }
+    } else {
+      move_param_to_reg(vreg, src);
     }
     ++arg_index;
   }
@@ -445,7 +449,8 @@ static void put_args_to_stack(Function *func) {
     for (int i = 0; i < len; ++i) {
       const VarInfo *varinfo = params->data[i];
       const Type *type = varinfo->type;
-      int offset = varinfo->local.reg->offset;
+      VReg *vreg = varinfo->local.reg;
+      int offset = vreg->offset;
 
       if (is_stack_param(type))
         continue;
@@ -453,11 +458,16 @@ static void put_args_to_stack(Function *func) {
 #ifndef __NO_FLONUM
       if (is_flonum(type)) {
         if (farg_index < MAX_FREG_ARGS) {
+          const char *src;
           switch (type->flonum.kind) {
-          case FL_FLOAT:   STR(kFReg32s[farg_index], IMMEDIATE_OFFSET(FP, offset)); break;
-          case FL_DOUBLE:  STR(kFReg64s[farg_index], IMMEDIATE_OFFSET(FP, offset)); break;
-          default: assert(false); break;
+          default: assert(false); // Fallthrough
+          case FL_FLOAT:   src = kFReg32s[farg_index]; break;
+          case FL_DOUBLE:  src = kFReg64s[farg_index]; break;
           }
+          if (vreg->flag & VRF_SPILLED)
+            STR(src, IMMEDIATE_OFFSET(FP, offset));
+          else
+            move_param_to_reg(vreg, src);
           ++farg_index;
         }
         continue;
@@ -476,6 +486,11 @@ static void put_args_to_stack(Function *func) {
         assert(0 <= size && size < kPow2TableSize);
         int pow = kPow2Table[size];
         const char *src = kRegTable[pow][arg_index];
+        if (!(vreg->flag & VRF_SPILLED)) {
+          move_param_to_reg(vreg, src);
+          ++arg_index;
+          continue;
+        }
         assert(offset < 0);
         const char *dst;
         if (offset >= -256) {
@@ -619,10 +634,11 @@ static void emit_defun(Function *func) {
         mov_immediate(value = X9, frame_size, true, false);  // x9 broken
       SUB(SP, SP, value);
     }
-    put_args_to_stack(func);
-
     // Callee save.
     callee_saved_count = push_callee_save_regs(fnbe->ra->used_reg_bits, fnbe->ra->used_freg_bits);
+
+    // Parameters might be assigned to callee save registers, so put them after saving.
+    put_args_to_stack(func);
   }
 
   emit_bb_irs(fnbe->bbcon);
@@ -93,41 +93,93 @@ void mov_immediate(const char *dst, int64_t value, bool b64, bool is_unsigned) {
   }
 }
 
-static void ir_memcpy(int dst_reg, int src_reg, ssize_t size) {
-  switch (size) {
-  case 1:
-    LDRB(W9, IMMEDIATE_OFFSET0(kReg64s[src_reg]));
-    STRB(W9, IMMEDIATE_OFFSET0(kReg64s[dst_reg]));
-    break;
-  case 2:
-    LDRH(W9, IMMEDIATE_OFFSET0(kReg64s[src_reg]));
-    STRH(W9, IMMEDIATE_OFFSET0(kReg64s[dst_reg]));
-    break;
-  case 4:
-  case 8:
-    {
-      const char *reg = size == 4 ? W9 : X9;
-      LDR(reg, IMMEDIATE_OFFSET0(kReg64s[src_reg]));
-      STR(reg, IMMEDIATE_OFFSET0(kReg64s[dst_reg]));
+// Block copy and clear up to this size are unrolled,
+// otherwise 16 bytes are processed at a time in a loop.
+#define BLOCK_UNROLL_MAX  (64)
+
+static void copy_block(const char *dst, const char *src, ssize_t size) {
+  // Break %x6~%x7
+  ssize_t offset = 0;
+  for (; size - offset >= 16; offset += 16) {
+    LDP(X6, X7, IMMEDIATE_OFFSET(src, offset));
+    STP(X6, X7, IMMEDIATE_OFFSET(dst, offset));
+  }
+  for (int pow = 3; pow >= 0; --pow) {
+    ssize_t n = (ssize_t)1 << pow;
+    for (; size - offset >= n; offset += n) {
+      switch (pow) {
+      case 0:
+        LDRB(W6, IMMEDIATE_OFFSET(src, offset));
+        STRB(W6, IMMEDIATE_OFFSET(dst, offset));
+        break;
+      case 1:
+        LDRH(W6, IMMEDIATE_OFFSET(src, offset));
+        STRH(W6, IMMEDIATE_OFFSET(dst, offset));
+        break;
+      default:
+        {
+          const char *reg = pow == 3 ? X6 : W6;
+          LDR(reg, IMMEDIATE_OFFSET(src, offset));
+          STR(reg, IMMEDIATE_OFFSET(dst, offset));
+        }
+        break;
+      }
     }
-    break;
-  default:
-    // Break %x4~%x7
-    {
-      const Name *label = alloc_label();
-      MOV(X4, kReg64s[src_reg]);
-      MOV(X5, kReg64s[dst_reg]);
-      mov_immediate(W6, size, false, true);
-      EMIT_LABEL(fmt_name(label));
-      LDRB(W7, POST_INDEX(X4, 1));
-      STRB(W7, POST_INDEX(X5, 1));
-      SUBS(W6, W6, IM(1));
-      Bcc(CNE, fmt_name(label));
+  }
+}
+
+static void clear_block(const char *dst, ssize_t size) {
+  ssize_t offset = 0;
+  for (; size - offset >= 16; offset += 16)
+    STP(XZR, XZR, IMMEDIATE_OFFSET(dst, offset));
+  for (int pow = 3; pow >= 0; --pow) {
+    ssize_t n = (ssize_t)1 << pow;
+    for (; size - offset >= n; offset += n) {
+      switch (pow) {
+      case 0:  STRB(WZR, IMMEDIATE_OFFSET(dst, offset)); break;
+      case 1:  STRH(WZR, IMMEDIATE_OFFSET(dst, offset)); break;
+      default:  STR(kZeroRegTable[pow], IMMEDIATE_OFFSET(dst, offset)); break;
+      }
     }
-    break;
   }
 }
 
+static void ir_memcpy(int dst_reg, int src_reg, ssize_t size) {
+  if (size <= BLOCK_UNROLL_MAX) {
+    copy_block(kReg64s[dst_reg], kReg64s[src_reg], size);
+    return;
+  }
+
+  // Break %x4~%x7, %x9
+  const Name *label = alloc_label();
+  MOV(X4, kReg64s[src_reg]);
+  MOV(X5, kReg64s[dst_reg]);
+  mov_immediate(W9, size >> 4, false, true);
+  EMIT_LABEL(fmt_name(label));
+  LDP(X6, X7, POST_INDEX(X4, 16));
+  STP(X6, X7, POST_INDEX(X5, 16));
+  SUBS(W9, W9, IM(1));
+  Bcc(CNE, fmt_name(label));
+  copy_block(X5, X4, size & 15);
+}
+
+static void ir_clear(int dst_reg, ssize_t size) {
+  if (size <= BLOCK_UNROLL_MAX) {
+    clear_block(kReg64s[dst_reg], size);
+    return;
+  }
+
+  // Break %x6~%x7
+  const Name *label = alloc_label();
+  MOV(X6, kReg64s[dst_reg]);
+  mov_immediate(W7, size >> 4, false, true);
+  EMIT_LABEL(fmt_name(label));
+  STP(XZR, XZR, POST_INDEX(X6, 16));
+  SUBS(W7, W7, IM(1));
+  Bcc(CNE, fmt_name(label));
+  clear_block(X6, size & 15);
+}
+
 static bool is_got(const Name *name) {
 #ifdef __APPLE__
   // TODO: How to detect the label is GOT?
@@ -593,6 +645,26 @@ static void ir_out(IR *ir) {
     }
     break;
 
+#ifndef __NO_FLONUM
+  case IR_SQRT:
+  case IR_FABS:
+  case IR_FLOOR:
+  case IR_CEIL:
+    {
+      assert(ir->dst->vtype->size == SZ_DOUBLE);
+      const char *dst = kFReg64s[ir->dst->phys];
+      const char *src = kFReg64s[ir->opr1->phys];
+      switch (ir->kind) {
+      case IR_SQRT:   FSQRT(dst, src); break;
+      case IR_FABS:   FABS(dst, src); break;
+      case IR_FLOOR:  FRINTM(dst, src); break;
+      case IR_CEIL:   FRINTP(dst, src); break;
+      default: assert(false); break;
+      }
+    }
+    break;
+#endif
+
   case IR_COND:
     {
       assert(!(ir->dst->flag & VRF_CONST));
@@ -900,18 +972,8 @@ for (int i = 0; i < CALLER_SAVE_FREG_COUNT; ++i) {
     break;
 
   case IR_CLEAR:
-    {
-      assert(!(ir->opr1->flag & VRF_CONST));
-      const Name *label = alloc_label();
-
-      // Break %x6~%x7
-      MOV(X6, kReg64s[ir->opr1->phys]);
-      mov_immediate(W7, ir->clear.size, false, true);
-      EMIT_LABEL(fmt_name(label));
-      STRB(WZR, POST_INDEX(X6, 1));
-      SUBS(W7, W7, IM(1));
-      Bcc(CNE, fmt_name(label));
-    }
+    assert(!(ir->opr1->flag & VRF_CONST));
+    ir_clear(ir->opr1->phys, ir->clear.size);
     break;
 
   case IR_ASM:
@@ -942,6 +1004,27 @@ static int enum_callee_save_regs(unsigned long bit, int n, const int *indices, c
   return count;
 }
 
+// Move a function parameter from the argument register `src` to its allocated register.
+void move_param_to_reg(VReg *vreg, const char *src) {
+  assert(!(vreg->flag & VRF_SPILLED));
+#ifndef __NO_FLONUM
+  if (vreg->vtype->flag & VRTF_FLONUM) {
+    const char *dst;
+    switch (vreg->vtype->size) {
+    default: assert(false); // Fallthrough
+    case SZ_FLOAT:   dst = kFReg32s[vreg->phys]; break;
+    case SZ_DOUBLE:  dst = kFReg64s[vreg->phys]; break;
+    }
+    FMOV(dst, src);
+    return;
+  }
+#endif
+  assert(0 <= vreg->vtype->size && vreg->vtype->size < kPow2TableSize);
+  int pow = kPow2Table[vreg->vtype->size];
+  assert(0 <= pow && pow < 4);
+  MOV(kRegSizeTable[pow][vreg->phys], src);
+}
+
 #ifdef __NO_FLONUM
 #define N  CALLEE_SAVE_REG_COUNT
 
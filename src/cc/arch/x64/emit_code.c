@@ -412,10 +412,13 @@ static void put_args_to_stack(Function *func) {
     assert(varinfo != NULL);
     const Type *type = varinfo->type;
     int size = type_size(type);
-    int offset = varinfo->local.reg->offset;
+    VReg *vreg = varinfo->local.reg;
     assert(size < (int)(sizeof(kRegTable) / sizeof(*kRegTable)) &&
            kRegTable[size] != NULL);
-    MOV(kRegTable[size][0], OFFSET_INDIRECT(offset, RBP, NULL, 1));
+    if (vreg->flag & VRF_SPILLED)
+      MOV(kRegTable[size][0], OFFSET_INDIRECT(vreg->offset, RBP, NULL, 1));
+    else
+      move_param_to_reg(vreg, kRegTable[size][0]);
     ++arg_index;
   }
 
@@ -432,7 +435,8 @@ static void put_args_to_stack(Function *func) {
     for (int i = 0; i < len; ++i) {
       const VarInfo *varinfo = params->data[i];
       const Type *type = varinfo->type;
-      int offset = varinfo->local.reg->offset;
+      VReg *vreg = varinfo->local.reg;
+      int offset = vreg->offset;
 
       if (is_stack_param(type))
         continue;
@@ -440,10 +444,14 @@ static void put_args_to_stack(Function *func) {
 #ifndef __NO_FLONUM
       if (is_flonum(type)) {
         if (farg_index < MAX_FREG_ARGS) {
-          switch (type->flonum.kind) {
-          case FL_FLOAT:   MOVSS(kFReg64s[farg_index], OFFSET_INDIRECT(offset, RBP, NULL, 1)); break;
-          case FL_DOUBLE:  MOVSD(kFReg64s[farg_index], OFFSET_INDIRECT(offset, RBP, NULL, 1)); break;
-          default: assert(false); break;
+          if (vreg->flag & VRF_SPILLED) {
+            switch (type->flonum.kind) {
+            case FL_FLOAT:   MOVSS(kFReg64s[farg_index], OFFSET_INDIRECT(offset, RBP, NULL, 1)); break;
+            case FL_DOUBLE:  MOVSD(kFReg64s[farg_index], OFFSET_INDIRECT(offset, RBP, NULL, 1)); break;
+            default: assert(false); break;
+            }
+          } else {
+            move_param_to_reg(vreg, kFReg64s[farg_index]);
           }
           ++farg_index;
         }
@@ -462,7 +470,10 @@ static void put_args_to_stack(Function *func) {
         int size = type_size(type);
         assert(size < (int)(sizeof(kRegTable) / sizeof(*kRegTable)) &&
                kRegTable[size] != NULL);
-        MOV(kRegTable[size][arg_index], OFFSET_INDIRECT(offset, RBP, NULL, 1));
+        if (vreg->flag & VRF_SPILLED)
+          MOV(kRegTable[size][arg_index], OFFSET_INDIRECT(offset, RBP, NULL, 1));
+        else
+          move_param_to_reg(vreg, kRegTable[size][arg_index]);
         ++arg_index;
       }
     }
@@ -579,10 +590,11 @@ static void emit_defun(Function *func) {
       stackpos += fnbe->frame_size;
     }
 
-    put_args_to_stack(func);
-
     // Callee save.
     callee_saved_count = push_callee_save_regs(fnbe->ra->used_reg_bits, fnbe->ra->used_freg_bits);
+
+    // Parameters might be assigned to callee save registers, so put them after saving.
+    put_args_to_stack(func);
   }
 
   emit_bb_irs(fnbe->bbcon);
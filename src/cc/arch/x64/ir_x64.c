@@ -63,47 +63,66 @@ static const int kCallerSaveFRegs[] = {0, 1, 2, 3, 4, 5, 6, 7};
 static const int kPow2Table[] = {-1, 0, 1, -1, 2, -1, -1, -1, 3};
 #define kPow2TableSize ((int)(sizeof(kPow2Table) / sizeof(*kPow2Table)))
 
+// Block copy and clear up to this size are unrolled,
+// otherwise string instructions (`rep movsq`, `rep stosq`) are used.
+#define BLOCK_UNROLL_MAX  (64)
+
+static void copy_block(const char *dst, const char *src, ssize_t size) {
+  // Break %rdx
+  ssize_t offset = 0;
+  for (int pow = 3; pow >= 0; --pow) {
+    ssize_t n = (ssize_t)1 << pow;
+    for (; size - offset >= n; offset += n) {
+      MOV(OFFSET_INDIRECT(offset, src, NULL, 1), kRegDTable[pow]);
+      MOV(kRegDTable[pow], OFFSET_INDIRECT(offset, dst, NULL, 1));
+    }
+  }
+}
+
+static void clear_block(const char *dst, ssize_t size) {
+  // Assume %rax is zero.
+  ssize_t offset = 0;
+  for (int pow = 3; pow >= 0; --pow) {
+    ssize_t n = (ssize_t)1 << pow;
+    for (; size - offset >= n; offset += n)
+      MOV(kRegATable[pow], OFFSET_INDIRECT(offset, dst, NULL, 1));
+  }
+}
+
 static void ir_memcpy(int dst_reg, int src_reg, ssize_t size) {
   const char *dst = kReg64s[dst_reg];
   const char *src = kReg64s[src_reg];
 
-  // Break %rcx, %dl
-  switch (size) {
-  case 1:
-    MOV(INDIRECT(src, NULL, 1), DL);
-    MOV(DL, INDIRECT(dst, NULL, 1));
-    break;
-  case 2:
-    MOV(INDIRECT(src, NULL, 1), DX);
-    MOV(DX, INDIRECT(dst, NULL, 1));
-    break;
-  case 4:
-    MOV(INDIRECT(src, NULL, 1), EDX);
-    MOV(EDX, INDIRECT(dst, NULL, 1));
-    break;
-  case 8:
-    MOV(INDIRECT(src, NULL, 1), RDX);
-    MOV(RDX, INDIRECT(dst, NULL, 1));
-    break;
-  default:
-    {
-      const Name *name = alloc_label();
-      const char *label = fmt_name(name);
-      PUSH(src);
-      PUSH(dst);
-      MOV(IM(size), RCX);
-      EMIT_LABEL(label);
-      MOV(INDIRECT(src, NULL, 1), DL);
-      MOV(DL, INDIRECT(dst, NULL, 1));
-      INC(src);
-      INC(dst);
-      DEC(RCX);
-      JNE(label);
-      POP(dst);
-      POP(src);
-    }
-    break;
+  if (size <= BLOCK_UNROLL_MAX) {
+    copy_block(dst, src, size);
+    return;
+  }
+
+  // Break %rcx, %rsi, %rdi, %rdx
+  MOV(src, RSI);
+  MOV(dst, RDI);
+  MOV(IM(size >> 3), RCX);
+  REP();
+  MOVSQ();
+  copy_block(RDI, RSI, size & 7);
+}
+
+static void ir_clear(int dst_reg, ssize_t size) {
+  const char *dst = kReg64s[dst_reg];
+
+  // Break %rax
+  XOR(EAX, EAX);
+  if (size <= BLOCK_UNROLL_MAX) {
+    clear_block(dst, size);
+    return;
   }
+
+  // Break %rcx, %rdi
+  MOV(dst, RDI);
+  MOV(IM(size >> 3), RCX);
+  REP();
+  STOSQ();
+  clear_block(RDI, size & 7);
 }
 
 static bool is_got(const Name *name) {
@@ -534,6 +553,34 @@ static void ir_out(IR *ir) {
     }
     break;
 
+#ifndef __NO_FLONUM
+  case IR_SQRT:
+  case IR_FABS:
+  case IR_FLOOR:
+  case IR_CEIL:
+    {
+      assert(ir->dst->vtype->size == SZ_DOUBLE);
+      const char *dst = kFReg64s[ir->dst->phys];
+      const char *src = kFReg64s[ir->opr1->phys];
+      switch (ir->kind) {
+      case IR_SQRT:  SQRTSD(src, dst); break;
+      case IR_FABS:
+        // Clear the sign bit with a mask built in a scratch register.
+        if (dst != src)
+          MOVSD(src, dst);
+        MOV(IM(0x7fffffffffffffffLL), RAX);
+        MOVQ(RAX, XMM0);
+        ANDPD(XMM0, dst);
+        break;
+      // Rounding mode in the immediate: 1=down, 2=up, bit 3 suppresses the inexact exception.
+      case IR_FLOOR:  ROUNDSD(IM(9), src, dst); break;
+      case IR_CEIL:   ROUNDSD(IM(10), src, dst); break;
+      default: assert(false); break;
+      }
+    }
+    break;
+#endif
+
   case IR_COND:
     {
       assert(!(ir->dst->flag & VRF_CONST));
@@ -956,18 +1003,8 @@ static void ir_out(IR *ir) {
     break;
 
   case IR_CLEAR:
-    {
-      assert(!(ir->opr1->flag & VRF_CONST));
-      const Name *label = alloc_label();
-      MOV(kReg64s[ir->opr1->phys], RSI);
-      MOV(IM(ir->clear.size), EDI);
-      XOR(AL, AL);
-      EMIT_LABEL(fmt_name(label));
-      MOV(AL, INDIRECT(RSI, NULL, 1));
-      INC(RSI);
-      DEC(EDI);
-      JNE(fmt_name(label));
-    }
+    assert(!(ir->opr1->flag & VRF_CONST));
+    ir_clear(ir->opr1->phys, ir->clear.size);
     break;
 
   case IR_ASM:
@@ -1032,6 +1069,25 @@ static void ir_out(IR *ir) {
 
 //
 
+// Move a function parameter from the argument register `src` to its allocated register.
+void move_param_to_reg(VReg *vreg, const char *src) {
+  assert(!(vreg->flag & VRF_SPILLED));
+#ifndef __NO_FLONUM
+  if (vreg->vtype->flag & VRTF_FLONUM) {
+    switch (vreg->vtype->size) {
+    case SZ_FLOAT: MOVSS(src, kFReg64s[vreg->phys]); break;
+    case SZ_DOUBLE: MOVSD(src, kFReg64s[vreg->phys]); break;
+    default: assert(false); break;
+    }
+    return;
+  }
+#endif
+  assert(0 <= vreg->vtype->size && vreg->vtype->size < kPow2TableSize);
+  int pow = kPow2Table[vreg->vtype->size];
+  assert(0 <= pow && pow < 4);
+  MOV(src, kRegSizeTable[pow][vreg->phys]);
+}
+
 int push_callee_save_regs(unsigned long used, unsigned long fused) {
   // Assume no callee save freg exists.
   UNUSED(fused);
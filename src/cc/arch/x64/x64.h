@@ -187,6 +187,9 @@
 #define CWTL()         EMIT_ASM("cwtl")
 #define CLTD()         EMIT_ASM("cltd")
 #define CQTO()         EMIT_ASM("cqto")
+#define REP()          EMIT_ASM("rep")
+#define MOVSQ()        EMIT_ASM("movsq")
+#define STOSQ()        EMIT_ASM("stosq")
 
 #define _BYTE(x)       EMIT_ASM(".byte", x)
 #define _WORD(x)       EMIT_ASM(".word", x)
@@ -224,6 +227,9 @@
 #define UCOMISD(o1, o2)    EMIT_ASM("ucomisd", o1, o2)
 #define CVTSI2SD(o1, o2)   EMIT_ASM("cvtsi2sd", o1, o2)
 #define CVTTSD2SI(o1, o2)  EMIT_ASM("cvttsd2si", o1, o2)
+#define SQRTSD(o1, o2)     EMIT_ASM("sqrtsd", o1, o2)
+#define ANDPD(o1, o2)      EMIT_ASM("andpd", o1, o2)
+#define ROUNDSD(o1, o2, o3)  EMIT_ASM("roundsd", o1, o2, o3)  // SSE4.1
 
 #define MOVSS(o1, o2)      EMIT_ASM("movss", o1, o2)
 #define ADDSS(o1, o2)      EMIT_ASM("addss", o1, o2)
@@ -10,6 +10,7 @@
 typedef struct BB BB;
 typedef struct Initializer Initializer;
 typedef struct MemberInfo MemberInfo;
+typedef struct HideSet HideSet;
 typedef struct Name Name;
 typedef struct Scope Scope;
 typedef struct Table Table;
@@ -156,6 +157,7 @@ typedef struct Token {
     double flonum;
 #endif
   };
+  const HideSet *hideset;  // For preprocessor: macro names which must not be expanded.
 } Token;
 
 // ================================================
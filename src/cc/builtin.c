@@ -131,6 +131,23 @@ static VReg *gen_alloca(Expr *expr) {
   return result;
 }
 
+#ifndef __NO_FLONUM
+// Math functions which map to a single instruction: no call, and the result stays in a register.
+static VReg *gen_math_unary(Expr *expr, enum IrKind kind) {
+  assert(expr->kind == EX_FUNCALL);
+  Vector *args = expr->funcall.args;
+  assert(args->len == 1);
+  Expr *x = args->data[0];
+  VReg *opr = gen_expr(make_cast(&tyDouble, x->token, x, false));
+  return new_ir_unary(kind, opr, to_vtype(&tyDouble));
+}
+
+static VReg *gen_sqrt(Expr *expr) { return gen_math_unary(expr, IR_SQRT); }
+static VReg *gen_fabs(Expr *expr) { return gen_math_unary(expr, IR_FABS); }
+static VReg *gen_floor(Expr *expr) { return gen_math_unary(expr, IR_FLOOR); }
+static VReg *gen_ceil(Expr *expr) { return gen_math_unary(expr, IR_CEIL); }
+#endif
+
 void install_builtins(void) {
   static BuiltinExprProc p_reg_class = &proc_builtin_type_kind;
   add_builtin_expr_ident("__builtin_type_kind", &p_reg_class);
@@ -164,4 +181,23 @@ void install_builtins(void) {
 
     add_builtin_function("alloca", type, &p_alloca, false);
   }
+#ifndef __NO_FLONUM
+  {
+    static BuiltinFunctionProc p_sqrt = &gen_sqrt;
+    static BuiltinFunctionProc p_fabs = &gen_fabs;
+    static BuiltinFunctionProc p_floor = &gen_floor;
+    static BuiltinFunctionProc p_ceil = &gen_ceil;
+    Vector *params = new_vector();
+    var_add(params, NULL, &tyDouble, 0);
+
+    Type *rettype = &tyDouble;
+    Vector *param_types = extract_varinfo_types(params);
+    Type *type = new_func_type(rettype, params, param_types, false);
+
+    add_builtin_function("sqrt", type, &p_sqrt, false);
+    add_builtin_function("fabs", type, &p_fabs, false);
+    add_builtin_function("floor", type, &p_floor, false);
+    add_builtin_function("ceil", type, &p_ceil, false);
+  }
+#endif
 }
@@ -1,6 +1,7 @@
 #include "../config.h"
 
 #include <assert.h>
+#include <ctype.h>  // isdigit
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,16 +36,22 @@ static void init_compiler(FILE *ofp) {
 
 static void compile1(FILE *ifp, const char *filename, Vector *decls) {
   set_source_file(ifp, filename);
+  begin_phase("parse");
   parse(decls);
+  end_phase("parse");
 }
 
 int main(int argc, char *argv[]) {
   enum {
     OPT_WARNING = 128,
+    OPT_TIME_REPORT,
   };
 
   static const struct option options[] = {
     {"W", required_argument, OPT_WARNING},
+    {"O", required_argument},
+    {"ftime-report=", required_argument, OPT_TIME_REPORT},  // Append time report to the file
+    {"ftime-report", no_argument, OPT_TIME_REPORT},
     {"-version", no_argument, 'V'},
     {NULL},
   };
@@ -62,6 +69,12 @@ int main(int argc, char *argv[]) {
         // fprintf(stderr, "Warning: unknown option for -W: %s\n", optarg);
       }
       break;
+    case 'O':
+      optimize_level = isdigit(*optarg) ? atoi(optarg) : 1;  // -Os, -Og, etc.
+      break;
+    case OPT_TIME_REPORT:
+      enable_time_report(optarg);
+      break;
     default:
       fprintf(stderr, "Warning: unknown option: %s\n", argv[optind - 1]);
       break;
@@ -90,8 +103,13 @@ int main(int argc, char *argv[]) {
   if (error_warning && compile_warning_count != 0)
     exit(2);
 
+  begin_phase("gen");
   gen(toplevel);
+  end_phase("gen");
+  begin_phase("emit");
   emit_code(toplevel);
+  end_phase("emit");
 
+  output_time_report();
   return 0;
 }
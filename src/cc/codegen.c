@@ -10,6 +10,7 @@
 
 #include "ast.h"
 #include "ir.h"
+#include "optimize.h"
 #include "parser.h"  // curfunc, curscope
 #include "regalloc.h"
 #include "table.h"
@@ -19,7 +20,11 @@
 
 const char RET_VAR_NAME[] = ".ret";
 
+int optimize_level;
+
 static void gen_expr_stmt(Expr *expr);
+static void alloc_scope_registers(Vector *scopes);
+static void spill_scope_vars(Vector *scopes);
 
 void set_curbb(BB *bb) {
   assert(curfunc != NULL);
@@ -34,6 +39,16 @@ void set_curbb(BB *bb) {
 static BB *s_break_bb;
 static BB *s_continue_bb;
 
+// Function being expanded inline.
+typedef struct InlineFrame {
+  struct InlineFrame *prev;
+  Function *func;
+  BB *ret_bb;
+  VReg *result;
+} InlineFrame;
+
+static InlineFrame *s_inline_frame;
+
 static void pop_break_bb(BB *save) {
   s_break_bb = save;
 }
@@ -56,11 +71,9 @@ static BB *push_break_bb(BB **save) {
   return bb;
 }
 
-static void alloc_variable_registers(Function *func) {
-  assert(func->type->kind == TY_FUNC);
-
-  for (int i = 0; i < func->scopes->len; ++i) {
-    Scope *scope = func->scopes->data[i];
+static void alloc_scope_registers(Vector *scopes) {
+  for (int i = 0; i < scopes->len; ++i) {
+    Scope *scope = scopes->data[i];
     if (scope->vars == NULL)
       continue;
 
@@ -79,6 +92,12 @@ static void alloc_variable_registers(Function *func) {
       varinfo->local.reg = vreg;
     }
   }
+}
+
+static void alloc_variable_registers(Function *func) {
+  assert(func->type->kind == TY_FUNC);
+
+  alloc_scope_registers(func->scopes);
 
   // Handle if return value is on the stack.
   Type *rettype = func->type->func.ret;
@@ -143,6 +162,17 @@ static void gen_block(Stmt *stmt) {
 static void gen_return(Stmt *stmt) {
   assert(curfunc != NULL);
   BB *bb = new_bb();
+  if (s_inline_frame != NULL) {
+    // Inlined function: pass the value and jump to the end of the expansion.
+    if (stmt->return_.val != NULL) {
+      VReg *reg = gen_expr(stmt->return_.val);
+      if (s_inline_frame->result != NULL)
+        new_ir_mov(s_inline_frame->result, reg);
+    }
+    new_ir_jmp(COND_ANY, s_inline_frame->ret_bb);
+    set_curbb(bb);
+    return;
+  }
   if (stmt->return_.val != NULL) {
     Expr *val = stmt->return_.val;
     VReg *reg = gen_expr(val);
@@ -464,6 +494,266 @@ void gen_stmt(Stmt *stmt) {
 
 ////////////////////////////////////////////////
 
+// Make variables which cannot live in a register spilled.
+static void spill_scope_vars(Vector *scopes) {
+  for (int i = 0; i < scopes->len; ++i) {
+    Scope *scope = (Scope*)scopes->data[i];
+    if (scope->vars == NULL)
+      continue;
+
+    for (int j = 0; j < scope->vars->len; ++j) {
+      VarInfo *varinfo = scope->vars->data[j];
+      if (varinfo->storage & (VS_STATIC | VS_EXTERN | VS_ENUM_MEMBER))
+        continue;
+      VReg *vreg = varinfo->local.reg;
+      if (vreg == NULL || vreg->flag & VRF_PARAM)
+        continue;
+
+      bool spill = false;
+      if (vreg->flag & VRF_REF)
+        spill = true;
+
+      switch (varinfo->type->kind) {
+      case TY_ARRAY:
+      case TY_STRUCT:
+        // Make non-primitive variable spilled.
+        spill = true;
+        break;
+      default:
+        break;
+      }
+
+      if (spill)
+        spill_vreg(vreg);
+    }
+  }
+}
+
+// Function inlining
+
+#define INLINE_MAX_DEPTH  (4)
+#define INLINE_COST_INLINE  (64)  // Budget for functions declared `inline`.
+#define INLINE_COST_STATIC  (16)  // Budget for other static functions.
+
+static bool calc_stmt_cost(Stmt *stmt, int *budget);
+
+static bool calc_expr_cost(Expr *expr, int *budget) {
+  if (expr == NULL)
+    return true;
+  if (--*budget < 0)
+    return false;
+
+  switch (expr->kind) {
+  case EX_FIXNUM:
+#ifndef __NO_FLONUM
+  case EX_FLONUM:
+#endif
+  case EX_STR:
+  case EX_VAR:
+    return true;
+
+  case EX_ADD: case EX_SUB: case EX_MUL: case EX_DIV: case EX_MOD:
+  case EX_BITAND: case EX_BITOR: case EX_BITXOR: case EX_LSHIFT: case EX_RSHIFT:
+  case EX_EQ: case EX_NE: case EX_LT: case EX_LE: case EX_GE: case EX_GT:
+  case EX_LOGAND: case EX_LOGIOR: case EX_ASSIGN: case EX_COMMA:
+    return calc_expr_cost(expr->bop.lhs, budget) && calc_expr_cost(expr->bop.rhs, budget);
+
+  case EX_POS: case EX_NEG: case EX_BITNOT:
+  case EX_PREINC: case EX_PREDEC: case EX_POSTINC: case EX_POSTDEC:
+  case EX_REF: case EX_DEREF: case EX_CAST:
+    return calc_expr_cost(expr->unary.sub, budget);
+
+  case EX_TERNARY:
+    return calc_expr_cost(expr->ternary.cond, budget) &&
+           calc_expr_cost(expr->ternary.tval, budget) &&
+           calc_expr_cost(expr->ternary.fval, budget);
+
+  case EX_MEMBER:
+    return calc_expr_cost(expr->member.target, budget);
+
+  case EX_FUNCALL:
+    {
+      // Stack allocation is released at the end of the caller, so it must not be inlined.
+      Expr *func = expr->funcall.func;
+      if (func->kind == EX_VAR && is_global_scope(func->var.scope) &&
+          equal_name(func->var.name, alloc_name("alloca", NULL, false)))
+        return false;
+      if (!calc_expr_cost(func, budget))
+        return false;
+      Vector *args = expr->funcall.args;
+      for (int i = 0; i < args->len; ++i) {
+        if (!calc_expr_cost(args->data[i], budget))
+          return false;
+      }
+      return true;
+    }
+
+  case EX_BLOCK:
+    return calc_stmt_cost(expr->block, budget);
+
+  case EX_COMPLIT:
+  default:
+    return false;
+  }
+}
+
+static bool calc_stmt_cost(Stmt *stmt, int *budget) {
+  if (stmt == NULL)
+    return true;
+  if (--*budget < 0)
+    return false;
+
+  switch (stmt->kind) {
+  case ST_EXPR:
+    return calc_expr_cost(stmt->expr, budget);
+  case ST_BLOCK:
+    {
+      Vector *stmts = stmt->block.stmts;
+      for (int i = 0; i < stmts->len; ++i) {
+        if (!calc_stmt_cost(stmts->data[i], budget))
+          return false;
+      }
+      return true;
+    }
+  case ST_IF:
+    return calc_expr_cost(stmt->if_.cond, budget) && calc_stmt_cost(stmt->if_.tblock, budget) &&
+           calc_stmt_cost(stmt->if_.fblock, budget);
+  case ST_SWITCH:
+    return calc_expr_cost(stmt->switch_.value, budget) && calc_stmt_cost(stmt->switch_.body, budget);
+  case ST_WHILE:
+  case ST_DO_WHILE:
+    return calc_expr_cost(stmt->while_.cond, budget) && calc_stmt_cost(stmt->while_.body, budget);
+  case ST_FOR:
+    return calc_expr_cost(stmt->for_.pre, budget) && calc_expr_cost(stmt->for_.cond, budget) &&
+           calc_expr_cost(stmt->for_.post, budget) && calc_stmt_cost(stmt->for_.body, budget);
+  case ST_RETURN:
+    return calc_expr_cost(stmt->return_.val, budget);
+  case ST_VARDECL:
+    {
+      Vector *decls = stmt->vardecl.decls;
+      for (int i = 0; i < decls->len; ++i) {
+        VarDecl *decl = decls->data[i];
+        if (!calc_stmt_cost(decl->init_stmt, budget))
+          return false;
+      }
+      return true;
+    }
+  case ST_CASE:
+  case ST_DEFAULT:
+  case ST_BREAK:
+  case ST_CONTINUE:
+    return true;
+
+  case ST_GOTO:
+  case ST_LABEL:
+  case ST_ASM:
+  default:
+    return false;
+  }
+}
+
+Function *get_inlinable_function(Expr *expr) {
+  if (optimize_level <= 0)
+    return NULL;
+
+  Expr *fexpr = expr->funcall.func;
+  if (fexpr->kind != EX_VAR || !is_global_scope(fexpr->var.scope))
+    return NULL;
+  VarInfo *varinfo = scope_find(fexpr->var.scope, fexpr->var.name, NULL);
+  if (varinfo == NULL || varinfo->type->kind != TY_FUNC || !(varinfo->storage & VS_STATIC))
+    return NULL;
+  Function *func = varinfo->global.func;
+  if (func == NULL || func->scopes == NULL || func == curfunc)
+    return NULL;
+
+  const Type *functype = func->type;
+  if (functype->func.vaargs || functype->func.params == NULL ||
+      functype->func.params->len != expr->funcall.args->len ||
+      is_stack_param(functype->func.ret))
+    return NULL;
+  for (int i = 0; i < functype->func.params->len; ++i) {
+    const VarInfo *param = functype->func.params->data[i];
+    if (is_stack_param(param->type))
+      return NULL;
+  }
+
+  // Avoid recursive expansion.
+  int depth = 0;
+  for (InlineFrame *frame = s_inline_frame; frame != NULL; frame = frame->prev, ++depth) {
+    if (frame->func == func)
+      return NULL;
+  }
+  if (depth >= INLINE_MAX_DEPTH)
+    return NULL;
+
+  int budget = (varinfo->storage & VS_INLINE) ? INLINE_COST_INLINE : INLINE_COST_STATIC;
+  if (!calc_stmt_cost(func->body_block, &budget))
+    return NULL;
+  return func;
+}
+
+// Expand the body of the callee at the call site:
+// parameters and local variables are assigned to fresh registers,
+// and `return` jumps to the end of the expansion.
+VReg *gen_inline_funcall(Expr *expr, Function *func) {
+  Vector *args = expr->funcall.args;
+  int arg_count = args->len;
+  VReg **arg_regs = ALLOCA(sizeof(*arg_regs) * arg_count);
+  for (int i = arg_count; --i >= 0; )
+    arg_regs[i] = gen_expr(args->data[i]);
+
+  // The callee might be inlined in its own arguments or be generated by itself,
+  // so keep its registers and restore them afterward.
+  Vector *saved_regs = new_vector();
+  for (int i = 0; i < func->scopes->len; ++i) {
+    Scope *scope = func->scopes->data[i];
+    if (scope->vars == NULL)
+      continue;
+    for (int j = 0; j < scope->vars->len; ++j) {
+      VarInfo *varinfo = scope->vars->data[j];
+      vec_push(saved_regs, varinfo->local.reg);
+    }
+  }
+
+  alloc_scope_registers(func->scopes);
+  const Vector *params = func->type->func.params;
+  for (int i = 0; i < arg_count; ++i) {
+    VarInfo *varinfo = params->data[i];
+    new_ir_mov(varinfo->local.reg, arg_regs[i]);
+  }
+
+  Type *rettype = func->type->func.ret;
+  InlineFrame frame = {
+    .prev = s_inline_frame,
+    .func = func,
+    .ret_bb = new_bb(),
+    .result = rettype->kind == TY_VOID ? NULL : add_new_reg(rettype, 0),
+  };
+  s_inline_frame = &frame;
+  Scope *saved_scope = curscope;
+  curscope = func->body_block->block.scope->parent;
+
+  gen_stmt(func->body_block);
+  set_curbb(frame.ret_bb);
+
+  curscope = saved_scope;
+  s_inline_frame = frame.prev;
+  spill_scope_vars(func->scopes);
+
+  for (int i = 0, k = 0; i < func->scopes->len; ++i) {
+    Scope *scope = func->scopes->data[i];
+    if (scope->vars == NULL)
+      continue;
+    for (int j = 0; j < scope->vars->len; ++j) {
+      VarInfo *varinfo = scope->vars->data[j];
+      // Variables might be added while generating the body.
+      varinfo->local.reg = k < saved_regs->len ? saved_regs->data[k++] : NULL;
+    }
+  }
+
+  return frame.result;
+}
+
 static void prepare_register_allocation(Function *func) {
   // Handle function parameters first.
   if (func->type->func.params != NULL) {
@@ -477,10 +767,13 @@ static void prepare_register_allocation(Function *func) {
     for (int j = 0; j < func->type->func.params->len; ++j) {
       VarInfo *varinfo = func->type->func.params->data[j];
       VReg *vreg = varinfo->local.reg;
-      // Currently, all parameters are force spilled.
-      spill_vreg(vreg);
+      // Parameters passed in registers are kept in registers,
+      // unless its reference is taken or the function is variadic.
+      if (vreg->flag & VRF_REF || func->type->func.vaargs)
+        spill_vreg(vreg);
       // stack parameters
       if (is_stack_param(varinfo->type)) {
+        spill_vreg(vreg);
         vreg->offset = offset = ALIGN(offset, align_size(varinfo->type));
         offset += type_size(varinfo->type);
         continue;
@@ -508,43 +801,14 @@ static void prepare_register_allocation(Function *func) {
 
       if (through_stack) {
         // Function argument passed through the stack.
+        spill_vreg(vreg);
         vreg->offset = offset;
         offset += WORD_SIZE;
       }
     }
   }
 
-  for (int i = 0; i < func->scopes->len; ++i) {
-    Scope *scope = (Scope*)func->scopes->data[i];
-    if (scope->vars == NULL)
-      continue;
-
-    for (int j = 0; j < scope->vars->len; ++j) {
-      VarInfo *varinfo = scope->vars->data[j];
-      if (varinfo->storage & (VS_STATIC | VS_EXTERN | VS_ENUM_MEMBER))
-        continue;
-      VReg *vreg = varinfo->local.reg;
-      if (vreg == NULL || vreg->flag & VRF_PARAM)
-        continue;
-
-      bool spill = false;
-      if (vreg->flag & VRF_REF)
-        spill = true;
-
-      switch (varinfo->type->kind) {
-      case TY_ARRAY:
-      case TY_STRUCT:
-        // Make non-primitive variable spilled.
-        spill = true;
-        break;
-      default:
-        break;
-      }
-
-      if (spill)
-        spill_vreg(vreg);
-    }
-  }
+  spill_scope_vars(func->scopes);
 }
 
 static void map_virtual_to_physical_registers(RegAlloc *ra) {
@@ -617,6 +881,15 @@ static void detect_living_registers(RegAlloc *ra, BBContainer *bbcon) {
 }
 
 static int alloc_spilled_vregs_onto_stack_frame(RegAlloc *ra, int reserved_size) {
+  // Spilled vregs which are not referenced, and their live intervals are not overlapped,
+  // can share a slot.
+  typedef struct {
+    const VRegType *vtype;
+    int offset;
+    int end;
+  } Slot;
+  Vector *slots = new_vector();  // <Slot*>
+
   int frame_size = reserved_size;
   for (int i = 0; i < ra->vregs->len; ++i) {
     LiveInterval *li = ra->sorted_intervals[i];
@@ -632,6 +905,25 @@ static int alloc_spilled_vregs_onto_stack_frame(RegAlloc *ra, int reserved_size)
     int size, align;
     const VRegType *vtype = vreg->vtype;
     assert(vtype != NULL);
+
+    bool coalescable = !(vreg->flag & VRF_REF) && !(vtype->flag & VRTF_NON_REG) && li->start >= 0;
+    if (coalescable) {
+      Slot *slot = NULL;
+      for (int j = 0; j < slots->len; ++j) {
+        Slot *p = slots->data[j];
+        if (p->end < li->start && p->vtype->size == vtype->size &&
+            p->vtype->align == vtype->align) {
+          slot = p;
+          break;
+        }
+      }
+      if (slot != NULL) {
+        vreg->offset = slot->offset;
+        slot->end = li->end;
+        continue;
+      }
+    }
+
     size = vtype->size;
     align = vtype->align;
     if (size < 1)
@@ -639,6 +931,14 @@ static int alloc_spilled_vregs_onto_stack_frame(RegAlloc *ra, int reserved_size)
 
     frame_size = ALIGN(frame_size + size, align);
     vreg->offset = -frame_size;
+
+    if (coalescable) {
+      Slot *slot = malloc_or_die(sizeof(*slot));
+      slot->vtype = vtype;
+      slot->offset = vreg->offset;
+      slot->end = li->end;
+      vec_push(slots, slot);
+    }
   }
 
   return frame_size;
@@ -687,11 +987,18 @@ static void gen_defun(Function *func) {
   remove_unnecessary_bb(fnbe->bbcon);
 
   prepare_register_allocation(func);
+  if (optimize_level > 0) {
+    begin_phase("optimize");
+    optimize(fnbe->ra, fnbe->bbcon);
+    end_phase("optimize");
+  }
   tweak_irs(fnbe);
   detect_from_bbs(fnbe->bbcon);
   analyze_reg_flow(fnbe->bbcon);
 
+  begin_phase("regalloc");
   alloc_physical_registers(fnbe->ra, fnbe->bbcon);
+  end_phase("regalloc");
   map_virtual_to_physical_registers(fnbe->ra);
   detect_living_registers(fnbe->ra, fnbe->bbcon);
 
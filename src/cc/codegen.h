@@ -7,6 +7,7 @@
 
 typedef struct BB BB;
 typedef struct Expr Expr;
+typedef struct Function Function;
 typedef struct Stmt Stmt;
 typedef struct StructInfo StructInfo;
 typedef struct Type Type;
@@ -20,6 +21,8 @@ extern const char RET_VAR_NAME[];
 
 // Public
 
+extern int optimize_level;
+
 void gen(Vector *decls);
 
 // Private
@@ -41,3 +44,6 @@ typedef VReg *(*BuiltinFunctionProc)(Expr *expr);
 void add_builtin_function(const char *str, Type *type, BuiltinFunctionProc *proc, bool add_to_scope);
 
 void gen_clear_local_var(const VarInfo *varinfo);
+
+Function *get_inlinable_function(Expr *expr);
+VReg *gen_inline_funcall(Expr *expr, Function *func);
@@ -45,11 +45,19 @@ VReg *add_new_reg(const Type *type, int flag) {
   return reg_alloc_spawn(((FuncBackend*)curfunc->extra)->ra, to_vtype(type), flag);
 }
 
-static Table builtin_function_table;  // <BuiltinFunctionProc>
+typedef struct {
+  const Type *type;
+  BuiltinFunctionProc *proc;
+} BuiltinFunction;
+
+static Table builtin_function_table;  // <BuiltinFunction*>
 
 void add_builtin_function(const char *str, Type *type, BuiltinFunctionProc *proc, bool add_to_scope) {
   const Name *name = alloc_name(str, NULL, false);
-  table_put(&builtin_function_table, name, proc);
+  BuiltinFunction *builtin = malloc_or_die(sizeof(*builtin));
+  builtin->type = type;
+  builtin->proc = proc;
+  table_put(&builtin_function_table, name, builtin);
 
   if (add_to_scope)
     scope_add(global_scope, name, type, 0);
@@ -340,13 +348,30 @@ typedef struct {
 #endif
 } ArgInfo;
 
+// Returns the builtin for the callee, only if it is the external function declared as the builtin:
+// a user function of the same name, or one declared with another type, is called as is.
+static BuiltinFunctionProc *find_builtin_function(Expr *func) {
+  if (func->kind != EX_VAR || !is_global_scope(func->var.scope))
+    return NULL;
+  BuiltinFunction *builtin = table_get(&builtin_function_table, func->var.name);
+  if (builtin == NULL)
+    return NULL;
+  VarInfo *varinfo = scope_find(func->var.scope, func->var.name, NULL);
+  if (varinfo == NULL || (varinfo->storage & VS_STATIC) || varinfo->global.func != NULL ||
+      !same_type(varinfo->type, builtin->type))
+    return NULL;
+  return builtin->proc;
+}
+
 static VReg *gen_funcall(Expr *expr) {
   Expr *func = expr->funcall.func;
-  if (func->kind == EX_VAR && is_global_scope(func->var.scope)) {
-    void *proc = table_get(&builtin_function_table, func->var.name);
-    if (proc != NULL)
-      return (*(BuiltinFunctionProc*)proc)(expr);
-  }
+  BuiltinFunctionProc *proc = find_builtin_function(func);
+  if (proc != NULL)
+    return (*proc)(expr);
+  Function *inline_func = get_inlinable_function(expr);
+  if (inline_func != NULL)
+    return gen_inline_funcall(expr, inline_func);
+
   const Type *functype = get_callee_type(func->type);
   assert(functype != NULL);
 
@@ -15,6 +15,7 @@
 #endif
 
 static FILE *emit_fp;
+static const AsmSink *emit_sink;
 
 char *fmt(const char *fm, ...) {
 #define N  8
@@ -87,30 +88,60 @@ char *mangle(char *label) {
 }
 
 void emit_asm0(const char *op) {
+  if (emit_sink != NULL) {
+    (*emit_sink->op)(op, NULL, 0);
+    return;
+  }
   fprintf(emit_fp, "\t%s\n", op);
 }
 
 void emit_asm1(const char *op, const char *a1) {
+  if (emit_sink != NULL) {
+    const char *operands[] = {a1};
+    (*emit_sink->op)(op, operands, 1);
+    return;
+  }
   fprintf(emit_fp, "\t%s %s\n", op, a1);
 }
 
 void emit_asm2(const char *op, const char *a1, const char *a2) {
+  if (emit_sink != NULL) {
+    const char *operands[] = {a1, a2};
+    (*emit_sink->op)(op, operands, 2);
+    return;
+  }
   fprintf(emit_fp, "\t%s %s, %s\n", op, a1, a2);
 }
 
 void emit_asm3(const char *op, const char *a1, const char *a2, const char *a3) {
+  if (emit_sink != NULL) {
+    const char *operands[] = {a1, a2, a3};
+    (*emit_sink->op)(op, operands, 3);
+    return;
+  }
   fprintf(emit_fp, "\t%s %s, %s, %s\n", op, a1, a2, a3);
 }
 
 void emit_asm4(const char *op, const char *a1, const char *a2, const char *a3, const char *a4) {
+  if (emit_sink != NULL) {
+    const char *operands[] = {a1, a2, a3, a4};
+    (*emit_sink->op)(op, operands, 4);
+    return;
+  }
   fprintf(emit_fp, "\t%s %s, %s, %s, %s\n", op, a1, a2, a3, a4);
 }
 
 void emit_label(const char *label) {
+  if (emit_sink != NULL) {
+    (*emit_sink->label)(label);
+    return;
+  }
   fprintf(emit_fp, "%s:\n", label);
 }
 
 void emit_comment(const char *comment, ...) {
+  if (emit_sink != NULL)
+    return;
   if (comment == NULL) {
     fprintf(emit_fp, "\n");
     return;
@@ -128,7 +159,7 @@ void emit_align_p2(int align) {
   if (align <= 1)
     return;
   assert(IS_POWER_OF_2(align));
-  fprintf(emit_fp, "\t.p2align %d\n", most_significant_bit(align));
+  emit_asm1(".p2align", num(most_significant_bit(align)));
 }
 
 void emit_bss(const char *label, size_t size, size_t align) {
@@ -138,10 +169,16 @@ void emit_bss(const char *label, size_t size, size_t align) {
   if (align <= 1)
     emit_asm2(".comm", label, num(size));
   else
-    fprintf(emit_fp, "\t.comm %s, %zu, %zu\n", label, size, align);
+    emit_asm3(".comm", label, num(size), num(align));
 #endif
 }
 
 void init_emit(FILE *fp) {
   emit_fp = fp;
+  emit_sink = NULL;
+}
+
+void init_emit_sink(const AsmSink *sink) {
+  emit_fp = NULL;
+  emit_sink = sink;
 }
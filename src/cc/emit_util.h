@@ -16,6 +16,13 @@
 
 typedef struct Name Name;
 
+// Receives each instruction as opcode and operand texts instead of lines,
+// e.g. integrated assembler.
+typedef struct AsmSink {
+  void (*label)(const char *label);
+  void (*op)(const char *op, const char **operands, int count);
+} AsmSink;
+
 char *fmt(const char *s, ...);
 char *fmt_name(const Name *name);
 char *quote_label(char *label);
@@ -27,6 +34,7 @@ char *flonum(double x);
 char *mangle(char *label);
 
 void init_emit(FILE *fp);
+void init_emit_sink(const AsmSink *sink);
 void emit_label(const char *label);
 void emit_asm0(const char *op);
 void emit_asm1(const char *op, const char *a1);
@@ -341,6 +341,7 @@ BB *new_bb(void) {
   bb->from_bbs = new_vector();
   bb->label = alloc_label();
   bb->irs = new_vector();
+  bb->phis = NULL;
   bb->in_regs = NULL;
   bb->out_regs = NULL;
   bb->assigned_regs = NULL;
@@ -355,7 +356,7 @@ BBContainer *new_func_blocks(void) {
 
 //
 
-static enum ConditionKind invert_cond(enum ConditionKind cond) {
+enum ConditionKind invert_cond(enum ConditionKind cond) {
   int c = cond & COND_MASK;
   assert(COND_EQ <= c && c <= COND_GT);
   int ic = c <= COND_NE ? (COND_NE + COND_EQ) - c
@@ -483,25 +484,30 @@ void remove_unnecessary_bb(BBContainer *bbcon) {
 }
 
 void detect_from_bbs(BBContainer *bbcon) {
+  for (int i = 0; i < bbcon->bbs->len; ++i) {
+    BB *bb = bbcon->bbs->data[i];
+    vec_clear(bb->from_bbs);
+  }
+
   for (int i = 0; i < bbcon->bbs->len; ++i) {
     BB *bb = bbcon->bbs->data[i];
     Vector *irs = bb->irs;
-    if (irs->len == 0)
-      continue;
-    IR *ir = irs->data[irs->len - 1];
-    switch (ir->kind) {
-    case IR_JMP:
-      vec_push(ir->jmp.bb->from_bbs, bb);
-      if (ir->jmp.cond == COND_ANY)
+    if (irs->len > 0) {  // Empty block just falls through.
+      IR *ir = irs->data[irs->len - 1];
+      switch (ir->kind) {
+      case IR_JMP:
+        vec_push(ir->jmp.bb->from_bbs, bb);
+        if (ir->jmp.cond == COND_ANY)
+          continue;
+        break;
+      case IR_TJMP:
+        for (size_t j = 0; j < ir->tjmp.len; ++j) {
+          BB *nbb = ir->tjmp.bbs[j];
+          vec_push(nbb->from_bbs, bb);
+        }
         continue;
-      break;
-    case IR_TJMP:
-      for (size_t j = 0; j < ir->tjmp.len; ++j) {
-        BB *nbb = ir->tjmp.bbs[j];
-        vec_push(nbb->from_bbs, bb);
+      default: break;
       }
-      continue;
-    default: break;
     }
     if (bb->next != NULL)
       vec_push(bb->next->from_bbs, bb);
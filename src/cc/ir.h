@@ -67,6 +67,10 @@ enum IrKind {
   IR_CMP,     // opr1 - opr2
   IR_NEG,
   IR_BITNOT,
+  IR_SQRT,    // Flonum unary ops: dst = op(opr1)
+  IR_FABS,
+  IR_FLOOR,
+  IR_CEIL,
   IR_COND,    // dst <- flag
   IR_JMP,     // Jump with condition
   IR_TJMP,    // Table jump
@@ -184,6 +188,13 @@ IR *new_ir_store_spilled(VReg *dst, VReg *reg);
 
 extern RegAlloc *curra;
 
+// Phi node: dst = params[i] when the control comes from from_bbs[i].
+
+typedef struct Phi {
+  VReg *dst;
+  Vector *params;  // <VReg*>, parallel to `from_bbs`
+} Phi;
+
 // Basci Block:
 //   Chunk of IR codes without branching in the middle (except at the bottom).
 
@@ -192,6 +203,7 @@ typedef struct BB {
   Vector *from_bbs;
   const Name *label;
   Vector *irs;  // <IR*>
+  Vector *phis;  // <Phi*>, only while in SSA form.
 
   Vector *in_regs;  // <VReg*>
   Vector *out_regs;  // <VReg*>
@@ -209,10 +221,12 @@ typedef struct BBContainer {
 
 BBContainer *new_func_blocks(void);
 void remove_unnecessary_bb(BBContainer *bbcon);
+enum ConditionKind invert_cond(enum ConditionKind cond);
 void detect_from_bbs(BBContainer *bbcon);
 void analyze_reg_flow(BBContainer *bbcon);
 int push_callee_save_regs(unsigned long used, unsigned long fused);
 void pop_callee_save_regs(unsigned long used, unsigned long fused);
+void move_param_to_reg(VReg *vreg, const char *src);
 
 void emit_bb_irs(BBContainer *bbcon);
 
@@ -21,6 +21,7 @@ Token *alloc_token(enum TokenKind kind, Line *line, const char *begin, const cha
   token->line = line;
   token->begin = begin;
   token->end = end;
+  token->hideset = NULL;
   return token;
 }
 
@@ -244,7 +245,7 @@ void init_lexer(void) {
 }
 
 void set_source_file(FILE *fp, const char *filename) {
-  lexer.fp = fp;
+  lexer.reader = fp != NULL ? read_source(fp) : NULL;
   lexer.filename = filename;
   lexer.line = NULL;
   lexer.p = "";
@@ -258,7 +259,7 @@ void set_source_string(const char *line, const char *filename, int lineno) {
   p->buf = line;
   p->lineno = lineno;
 
-  lexer.fp = NULL;
+  lexer.reader = NULL;
   lexer.filename = filename;
   lexer.line = p;
   lexer.p = line;
@@ -309,7 +310,7 @@ static int scan_linemarker(const char *line, long *pnum, char **pfn, int *pflag)
 }
 
 static void read_next_line(void) {
-  if (lexer.fp == NULL) {
+  if (lexer.reader == NULL) {
     if (!lex_eof_continue()) {
       lexer.p = NULL;
       lexer.line = NULL;
@@ -318,9 +319,8 @@ static void read_next_line(void) {
   }
 
   char *line = NULL;
-  size_t capa = 0;
   for (;;) {
-    ssize_t len = getline_cont(&line, &capa, lexer.fp, &lexer.lineno);
+    ssize_t len = source_getline(lexer.reader, &line, &lexer.lineno);
     if (len == -1) {
       if (lex_eof_continue())
         continue;
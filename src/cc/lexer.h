@@ -9,9 +9,10 @@
 
 typedef struct Line Line;
 typedef struct Name Name;
+typedef struct SourceReader SourceReader;
 
 typedef struct {
-  FILE *fp;
+  SourceReader *reader;
   const char *filename;
   Line *line;
   const char *p;
@@ -0,0 +1,1570 @@
+// Optimization on SSA form
+
+#include "../config.h"
+#include "optimize.h"
+
+#include <assert.h>
+#include <stdint.h>  // intptr_t
+#include <stdlib.h>  // calloc, qsort
+#include <string.h>  // memcpy
+
+#include "ir.h"
+#include "regalloc.h"
+#include "ssa.h"
+#include "table.h"
+#include "util.h"
+
+// IR which has no side effect except assigning to `dst`.
+static bool is_pure_ir(enum IrKind kind) {
+  switch (kind) {
+  case IR_BOFS:
+  case IR_IOFS:
+  case IR_SOFS:
+  case IR_ADD:  // binops
+  case IR_SUB:
+  case IR_MUL:
+  case IR_DIV:
+  case IR_MOD:
+  case IR_BITAND:
+  case IR_BITOR:
+  case IR_BITXOR:
+  case IR_LSHIFT:
+  case IR_RSHIFT:
+  case IR_NEG:  // unary ops
+  case IR_BITNOT:
+  case IR_SQRT:
+  case IR_FABS:
+  case IR_FLOOR:
+  case IR_CEIL:
+  case IR_COND:
+  case IR_CAST:
+  case IR_MOV:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool is_commutative(enum IrKind kind) {
+  switch (kind) {
+  case IR_ADD:
+  case IR_MUL:
+  case IR_BITAND:
+  case IR_BITOR:
+  case IR_BITXOR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool same_vtype(const VRegType *a, const VRegType *b) {
+  return a->size == b->size && a->flag == b->flag;
+}
+
+// Definition info
+
+typedef struct DefInfo {
+  int vreg_count;
+  int *counts;  // Assignment count for each register.
+} DefInfo;
+
+static void count_defs(DefInfo *defs, RegAlloc *ra, BBContainer *bbcon) {
+  int vreg_count = ra->vregs->len;
+  int *counts = calloc(vreg_count + 1, sizeof(*counts));
+  for (int i = 0; i < bbcon->bbs->len; ++i) {
+    BB *bb = bbcon->bbs->data[i];
+    if (bb->phis != NULL) {
+      for (int j = 0; j < bb->phis->len; ++j) {
+        Phi *phi = bb->phis->data[j];
+        ++counts[phi->dst->virt];
+      }
+    }
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->dst != NULL)
+        ++counts[ir->dst->virt];
+      // Register whose address is taken might be modified indirectly.
+      if (ir->kind == IR_BOFS && ir->opr1 != NULL && !(ir->opr1->flag & VRF_CONST))
+        counts[ir->opr1->virt] += 2;
+    }
+  }
+  defs->vreg_count = vreg_count;
+  defs->counts = counts;
+}
+
+// Whether the register holds an unique value through the function.
+static bool is_value_reg(const DefInfo *defs, VReg *vreg) {
+  if (vreg == NULL || vreg->virt >= defs->vreg_count ||
+      (vreg->flag & (VRF_CONST | VRF_SPILLED | VRF_REF)) ||
+      (vreg->vtype->flag & VRTF_NON_REG))
+    return false;
+  return defs->counts[vreg->virt] <= 1;
+}
+
+// Find the comparison which sets the flag used at `index` in `bb`.
+static IR *find_flag_source(BB *bb, int index) {
+  for (int n = 0; n < 4; ++n) {
+    for (int i = index; --i >= 0; ) {
+      IR *ir = bb->irs->data[i];
+      if (ir->kind == IR_CMP)
+        return ir;
+    }
+
+    // Continue to the single predecessor.
+    Vector *from_bbs = bb->from_bbs;
+    if (from_bbs->len == 0)
+      return NULL;
+    BB *from = from_bbs->data[0];
+    for (int i = 1; i < from_bbs->len; ++i) {
+      if (from_bbs->data[i] != from)
+        return NULL;
+    }
+    bb = from;
+    index = bb->irs->len;
+  }
+  return NULL;
+}
+
+// Sparse conditional constant propagation
+
+enum LatticeState {
+  LAT_TOP,     // Undetermined yet.
+  LAT_CONST,
+  LAT_BOTTOM,  // Not a constant.
+};
+
+typedef struct Lattice {
+  enum LatticeState state;
+  int64_t value;
+} Lattice;
+
+typedef struct BBState {
+  bool executable;
+  bool *edges;  // Whether the edge from `from_bbs[i]` is executable.
+} BBState;
+
+typedef struct Sccp {
+  BBContainer *bbcon;
+  DefInfo defs;
+  Lattice *lattices;
+  BBState *states;  // Parallel to `bbcon->bbs`.
+  Table bbtbl;      // <BB label, BBState*>
+  bool changed;
+} Sccp;
+
+static BBState *get_state(Sccp *sccp, BB *bb) {
+  BBState *state = table_get(&sccp->bbtbl, bb->label);
+  assert(state != NULL);
+  return state;
+}
+
+static enum LatticeState get_lattice(Sccp *sccp, VReg *vreg, int64_t *pvalue) {
+  if (vreg == NULL)
+    return LAT_BOTTOM;
+  if (vreg->flag & VRF_CONST) {
+    *pvalue = vreg->fixnum;
+    return LAT_CONST;
+  }
+  // Unassigned register holds an unknown value (function parameter, or undefined).
+  if (!is_value_reg(&sccp->defs, vreg) || sccp->defs.counts[vreg->virt] == 0)
+    return LAT_BOTTOM;
+#ifndef __NO_FLONUM
+  if (vreg->vtype->flag & VRTF_FLONUM)
+    return LAT_BOTTOM;
+#endif
+  Lattice *lat = &sccp->lattices[vreg->virt];
+  *pvalue = lat->value;
+  return lat->state;
+}
+
+static void update_lattice(Sccp *sccp, VReg *vreg, enum LatticeState state, int64_t value) {
+  if (!is_value_reg(&sccp->defs, vreg))
+    return;
+  Lattice *lat = &sccp->lattices[vreg->virt];
+  if (lat->state == LAT_BOTTOM || state == LAT_TOP)
+    return;
+  if (lat->state == LAT_CONST && state == LAT_CONST) {
+    if (lat->value == value)
+      return;
+    state = LAT_BOTTOM;
+  }
+  lat->state = state;
+  lat->value = value;
+  sccp->changed = true;
+}
+
+static bool fold_bop(IR *ir, int64_t lhs, int64_t rhs, int64_t *presult) {
+  const VRegType *vtype = ir->dst->vtype;
+  bool is_unsigned = (vtype->flag & VRTF_UNSIGNED) != 0;
+  uint64_t ulhs = lhs, urhs = rhs;
+  int64_t value;
+  switch (ir->kind) {
+  case IR_ADD:     value = ulhs + urhs; break;
+  case IR_SUB:     value = ulhs - urhs; break;
+  case IR_MUL:     value = ulhs * urhs; break;
+  case IR_BITAND:  value = lhs & rhs; break;
+  case IR_BITOR:   value = lhs | rhs; break;
+  case IR_BITXOR:  value = lhs ^ rhs; break;
+
+  case IR_DIV:
+  case IR_MOD:
+    if (rhs == 0)
+      return false;  // Leave it to the runtime.
+    if (is_unsigned) {
+      value = ir->kind == IR_DIV ? ulhs / urhs : ulhs % urhs;
+    } else if (rhs == -1) {  // Avoid overflow of the minimum value divided by -1.
+      value = ir->kind == IR_DIV ? (int64_t)-ulhs : 0;
+    } else {
+      value = ir->kind == IR_DIV ? lhs / rhs : lhs % rhs;
+    }
+    break;
+
+  case IR_LSHIFT:
+  case IR_RSHIFT:
+    if (rhs < 0 || rhs >= vtype->size * 8)
+      return false;
+    if (ir->kind == IR_LSHIFT)
+      value = ulhs << rhs;
+    else if (ir->opr1->vtype->flag & VRTF_UNSIGNED)
+      value = ulhs >> rhs;
+    else
+      value = lhs >> rhs;
+    break;
+
+  default:
+    return false;
+  }
+  *presult = wrap_value(value, vtype->size, is_unsigned);
+  return true;
+}
+
+static enum LatticeState eval_cond(Sccp *sccp, BB *bb, int index, enum ConditionKind cond,
+                                   bool *presult) {
+  switch (cond & COND_MASK) {
+  case COND_NONE:  *presult = false; return LAT_CONST;
+  case COND_ANY:   *presult = true; return LAT_CONST;
+  default: break;
+  }
+#ifndef __NO_FLONUM
+  if (cond & COND_FLONUM)
+    return LAT_BOTTOM;
+#endif
+
+  IR *cmp = find_flag_source(bb, index);
+  if (cmp == NULL)
+    return LAT_BOTTOM;
+  int64_t lhs = 0, rhs = 0;
+  enum LatticeState s1 = get_lattice(sccp, cmp->opr1, &lhs);
+  enum LatticeState s2 = get_lattice(sccp, cmp->opr2, &rhs);
+  if (s1 == LAT_BOTTOM || s2 == LAT_BOTTOM)
+    return LAT_BOTTOM;
+  if (s1 == LAT_TOP || s2 == LAT_TOP)
+    return LAT_TOP;
+
+  bool result;
+  uint64_t ulhs = lhs, urhs = rhs;
+  bool is_unsigned = (cond & COND_UNSIGNED) != 0;
+  switch (cond & COND_MASK) {
+  case COND_EQ:  result = lhs == rhs; break;
+  case COND_NE:  result = lhs != rhs; break;
+  case COND_LT:  result = is_unsigned ? ulhs <  urhs : lhs <  rhs; break;
+  case COND_LE:  result = is_unsigned ? ulhs <= urhs : lhs <= rhs; break;
+  case COND_GE:  result = is_unsigned ? ulhs >= urhs : lhs >= rhs; break;
+  case COND_GT:  result = is_unsigned ? ulhs >  urhs : lhs >  rhs; break;
+  default:
+    return LAT_BOTTOM;
+  }
+  *presult = result;
+  return LAT_CONST;
+}
+
+static enum LatticeState evaluate(Sccp *sccp, BB *bb, int index, int64_t *pvalue) {
+  IR *ir = bb->irs->data[index];
+  const VRegType *vtype = ir->dst->vtype;
+#ifndef __NO_FLONUM
+  if (vtype->flag & VRTF_FLONUM)
+    return LAT_BOTTOM;
+#endif
+  bool is_unsigned = (vtype->flag & VRTF_UNSIGNED) != 0;
+  int64_t lhs = 0, rhs = 0;
+  enum LatticeState s1, s2;
+  switch (ir->kind) {
+  case IR_MOV:
+  case IR_CAST:
+#ifndef __NO_FLONUM
+    if (ir->opr1->vtype->flag & VRTF_FLONUM)
+      return LAT_BOTTOM;
+#endif
+    s1 = get_lattice(sccp, ir->opr1, &lhs);
+    if (s1 == LAT_CONST)
+      *pvalue = wrap_value(lhs, vtype->size, is_unsigned);
+    return s1;
+
+  case IR_NEG:
+  case IR_BITNOT:
+    s1 = get_lattice(sccp, ir->opr1, &lhs);
+    if (s1 == LAT_CONST)
+      *pvalue = wrap_value(ir->kind == IR_NEG ? (int64_t)-(uint64_t)lhs : ~lhs, vtype->size,
+                           is_unsigned);
+    return s1;
+
+  case IR_ADD:  // binops
+  case IR_SUB:
+  case IR_MUL:
+  case IR_DIV:
+  case IR_MOD:
+  case IR_BITAND:
+  case IR_BITOR:
+  case IR_BITXOR:
+  case IR_LSHIFT:
+  case IR_RSHIFT:
+    s1 = get_lattice(sccp, ir->opr1, &lhs);
+    s2 = get_lattice(sccp, ir->opr2, &rhs);
+    if (s1 == LAT_BOTTOM || s2 == LAT_BOTTOM)
+      return LAT_BOTTOM;
+    if (s1 == LAT_TOP || s2 == LAT_TOP)
+      return LAT_TOP;
+    return fold_bop(ir, lhs, rhs, pvalue) ? LAT_CONST : LAT_BOTTOM;
+
+  case IR_COND:
+    {
+      bool result;
+      enum LatticeState s = eval_cond(sccp, bb, index, ir->cond.kind, &result);
+      if (s == LAT_CONST)
+        *pvalue = result;
+      return s;
+    }
+
+  default:
+    return LAT_BOTTOM;
+  }
+}
+
+static void mark_edge(Sccp *sccp, BB *from, BB *to) {
+  BBState *state = get_state(sccp, to);
+  Vector *from_bbs = to->from_bbs;
+  for (int i = 0; i < from_bbs->len; ++i) {
+    if (from_bbs->data[i] == from && !state->edges[i]) {
+      state->edges[i] = true;
+      sccp->changed = true;
+    }
+  }
+  if (!state->executable) {
+    state->executable = true;
+    sccp->changed = true;
+  }
+}
+
+static void visit_bb(Sccp *sccp, BB *bb, BBState *state) {
+  if (bb->phis != NULL) {
+    for (int i = 0; i < bb->phis->len; ++i) {
+      Phi *phi = bb->phis->data[i];
+      for (int j = 0; j < phi->params->len; ++j) {
+        if (!state->edges[j])
+          continue;
+        int64_t value = 0;
+        enum LatticeState s = get_lattice(sccp, phi->params->data[j], &value);
+        update_lattice(sccp, phi->dst, s, value);
+      }
+    }
+  }
+
+  Vector *irs = bb->irs;
+  for (int i = 0; i < irs->len; ++i) {
+    IR *ir = irs->data[i];
+    if (ir->dst == NULL)
+      continue;
+    int64_t value = 0;
+    enum LatticeState s = evaluate(sccp, bb, i, &value);
+    update_lattice(sccp, ir->dst, s, value);
+  }
+
+  IR *ir = irs->len > 0 ? irs->data[irs->len - 1] : NULL;
+  if (ir != NULL && ir->kind == IR_JMP) {
+    bool result = false;
+    enum LatticeState s = eval_cond(sccp, bb, irs->len - 1, ir->jmp.cond, &result);
+    if (s == LAT_TOP)
+      return;
+    if (s == LAT_BOTTOM || result)
+      mark_edge(sccp, bb, ir->jmp.bb);
+    if ((s == LAT_BOTTOM || !result) && bb->next != NULL)
+      mark_edge(sccp, bb, bb->next);
+    return;
+  }
+  if (ir != NULL && ir->kind == IR_TJMP) {
+    int64_t value = 0;
+    enum LatticeState s = get_lattice(sccp, ir->opr1, &value);
+    if (s == LAT_TOP)
+      return;
+    if (s == LAT_CONST && value >= 0 && (uint64_t)value < ir->tjmp.len) {
+      mark_edge(sccp, bb, ir->tjmp.bbs[value]);
+    } else {
+      for (size_t i = 0; i < ir->tjmp.len; ++i)
+        mark_edge(sccp, bb, ir->tjmp.bbs[i]);
+    }
+    return;
+  }
+  if (bb->next != NULL)
+    mark_edge(sccp, bb, bb->next);
+}
+
+static VReg *const_operand(Sccp *sccp, VReg *vreg, bool any) {
+  int64_t value = 0;
+  if (vreg == NULL || (vreg->flag & VRF_CONST) ||
+      get_lattice(sccp, vreg, &value) != LAT_CONST ||
+      !(any || is_im32(value)))
+    return NULL;
+  return new_const_vreg(value, vreg->vtype);
+}
+
+// Replace operands with constants, as far as the backends accept.
+static void substitute_consts(Sccp *sccp, IR *ir) {
+  VReg *c;
+  switch (ir->kind) {
+  case IR_ADD:  // binops
+  case IR_SUB:
+  case IR_MUL:
+  case IR_DIV:
+  case IR_MOD:
+  case IR_BITAND:
+  case IR_BITOR:
+  case IR_BITXOR:
+  case IR_LSHIFT:
+  case IR_RSHIFT:
+    if (ir->opr1->flag & VRF_CONST)
+      break;
+    if ((c = const_operand(sccp, ir->opr2, false)) != NULL) {
+      ir->opr2 = c;
+    } else if (is_commutative(ir->kind) && !(ir->opr2->flag & VRF_CONST) &&
+               (c = const_operand(sccp, ir->opr1, false)) != NULL) {
+      ir->opr1 = ir->opr2;
+      ir->opr2 = c;
+    }
+
+    // Remove operation with identity element.
+    if ((ir->opr2->flag & VRF_CONST) && same_vtype(ir->dst->vtype, ir->opr1->vtype)) {
+      int64_t value = ir->opr2->fixnum;
+      bool identity = false;
+      switch (ir->kind) {
+      case IR_ADD: case IR_SUB: case IR_BITOR: case IR_BITXOR: case IR_LSHIFT: case IR_RSHIFT:
+        identity = value == 0;
+        break;
+      case IR_MUL: case IR_DIV:
+        identity = value == 1;
+        break;
+      default: break;
+      }
+      if (identity) {
+        ir->kind = IR_MOV;
+        ir->opr2 = NULL;
+      }
+    }
+    break;
+
+  case IR_CMP:
+    if (!(ir->opr1->flag & VRF_CONST) && (c = const_operand(sccp, ir->opr2, false)) != NULL)
+      ir->opr2 = c;
+    break;
+
+  case IR_STORE:
+  case IR_PUSHARG:
+  case IR_RESULT:
+    if ((c = const_operand(sccp, ir->opr1, false)) != NULL)
+      ir->opr1 = c;
+    break;
+
+  case IR_MOV:
+    if ((c = const_operand(sccp, ir->opr1, true)) != NULL)
+      ir->opr1 = c;
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void rewrite_bb(Sccp *sccp, BB *bb) {
+  Vector *irs = bb->irs;
+
+  // Constant phi turns into a move.
+  int pos = 0;
+  if (bb->phis != NULL) {
+    for (int i = 0; i < bb->phis->len; ++i) {
+      Phi *phi = bb->phis->data[i];
+      VReg *c = const_operand(sccp, phi->dst, true);
+      if (c != NULL) {
+        vec_insert(irs, pos++, new_ir_mov(phi->dst, c));
+        vec_remove_at(bb->phis, i--);
+      }
+    }
+  }
+
+  for (int i = pos; i < irs->len; ++i) {
+    IR *ir = irs->data[i];
+    VReg *c;
+    if (ir->dst != NULL && is_pure_ir(ir->kind) &&
+        !(ir->kind == IR_MOV && (ir->opr1->flag & VRF_CONST)) &&
+        (c = const_operand(sccp, ir->dst, true)) != NULL) {
+      ir->kind = IR_MOV;
+      ir->opr1 = c;
+      ir->opr2 = NULL;
+      continue;
+    }
+    substitute_consts(sccp, ir);
+  }
+
+  // Fold branches, according to the executable edges.
+  IR *ir = irs->len > 0 ? irs->data[irs->len - 1] : NULL;
+  if (ir != NULL && ir->kind == IR_JMP && ir->jmp.cond != COND_ANY) {
+    BBState *jstate = get_state(sccp, ir->jmp.bb);
+    BBState *nstate = get_state(sccp, bb->next);
+    bool taken = false, fallthrough = false;
+    for (int i = 0; i < ir->jmp.bb->from_bbs->len; ++i)
+      taken |= ir->jmp.bb->from_bbs->data[i] == bb && jstate->edges[i];
+    for (int i = 0; i < bb->next->from_bbs->len; ++i)
+      fallthrough |= bb->next->from_bbs->data[i] == bb && nstate->edges[i];
+    assert(taken || fallthrough);
+    if (!fallthrough)
+      ir->jmp.cond = COND_ANY;
+    else if (!taken)
+      vec_pop(irs);
+  } else if (ir != NULL && ir->kind == IR_TJMP) {
+    int64_t value = 0;
+    if (get_lattice(sccp, ir->opr1, &value) == LAT_CONST && value >= 0 &&
+        (uint64_t)value < ir->tjmp.len) {
+      BB *dst = ir->tjmp.bbs[value];
+      ir->kind = IR_JMP;
+      ir->opr1 = NULL;
+      ir->jmp.bb = dst;
+      ir->jmp.cond = COND_ANY;
+    }
+  }
+}
+
+static void propagate_constants(RegAlloc *ra, BBContainer *bbcon) {
+  Sccp sccp;
+  sccp.bbcon = bbcon;
+  count_defs(&sccp.defs, ra, bbcon);
+  sccp.lattices = calloc(sccp.defs.vreg_count + 1, sizeof(*sccp.lattices));
+
+  Vector *bbs = bbcon->bbs;
+  sccp.states = calloc(bbs->len, sizeof(*sccp.states));
+  table_init(&sccp.bbtbl);
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    BBState *state = &sccp.states[i];
+    state->executable = i == 0;
+    state->edges = calloc(bb->from_bbs->len + 1, sizeof(*state->edges));
+    table_put(&sccp.bbtbl, bb->label, state);
+  }
+
+  do {
+    sccp.changed = false;
+    for (int i = 0; i < bbs->len; ++i) {
+      BBState *state = &sccp.states[i];
+      if (state->executable)
+        visit_bb(&sccp, bbs->data[i], state);
+    }
+  } while (sccp.changed);
+
+  for (int i = 0; i < bbs->len; ++i) {
+    if (sccp.states[i].executable)
+      rewrite_bb(&sccp, bbs->data[i]);
+  }
+
+  // Remove dead edges.
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    BBState *state = &sccp.states[i];
+    for (int j = bb->from_bbs->len; --j >= 0; ) {
+      if (state->edges[j])
+        continue;
+      vec_remove_at(bb->from_bbs, j);
+      if (bb->phis != NULL) {
+        for (int k = 0; k < bb->phis->len; ++k) {
+          Phi *phi = bb->phis->data[k];
+          vec_remove_at(phi->params, j);
+        }
+      }
+    }
+  }
+
+  // Remove unreachable blocks, except the last one.
+  for (int i = bbs->len - 1; --i >= 1; ) {
+    if (sccp.states[i].executable)
+      continue;
+    BB *bb = bbs->data[i];
+    BB *prev = bbs->data[i - 1];
+    prev->next = bb->next;
+    vec_remove_at(bbs, i);
+  }
+  BB *last = bbs->data[bbs->len - 1];
+  if (!sccp.states[bbs->len - 1].executable)
+    last->phis = NULL;
+
+  for (int i = 0; i < bbs->len; ++i)
+    free(sccp.states[i].edges);
+  free(sccp.states);
+  free(sccp.lattices);
+  free(sccp.defs.counts);
+}
+
+// Copy propagation
+
+static VReg *resolve_copy(VReg **copies, int vreg_count, VReg *vreg) {
+  while (vreg != NULL && vreg->virt < vreg_count && copies[vreg->virt] != NULL)
+    vreg = copies[vreg->virt];
+  return vreg;
+}
+
+static void propagate_copies(RegAlloc *ra, BBContainer *bbcon) {
+  DefInfo defs;
+  count_defs(&defs, ra, bbcon);
+  int vreg_count = defs.vreg_count;
+  VReg **copies = calloc(vreg_count + 1, sizeof(*copies));
+
+  Vector *bbs = bbcon->bbs;
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->kind == IR_MOV && is_value_reg(&defs, ir->dst) && is_value_reg(&defs, ir->opr1) &&
+          same_vtype(ir->dst->vtype, ir->opr1->vtype))
+        copies[ir->dst->virt] = ir->opr1;
+    }
+  }
+
+  // Phi which merges the same value.
+  for (bool again = true; again; ) {
+    again = false;
+    for (int i = 0; i < bbs->len; ++i) {
+      BB *bb = bbs->data[i];
+      if (bb->phis == NULL)
+        continue;
+      for (int j = 0; j < bb->phis->len; ++j) {
+        Phi *phi = bb->phis->data[j];
+        if (copies[phi->dst->virt] != NULL)
+          continue;
+        VReg *unique = NULL;
+        for (int k = 0; k < phi->params->len; ++k) {
+          VReg *param = resolve_copy(copies, vreg_count, phi->params->data[k]);
+          if (param == phi->dst || param == unique)
+            continue;
+          if (unique != NULL) {
+            unique = NULL;
+            break;
+          }
+          unique = param;
+        }
+        if (unique != NULL && is_value_reg(&defs, unique) &&
+            same_vtype(phi->dst->vtype, unique->vtype)) {
+          copies[phi->dst->virt] = unique;
+          again = true;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    if (bb->phis != NULL) {
+      for (int j = 0; j < bb->phis->len; ++j) {
+        Phi *phi = bb->phis->data[j];
+        if (copies[phi->dst->virt] != NULL) {
+          vec_remove_at(bb->phis, j--);
+          continue;
+        }
+        for (int k = 0; k < phi->params->len; ++k)
+          phi->params->data[k] = resolve_copy(copies, vreg_count, phi->params->data[k]);
+      }
+    }
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      ir->opr1 = resolve_copy(copies, vreg_count, ir->opr1);
+      ir->opr2 = resolve_copy(copies, vreg_count, ir->opr2);
+    }
+  }
+
+  free(copies);
+  free(defs.counts);
+}
+
+// Loop optimization: loop-invariant code motion and strength reduction
+
+typedef struct Loop {
+  BB *header;
+  BB *preheader;  // Unique predecessor from outside, which jumps only to the header.
+  int *blocks;    // Indices in `bbcon->bbs` of the blocks in the body, in ascending order.
+  int size;       // Number of blocks in the body.
+} Loop;
+
+// Induction variable: its value is `init` at the entry of the loop,
+// and increased by `step` at `update`.
+typedef struct IndVar {
+  VReg *init;
+  int64_t step;
+  VReg *cur;      // Value in the current iteration, assigned by the phi in the header.
+  VReg *next;     // Value for the next iteration.
+  IR *update;     // IR of the basic induction variable which updates it.
+  BB *update_bb;
+  // Derived induction variable is `kind(cast(base), other)`.
+  struct IndVar *base;  // NULL for the basic one.
+  enum IrKind kind;
+  VReg *other;
+  const VRegType *cast_vtype;
+} IndVar;
+
+typedef struct LoopOpt {
+  RegAlloc *ra;
+  BBContainer *bbcon;
+  Table bbtbl;    // <BB label, index+1>
+  DefInfo defs;
+  int *def_bbs;   // Block index + 1 which assigns the register, 0 if assigned at the entry.
+  IR **def_irs;
+  int *uses;      // Reference count of the register.
+  IndVar **ivs;
+  Vector *iv_list;  // <IndVar*>
+  Loop *loop;
+  bool *in_loop;  // Whether the block belongs to `loop`.
+} LoopOpt;
+
+static int bb_index(LoopOpt *lopt, BB *bb) {
+  return (intptr_t)table_get(&lopt->bbtbl, bb->label) - 1;
+}
+
+static bool is_single_jump_to(BB *bb, BB *to) {
+  IR *ir = bb->irs->len > 0 ? bb->irs->data[bb->irs->len - 1] : NULL;
+  if (ir != NULL && ir->kind == IR_JMP)
+    return ir->jmp.cond == COND_ANY && ir->jmp.bb == to;
+  return (ir == NULL || ir->kind != IR_TJMP) && bb->next == to;
+}
+
+static int compare_int(const void *pa, const void *pb) {
+  return *(int*)pa - *(int*)pb;
+}
+
+// Collect the natural loop of the back edges from `latches` to the block `h`,
+// by walking predecessors back to the header.
+// `mark` is stamped with `h + 1`, so it need not be cleared for each header.
+// Fails if the function entry is reached, that is, the header does not dominate a latch.
+static Loop *collect_loop(LoopOpt *lopt, int h, Vector *latches, int *mark, Vector *work,
+                          Vector *body) {
+  Vector *bbs = lopt->bbcon->bbs;
+  int stamp = h + 1;
+  vec_clear(work);
+  vec_clear(body);
+  mark[h] = stamp;
+  vec_push(body, (void*)(intptr_t)h);
+  for (int i = 0; i < latches->len; ++i) {
+    int k = (intptr_t)latches->data[i];
+    if (mark[k] != stamp) {
+      mark[k] = stamp;
+      vec_push(work, (void*)(intptr_t)k);
+    }
+  }
+  while (work->len > 0) {
+    int k = (intptr_t)vec_pop(work);
+    if (k == 0)
+      return NULL;
+    vec_push(body, (void*)(intptr_t)k);
+    BB *bb = bbs->data[k];
+    for (int i = 0; i < bb->from_bbs->len; ++i) {
+      int f = bb_index(lopt, bb->from_bbs->data[i]);
+      if (mark[f] != stamp) {
+        mark[f] = stamp;
+        vec_push(work, (void*)(intptr_t)f);
+      }
+    }
+  }
+
+  // The header must be the only entry of the loop, from the unique preheader.
+  BB *header = bbs->data[h];
+  BB *preheader = NULL;
+  for (int i = 0; i < body->len; ++i) {
+    BB *bb = bbs->data[(intptr_t)body->data[i]];
+    for (int j = 0; j < bb->from_bbs->len; ++j) {
+      BB *from = bb->from_bbs->data[j];
+      if (mark[bb_index(lopt, from)] == stamp)
+        continue;
+      if (bb != header || (preheader != NULL && preheader != from))
+        return NULL;
+      preheader = from;
+    }
+  }
+  if (preheader == NULL || !is_single_jump_to(preheader, header))
+    return NULL;
+
+  Loop *loop = malloc_or_die(sizeof(*loop));
+  loop->header = header;
+  loop->preheader = preheader;
+  loop->size = body->len;
+  loop->blocks = malloc_or_die(sizeof(*loop->blocks) * body->len);
+  for (int i = 0; i < body->len; ++i)
+    loop->blocks[i] = (intptr_t)body->data[i];
+  qsort(loop->blocks, loop->size, sizeof(*loop->blocks), compare_int);
+  return loop;
+}
+
+// Detect natural loops: back edges are found by a depth first search from the entry,
+// and the body is collected once for each header.
+static Vector *detect_loops(LoopOpt *lopt) {
+  Vector *bbs = lopt->bbcon->bbs;
+  int n = bbs->len;
+
+  // Successors of the block `i` are `succs[starts[i]]`..`succs[starts[i + 1] - 1]`.
+  int *starts = calloc(n + 1, sizeof(*starts));
+  for (int i = 0; i < n; ++i) {
+    BB *bb = bbs->data[i];
+    for (int j = 0; j < bb->from_bbs->len; ++j)
+      ++starts[bb_index(lopt, bb->from_bbs->data[j]) + 1];
+  }
+  for (int i = 0; i < n; ++i)
+    starts[i + 1] += starts[i];
+  int *succs = malloc_or_die(sizeof(*succs) * (starts[n] + 1));
+  int *poss = malloc_or_die(sizeof(*poss) * n);
+  memcpy(poss, starts, sizeof(*poss) * n);
+  for (int i = 0; i < n; ++i) {
+    BB *bb = bbs->data[i];
+    for (int j = 0; j < bb->from_bbs->len; ++j)
+      succs[poss[bb_index(lopt, bb->from_bbs->data[j])]++] = i;
+  }
+
+  enum { UNVISITED, ON_STACK, DONE };
+  char *states = calloc(n, sizeof(*states));
+  int *stack = malloc_or_die(sizeof(*stack) * n);
+  Vector **latches = calloc(n, sizeof(*latches));
+  Vector *headers = new_vector();
+  int sp = 0;
+  stack[sp++] = 0;
+  poss[0] = starts[0];
+  states[0] = ON_STACK;
+  while (sp > 0) {
+    int k = stack[sp - 1];
+    if (poss[k] >= starts[k + 1]) {
+      states[k] = DONE;
+      --sp;
+      continue;
+    }
+    int s = succs[poss[k]++];
+    if (states[s] == UNVISITED) {
+      states[s] = ON_STACK;
+      poss[s] = starts[s];
+      stack[sp++] = s;
+    } else if (states[s] == ON_STACK) {  // Back edge.
+      if (latches[s] == NULL) {
+        latches[s] = new_vector();
+        vec_push(headers, (void*)(intptr_t)s);
+      }
+      vec_push(latches[s], (void*)(intptr_t)k);
+    }
+  }
+
+  Vector *loops = new_vector();
+  int *mark = calloc(n, sizeof(*mark));
+  Vector *work = new_vector();
+  Vector *body = new_vector();
+  for (int i = 0; i < headers->len; ++i) {
+    int h = (intptr_t)headers->data[i];
+    Loop *loop = h != 0 ? collect_loop(lopt, h, latches[h], mark, work, body) : NULL;
+    if (loop != NULL)
+      vec_push(loops, loop);
+  }
+
+  free(mark);
+  free(latches);
+  free(stack);
+  free(states);
+  free(poss);
+  free(succs);
+  free(starts);
+  return loops;
+}
+
+static void count_use(LoopOpt *lopt, VReg *vreg, int delta) {
+  if (vreg != NULL && !(vreg->flag & VRF_CONST))
+    lopt->uses[vreg->virt] += delta;
+}
+
+static void analyze_defs(LoopOpt *lopt) {
+  free(lopt->defs.counts);
+  count_defs(&lopt->defs, lopt->ra, lopt->bbcon);
+  int vreg_count = lopt->defs.vreg_count;
+  free(lopt->def_bbs);
+  free(lopt->def_irs);
+  free(lopt->uses);
+  lopt->def_bbs = calloc(vreg_count + 1, sizeof(*lopt->def_bbs));
+  lopt->def_irs = calloc(vreg_count + 1, sizeof(*lopt->def_irs));
+  lopt->uses = calloc(vreg_count + 1, sizeof(*lopt->uses));
+
+  Vector *bbs = lopt->bbcon->bbs;
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    if (bb->phis != NULL) {
+      for (int j = 0; j < bb->phis->len; ++j) {
+        Phi *phi = bb->phis->data[j];
+        lopt->def_bbs[phi->dst->virt] = i + 1;
+        for (int k = 0; k < phi->params->len; ++k)
+          count_use(lopt, phi->params->data[k], 1);
+      }
+    }
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->dst != NULL) {
+        lopt->def_bbs[ir->dst->virt] = i + 1;
+        lopt->def_irs[ir->dst->virt] = ir;
+      }
+      count_use(lopt, ir->opr1, 1);
+      count_use(lopt, ir->opr2, 1);
+    }
+  }
+}
+
+// Register the definition of a register spawned by the loop optimization,
+// instead of analyzing whole the function again.
+static void add_def(LoopOpt *lopt, VReg *vreg, BB *bb, IR *ir) {
+  int old_count = lopt->defs.vreg_count, vreg_count = lopt->ra->vregs->len;
+  if (vreg_count > old_count) {
+    size_t n = vreg_count + 1, d = vreg_count - old_count;
+    lopt->defs.counts = realloc_or_die(lopt->defs.counts, sizeof(*lopt->defs.counts) * n);
+    lopt->def_bbs = realloc_or_die(lopt->def_bbs, sizeof(*lopt->def_bbs) * n);
+    lopt->def_irs = realloc_or_die(lopt->def_irs, sizeof(*lopt->def_irs) * n);
+    lopt->uses = realloc_or_die(lopt->uses, sizeof(*lopt->uses) * n);
+    memset(&lopt->defs.counts[old_count + 1], 0, sizeof(*lopt->defs.counts) * d);
+    memset(&lopt->def_bbs[old_count + 1], 0, sizeof(*lopt->def_bbs) * d);
+    memset(&lopt->def_irs[old_count + 1], 0, sizeof(*lopt->def_irs) * d);
+    memset(&lopt->uses[old_count + 1], 0, sizeof(*lopt->uses) * d);
+    if (lopt->ivs != NULL) {
+      lopt->ivs = realloc_or_die(lopt->ivs, sizeof(*lopt->ivs) * n);
+      memset(&lopt->ivs[old_count + 1], 0, sizeof(*lopt->ivs) * d);
+    }
+    lopt->defs.vreg_count = vreg_count;
+  }
+  lopt->defs.counts[vreg->virt] = 1;
+  lopt->def_bbs[vreg->virt] = bb_index(lopt, bb) + 1;
+  lopt->def_irs[vreg->virt] = ir;
+}
+
+static bool is_invariant(LoopOpt *lopt, VReg *vreg) {
+  if (vreg->flag & VRF_CONST)
+    return true;
+  if (!is_value_reg(&lopt->defs, vreg))
+    return false;
+  int index = lopt->def_bbs[vreg->virt] - 1;
+  return index < 0 || !lopt->in_loop[index];
+}
+
+static bool is_hoistable(LoopOpt *lopt, IR *ir) {
+  switch (ir->kind) {
+  case IR_BOFS:
+  case IR_IOFS:
+    break;
+  // Division might trap, so it is not executed speculatively.
+  case IR_ADD:  // binops
+  case IR_SUB:
+  case IR_MUL:
+  case IR_BITAND:
+  case IR_BITOR:
+  case IR_BITXOR:
+  case IR_LSHIFT:
+  case IR_RSHIFT:
+    if (!is_invariant(lopt, ir->opr2))
+      return false;
+    // Fallthrough
+  case IR_NEG:  // unary ops
+  case IR_BITNOT:
+  case IR_SQRT:
+  case IR_FABS:
+  case IR_FLOOR:
+  case IR_CEIL:
+  case IR_CAST:
+  case IR_MOV:
+    if (!is_invariant(lopt, ir->opr1))
+      return false;
+    break;
+  default:
+    return false;
+  }
+  return is_value_reg(&lopt->defs, ir->dst);
+}
+
+// Position to insert IRs into the preheader: before the last jump and the comparison.
+static int preheader_pos(BB *bb) {
+  Vector *irs = bb->irs;
+  int pos = irs->len;
+  if (pos > 0 && ((IR*)irs->data[pos - 1])->kind == IR_JMP)
+    --pos;
+  if (pos > 0 && ((IR*)irs->data[pos - 1])->kind == IR_CMP)
+    --pos;
+  return pos;
+}
+
+static void hoist_invariants(LoopOpt *lopt) {
+  Loop *loop = lopt->loop;
+  Vector *bbs = lopt->bbcon->bbs;
+  int pre = bb_index(lopt, loop->preheader);
+  for (bool again = true; again; ) {
+    again = false;
+    for (int i = 0; i < loop->size; ++i) {
+      BB *bb = bbs->data[loop->blocks[i]];
+      for (int j = 0; j < bb->irs->len; ++j) {
+        IR *ir = bb->irs->data[j];
+        if (!is_hoistable(lopt, ir))
+          continue;
+        vec_remove_at(bb->irs, j--);
+        vec_insert(loop->preheader->irs, preheader_pos(loop->preheader), ir);
+        lopt->def_bbs[ir->dst->virt] = pre + 1;
+        again = true;
+      }
+    }
+  }
+}
+
+// Generate a binary operation in the preheader.
+static VReg *gen_in_preheader(LoopOpt *lopt, enum IrKind kind, VReg *opr1, VReg *opr2,
+                              const VRegType *vtype) {
+  BB *preheader = lopt->loop->preheader;
+  BB *tmp = new_bb();
+  BB *saved = curbb;
+  curbb = tmp;
+  VReg *result;
+  if (kind == IR_CAST) {
+    if (opr1->flag & VRF_CONST)
+      result = new_const_vreg(wrap_value(opr1->fixnum, vtype->size,
+                                         (vtype->flag & VRTF_UNSIGNED) != 0), vtype);
+    else
+      result = new_ir_cast(opr1, vtype);
+  } else {
+    if ((opr1->flag & VRF_CONST) && !(opr2->flag & VRF_CONST) && is_commutative(kind)) {
+      VReg *t = opr1;
+      opr1 = opr2;
+      opr2 = t;
+    }
+    result = new_ir_bop(kind, opr1, opr2, vtype);
+  }
+  curbb = saved;
+
+  int pos = preheader_pos(preheader);
+  for (int i = 0; i < tmp->irs->len; ++i) {
+    IR *ir = tmp->irs->data[i];
+    vec_insert(preheader->irs, pos++, ir);
+    if (ir->dst != NULL)
+      add_def(lopt, ir->dst, preheader, ir);
+    count_use(lopt, ir->opr1, 1);
+    count_use(lopt, ir->opr2, 1);
+  }
+  return result;
+}
+
+static void detect_basic_ivs(LoopOpt *lopt) {
+  Loop *loop = lopt->loop;
+  BB *header = loop->header;
+  if (header->phis == NULL)
+    return;
+  for (int i = 0; i < header->phis->len; ++i) {
+    Phi *phi = header->phis->data[i];
+    if (!is_value_reg(&lopt->defs, phi->dst) || (phi->dst->vtype->flag & VRTF_NON_REG))
+      continue;
+#ifndef __NO_FLONUM
+    if (phi->dst->vtype->flag & VRTF_FLONUM)
+      continue;
+#endif
+    VReg *init = NULL, *next = NULL;
+    bool ok = true;
+    for (int j = 0; j < header->from_bbs->len; ++j) {
+      VReg *param = phi->params->data[j];
+      VReg **p = header->from_bbs->data[j] == loop->preheader ? &init : &next;
+      if (*p != NULL && *p != param)
+        ok = false;
+      *p = param;
+    }
+    if (!ok || init == NULL || next == NULL || !is_value_reg(&lopt->defs, next))
+      continue;
+
+    IR *update = lopt->def_irs[next->virt];
+    if (update == NULL || (update->kind != IR_ADD && update->kind != IR_SUB) ||
+        update->opr1 != phi->dst || !(update->opr2->flag & VRF_CONST))
+      continue;
+    int index = lopt->def_bbs[next->virt] - 1;
+    if (index < 0 || !lopt->in_loop[index])
+      continue;
+
+    IndVar *iv = calloc(1, sizeof(*iv));
+    iv->init = init;
+    iv->step = update->kind == IR_ADD ? update->opr2->fixnum : -update->opr2->fixnum;
+    iv->cur = phi->dst;
+    iv->next = next;
+    iv->update = update;
+    iv->update_bb = lopt->bbcon->bbs->data[index];
+    lopt->ivs[phi->dst->virt] = iv;
+    vec_push(lopt->iv_list, iv);
+  }
+}
+
+static IndVar *get_iv(LoopOpt *lopt, VReg *vreg) {
+  return is_value_reg(&lopt->defs, vreg) ? lopt->ivs[vreg->virt] : NULL;
+}
+
+// Find induction variable for `vreg`, looking through a cast which keeps the linearity.
+static IndVar *find_iv(LoopOpt *lopt, VReg *vreg, VReg **pcasted) {
+  *pcasted = NULL;
+  IndVar *iv = get_iv(lopt, vreg);
+  if (iv != NULL || !is_value_reg(&lopt->defs, vreg))
+    return iv;
+
+  IR *ir = lopt->def_irs[vreg->virt];
+  if (ir == NULL || ir->kind != IR_CAST || (iv = get_iv(lopt, ir->opr1)) == NULL)
+    return NULL;
+  const VRegType *src = ir->opr1->vtype, *dst = vreg->vtype;
+#ifndef __NO_FLONUM
+  if ((src->flag | dst->flag) & VRTF_FLONUM)
+    return NULL;
+#endif
+  // Widening an unsigned value might be broken by wrap around.
+  if (dst->size > src->size && (src->flag & VRTF_UNSIGNED))
+    return NULL;
+  *pcasted = vreg;
+  return iv;
+}
+
+static IndVar *find_same_iv(LoopOpt *lopt, IndVar *iv, enum IrKind kind, VReg *other,
+                            VReg *casted, const VRegType *vtype) {
+  for (int i = 0; i < lopt->iv_list->len; ++i) {
+    IndVar *div = lopt->iv_list->data[i];
+    if (div->base != iv || div->kind != kind || !same_vtype(div->cur->vtype, vtype))
+      continue;
+    if (div->other != other &&
+        !((div->other->flag & other->flag & VRF_CONST) && div->other->fixnum == other->fixnum))
+      continue;
+    if (casted == NULL ? div->cast_vtype != NULL
+                       : div->cast_vtype == NULL || !same_vtype(div->cast_vtype, casted->vtype))
+      continue;
+    return div;
+  }
+  return NULL;
+}
+
+static void replace_with_iv(LoopOpt *lopt, IR *ir, IndVar *div) {
+  lopt->ivs[ir->dst->virt] = div;
+  count_use(lopt, ir->opr1, -1);
+  count_use(lopt, ir->opr2, -1);
+  count_use(lopt, div->cur, 1);
+  ir->kind = IR_MOV;
+  ir->opr1 = div->cur;
+  ir->opr2 = NULL;
+}
+
+// Replace multiplication of an induction variable with an addition in each iteration:
+//   `d = i * c` => `d' = phi(init * c, d' + step * c)`
+// Addition of an invariant to a derived induction variable is also reduced,
+// so an address calculation for array indexing turns into a pointer increment.
+static bool reduce_strength(LoopOpt *lopt, IR *ir) {
+  if (!is_value_reg(&lopt->defs, ir->dst))
+    return false;
+  const VRegType *vtype = ir->dst->vtype;
+#ifndef __NO_FLONUM
+  if (vtype->flag & VRTF_FLONUM)
+    return false;
+#endif
+
+  VReg *opr = NULL, *other = NULL, *casted = NULL;
+  IndVar *iv = NULL;
+  switch (ir->kind) {
+  case IR_MUL:
+  case IR_LSHIFT:
+    if ((iv = find_iv(lopt, ir->opr1, &casted)) != NULL && (ir->opr2->flag & VRF_CONST)) {
+      opr = ir->opr1;
+      other = ir->opr2;
+    } else if (ir->kind == IR_MUL && (ir->opr1->flag & VRF_CONST) &&
+               (iv = find_iv(lopt, ir->opr2, &casted)) != NULL) {
+      opr = ir->opr2;
+      other = ir->opr1;
+    }
+    if (ir->kind == IR_LSHIFT && other != NULL &&
+        (other->fixnum < 0 || other->fixnum >= vtype->size * 8))
+      return false;
+    break;
+  case IR_ADD:
+  case IR_SUB:
+    if ((iv = get_iv(lopt, ir->opr1)) != NULL && is_invariant(lopt, ir->opr2)) {
+      opr = ir->opr1;
+      other = ir->opr2;
+    } else if (ir->kind == IR_ADD && is_invariant(lopt, ir->opr1) &&
+               (iv = get_iv(lopt, ir->opr2)) != NULL) {
+      opr = ir->opr2;
+      other = ir->opr1;
+    }
+    // Basic induction variable itself is not worth to reduce.
+    if (iv != NULL && iv->base == NULL)
+      return false;
+    break;
+  default:
+    return false;
+  }
+  if (iv == NULL || opr == NULL || !same_vtype(opr->vtype, vtype))
+    return false;
+
+  bool is_unsigned = (vtype->flag & VRTF_UNSIGNED) != 0;
+  int64_t step = wrap_value(iv->step, vtype->size, is_unsigned);
+  switch (ir->kind) {
+  case IR_MUL:     step = (uint64_t)step * (uint64_t)other->fixnum; break;
+  case IR_LSHIFT:  step = (uint64_t)step << other->fixnum; break;
+  default: break;
+  }
+  step = wrap_value(step, vtype->size, is_unsigned);
+  if (step == 0 || !is_im32(step))
+    return false;
+
+  // Same expression appears repeatedly, e.g. `a[i]` is read several times in the body.
+  IndVar *same = find_same_iv(lopt, iv, ir->kind, other, casted, vtype);
+  if (same != NULL) {
+    replace_with_iv(lopt, ir, same);
+    return true;
+  }
+
+  // Operation is commutative if the induction variable is the second operand.
+  VReg *init = iv->init;
+  if (casted != NULL)
+    init = gen_in_preheader(lopt, IR_CAST, init, NULL, casted->vtype);
+  init = gen_in_preheader(lopt, ir->kind, init, other, vtype);
+
+  // Put the phi into the header, and update it after the basic induction variable.
+  Loop *loop = lopt->loop;
+  BB *header = loop->header;
+  VReg *cur = reg_alloc_spawn(lopt->ra, vtype, 0);
+  VReg *next = reg_alloc_spawn(lopt->ra, vtype, 0);
+  add_def(lopt, cur, header, NULL);
+  Phi *phi = malloc_or_die(sizeof(*phi));
+  phi->dst = cur;
+  phi->params = new_vector();
+  for (int i = 0; i < header->from_bbs->len; ++i) {
+    VReg *param = header->from_bbs->data[i] == loop->preheader ? init : next;
+    vec_push(phi->params, param);
+    count_use(lopt, param, 1);
+  }
+  vec_push(header->phis, phi);
+
+  IR *update = new_ir_mov(next, cur);
+  update->kind = IR_ADD;
+  update->opr2 = new_const_vreg(step, vtype);
+  Vector *irs = iv->update_bb->irs;
+  for (int i = 0; i < irs->len; ++i) {
+    if (irs->data[i] == iv->update) {
+      vec_insert(irs, i + 1, update);
+      break;
+    }
+  }
+  add_def(lopt, next, iv->update_bb, update);
+  count_use(lopt, cur, 1);
+
+  IndVar *div = malloc_or_die(sizeof(*div));
+  div->kind = ir->kind;
+  div->init = init;
+  div->step = step;
+  div->cur = cur;
+  div->next = next;
+  div->update = iv->update;
+  div->update_bb = iv->update_bb;
+  div->base = iv;
+  div->other = other;
+  div->cast_vtype = casted != NULL ? casted->vtype : NULL;
+  vec_push(lopt->iv_list, div);
+
+  replace_with_iv(lopt, ir, div);
+  return true;
+}
+
+// Find a derived induction variable which is increasing function of `iv`,
+// and whose value for any `int` is computed without overflow.
+// The last one is preferred, because it might be derived from the others.
+static IndVar *find_exit_test_iv(LoopOpt *lopt, IndVar *iv) {
+  if (iv->step == 0 || (iv->cur->vtype->flag & VRTF_UNSIGNED))
+    return NULL;
+  for (int i = lopt->iv_list->len; --i >= 0; ) {
+    IndVar *div = lopt->iv_list->data[i];
+    if (div->base == NULL || (div->step > 0) != (iv->step > 0))
+      continue;
+    IndVar *p = div;
+    while (p->base != iv && p->base != NULL)
+      p = p->base;
+    // Widen first, and then the multiplication by 32 bit step does not overflow.
+    if (p->base == iv && p->cast_vtype != NULL && iv->cur->vtype->size <= 4 &&
+        p->cast_vtype->size > iv->cur->vtype->size)
+      return div;
+  }
+  return NULL;
+}
+
+static VReg *gen_derived_value(LoopOpt *lopt, IndVar *div, VReg *vreg) {
+  if (div->base == NULL)
+    return vreg;
+  vreg = gen_derived_value(lopt, div->base, vreg);
+  if (div->cast_vtype != NULL)
+    vreg = gen_in_preheader(lopt, IR_CAST, vreg, NULL, div->cast_vtype);
+  return gen_in_preheader(lopt, div->kind, vreg, div->other, div->cur->vtype);
+}
+
+// Replace the exit test of the basic induction variable with a derived one:
+//   `i < n` => `f(i) < f(n)`
+// so the basic one is eliminated as a dead code if it is used only for the test.
+// The comparison is kept signed, assuming that the derived values (typically addresses)
+// do not cross the sign boundary of 64 bit.
+static void replace_exit_test(LoopOpt *lopt, IndVar *iv) {
+  IndVar *div = find_exit_test_iv(lopt, iv);
+  if (div == NULL)
+    return;
+
+  Loop *loop = lopt->loop;
+  Vector *bbs = lopt->bbcon->bbs;
+  IR *cmp = NULL;
+  for (int i = 0; i < loop->size && cmp == NULL; ++i) {
+    BB *bb = bbs->data[loop->blocks[i]];
+    Vector *irs = bb->irs;
+    if (irs->len < 2)
+      continue;
+    IR *jmp = irs->data[irs->len - 1], *ir = irs->data[irs->len - 2];
+    if (jmp->kind != IR_JMP || jmp->jmp.cond == COND_ANY || ir->kind != IR_CMP)
+      continue;
+    for (int j = 0; j < 2; ++j) {
+      VReg *opr = j == 0 ? ir->opr1 : ir->opr2, *other = j == 0 ? ir->opr2 : ir->opr1;
+      if ((opr == iv->cur || opr == iv->next) && is_invariant(lopt, other)) {
+        cmp = ir;
+        break;
+      }
+    }
+  }
+  if (cmp == NULL)
+    return;
+
+  // Used only by the phi, the update and the test.
+  int expected = 2;
+  Phi *phi = NULL;
+  for (int i = 0; i < loop->header->phis->len; ++i) {
+    Phi *p = loop->header->phis->data[i];
+    if (p->dst == iv->cur)
+      phi = p;
+  }
+  for (int i = 0; i < phi->params->len; ++i)
+    expected += phi->params->data[i] == iv->next;
+  // Unused computation in the loop (like a cast left by the strength reduction)
+  // is eliminated later.
+  int uses = lopt->uses[iv->cur->virt] + lopt->uses[iv->next->virt];
+  for (int i = 0; i < loop->size; ++i) {
+    BB *bb = bbs->data[loop->blocks[i]];
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (is_pure_ir(ir->kind) && is_value_reg(&lopt->defs, ir->dst) &&
+          lopt->uses[ir->dst->virt] == 0)
+        uses -= (ir->opr1 == iv->cur || ir->opr1 == iv->next) +
+                (ir->opr2 == iv->cur || ir->opr2 == iv->next);
+    }
+  }
+  if (uses != expected)
+    return;
+
+  VReg **popr = cmp->opr1 == iv->cur || cmp->opr1 == iv->next ? &cmp->opr1 : &cmp->opr2;
+  VReg **plimit = popr == &cmp->opr1 ? &cmp->opr2 : &cmp->opr1;
+  VReg *opr = *popr == iv->cur ? div->cur : div->next;
+  VReg *limit = gen_derived_value(lopt, div, *plimit);
+  count_use(lopt, *popr, -1);
+  count_use(lopt, *plimit, -1);
+  count_use(lopt, opr, 1);
+  count_use(lopt, limit, 1);
+  *popr = opr;
+  *plimit = limit;
+}
+
+static void reduce_loop_strength(LoopOpt *lopt) {
+  Loop *loop = lopt->loop;
+  lopt->ivs = calloc(lopt->defs.vreg_count + 1, sizeof(*lopt->ivs));
+  lopt->iv_list = new_vector();
+  detect_basic_ivs(lopt);
+  int basic_count = lopt->iv_list->len;
+
+  Vector *bbs = lopt->bbcon->bbs;
+  for (int i = 0; i < loop->size; ++i) {
+    BB *bb = bbs->data[loop->blocks[i]];
+    for (int j = 0; j < bb->irs->len; ++j)
+      reduce_strength(lopt, bb->irs->data[j]);
+  }
+  if (lopt->iv_list->len > basic_count) {
+    for (int i = 0; i < basic_count; ++i)
+      replace_exit_test(lopt, lopt->iv_list->data[i]);
+  }
+
+  for (int i = 0; i < lopt->iv_list->len; ++i)
+    free(lopt->iv_list->data[i]);
+  free(lopt->ivs);
+  lopt->ivs = NULL;
+  lopt->iv_list = NULL;
+}
+
+static int compare_loop_size(const void *pa, const void *pb) {
+  const Loop *a = *(Loop**)pa, *b = *(Loop**)pb;
+  return a->size - b->size;
+}
+
+static void optimize_loops(RegAlloc *ra, BBContainer *bbcon) {
+  LoopOpt lopt;
+  lopt.ra = ra;
+  lopt.bbcon = bbcon;
+  lopt.defs.counts = NULL;
+  lopt.def_bbs = NULL;
+  lopt.def_irs = NULL;
+  lopt.uses = NULL;
+  lopt.ivs = NULL;
+  lopt.iv_list = NULL;
+
+  Vector *bbs = bbcon->bbs;
+  table_init(&lopt.bbtbl);
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    table_put(&lopt.bbtbl, bb->label, (void*)(intptr_t)(i + 1));
+  }
+
+  Vector *loops = detect_loops(&lopt);
+  // Inner loop first.
+  qsort(loops->data, loops->len, sizeof(*loops->data), compare_loop_size);
+
+  // Definitions are kept up to date while optimizing loops.
+  analyze_defs(&lopt);
+  lopt.in_loop = calloc(bbs->len, sizeof(*lopt.in_loop));
+  for (int i = 0; i < loops->len; ++i) {
+    Loop *loop = loops->data[i];
+    lopt.loop = loop;
+    for (int j = 0; j < loop->size; ++j)
+      lopt.in_loop[loop->blocks[j]] = true;
+    hoist_invariants(&lopt);
+    if (loop->header->phis != NULL)
+      reduce_loop_strength(&lopt);
+    for (int j = 0; j < loop->size; ++j)
+      lopt.in_loop[loop->blocks[j]] = false;
+    free(loop->blocks);
+    free(loop);
+  }
+
+  free(lopt.in_loop);
+  free(lopt.defs.counts);
+  free(lopt.def_bbs);
+  free(lopt.def_irs);
+  free(lopt.uses);
+}
+
+// Dead code elimination
+
+static bool is_flag_user(IR *ir) {
+  return ir->kind == IR_COND || (ir->kind == IR_JMP && ir->jmp.cond != COND_ANY);
+}
+
+// Whether the flag set by the comparison at `index` is referred.
+static bool is_cmp_used(BB *bb, int index) {
+  for (int i = index + 1; i < bb->irs->len; ++i) {
+    IR *ir = bb->irs->data[i];
+    if (is_flag_user(ir))
+      return true;
+    if (ir->kind == IR_CMP)
+      return false;
+  }
+  IR *last = bb->irs->data[bb->irs->len - 1];
+  if ((last->kind == IR_JMP && last->jmp.cond == COND_ANY) || last->kind == IR_TJMP ||
+      bb->next == NULL)
+    return false;
+
+  // Flag might be used at the top of the next block.
+  BB *next = bb->next;
+  for (int i = 0; i < next->irs->len; ++i) {
+    IR *ir = next->irs->data[i];
+    if (ir->kind != IR_MOV)
+      return is_flag_user(ir);
+  }
+  return false;
+}
+
+static void mark_live(bool *lives, const DefInfo *defs, Vector *work, VReg *vreg) {
+  if (vreg == NULL || (vreg->flag & VRF_CONST) || vreg->virt >= defs->vreg_count ||
+      lives[vreg->virt])
+    return;
+  lives[vreg->virt] = true;
+  vec_push(work, vreg);
+}
+
+static void eliminate_dead_code(RegAlloc *ra, BBContainer *bbcon) {
+  DefInfo defs;
+  count_defs(&defs, ra, bbcon);
+  int vreg_count = defs.vreg_count;
+  IR **def_irs = calloc(vreg_count + 1, sizeof(*def_irs));
+  Phi **def_phis = calloc(vreg_count + 1, sizeof(*def_phis));
+  bool *lives = calloc(vreg_count + 1, sizeof(*lives));
+  Vector *work = new_vector();
+
+  Vector *bbs = bbcon->bbs;
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    if (bb->phis != NULL) {
+      for (int j = 0; j < bb->phis->len; ++j) {
+        Phi *phi = bb->phis->data[j];
+        def_phis[phi->dst->virt] = phi;
+      }
+    }
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->dst != NULL && is_pure_ir(ir->kind) && is_value_reg(&defs, ir->dst)) {
+        def_irs[ir->dst->virt] = ir;
+      } else if (ir->kind == IR_CMP && !is_cmp_used(bb, j)) {
+        vec_remove_at(bb->irs, j--);
+      } else {
+        mark_live(lives, &defs, work, ir->opr1);
+        mark_live(lives, &defs, work, ir->opr2);
+      }
+    }
+  }
+
+  while (work->len > 0) {
+    VReg *vreg = vec_pop(work);
+    IR *ir = def_irs[vreg->virt];
+    if (ir != NULL) {
+      mark_live(lives, &defs, work, ir->opr1);
+      mark_live(lives, &defs, work, ir->opr2);
+    }
+    Phi *phi = def_phis[vreg->virt];
+    if (phi != NULL) {
+      for (int k = 0; k < phi->params->len; ++k)
+        mark_live(lives, &defs, work, phi->params->data[k]);
+    }
+  }
+
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    if (bb->phis != NULL) {
+      for (int j = 0; j < bb->phis->len; ++j) {
+        Phi *phi = bb->phis->data[j];
+        if (!lives[phi->dst->virt])
+          vec_remove_at(bb->phis, j--);
+      }
+    }
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->dst != NULL && def_irs[ir->dst->virt] == ir && !lives[ir->dst->virt])
+        vec_remove_at(bb->irs, j--);
+    }
+  }
+
+  free(def_irs);
+  free(def_phis);
+  free(lives);
+  free(defs.counts);
+}
+
+//
+
+void optimize(RegAlloc *ra, BBContainer *bbcon) {
+  make_ssa(ra, bbcon);
+  propagate_constants(ra, bbcon);
+  propagate_copies(ra, bbcon);
+  optimize_loops(ra, bbcon);
+  propagate_constants(ra, bbcon);
+  propagate_copies(ra, bbcon);
+  eliminate_dead_code(ra, bbcon);
+  resolve_phis(ra, bbcon);
+  remove_unnecessary_bb(bbcon);
+}
@@ -0,0 +1,11 @@
+// Optimization
+
+#pragma once
+
+typedef struct BBContainer BBContainer;
+typedef struct RegAlloc RegAlloc;
+
+// Optimize IR codes in a function on SSA form:
+//   sparse conditional constant propagation, copy propagation,
+//   loop-invariant code motion, strength reduction and dead code elimination.
+void optimize(RegAlloc *ra, BBContainer *bbcon);
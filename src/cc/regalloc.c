@@ -3,12 +3,15 @@
 
 #include <assert.h>
 #include <limits.h>  // CHAR_BIT
+#include <stdint.h>  // intptr_t
 #include <stdlib.h>  // malloc
 #include <string.h>
 
 #include "ast.h"
 #include "codegen.h"  // WORD_SIZE
 #include "ir.h"
+#include "ssa.h"  // split_edge
+#include "table.h"
 #include "type.h"
 #include "util.h"
 #include "var.h"
@@ -62,17 +65,48 @@ static int sort_live_interval(const void *pa, const void *pb) {
   int d = a->start - b->start;
   if (d == 0)
     d = b->end - a->end;
+  if (d == 0)  // Keep the order stable regardless of qsort implementation.
+    d = a->virt - b->virt;
   return d;
 }
 
+static bool can_spill(RegAlloc *ra, LiveInterval *li) {
+  VReg *vreg = ra->vregs->data[li->virt];
+  return !(vreg->flag & VRF_NO_SPILL);
+}
+
+// Whether `a` is cheaper to spill than `b`:
+// compare the densities of the references, and prefer the one which ends later.
+// Both of the references and the length are weighted by loop depth,
+// so a value used in a loop is not chosen before the ones only living through it,
+// even if it lives long outside of the loop.
+static bool is_cheaper_spill(LiveInterval *a, LiveInterval *b) {
+  int64_t ca = a->spill_cost * b->weighted_length;
+  int64_t cb = b->spill_cost * a->weighted_length;
+  if (ca != cb)
+    return ca < cb;
+  return a->end > b->end;
+}
+
 static void split_at_interval(RegAlloc *ra, LiveInterval **active, int active_count,
                               LiveInterval *li) {
   assert(active_count > 0);
-  LiveInterval *spill = active[active_count - 1];
-  if (spill->end > li->end) {
+  LiveInterval *spill = can_spill(ra, li) ? li : NULL;
+  int index = -1;
+  for (int i = 0; i < active_count; ++i) {
+    LiveInterval *p = active[i];
+    if (can_spill(ra, p) && (spill == NULL || is_cheaper_spill(p, spill))) {
+      spill = p;
+      index = i;
+    }
+  }
+  assert(spill != NULL);
+
+  if (spill != li) {
     li->phys = spill->phys;
     spill->phys = ra->phys_max;
     spill->state = LI_SPILL;
+    remove_active(active, active_count, index, 1);
     insert_active(active, active_count - 1, li);
   } else {
     li->phys = ra->phys_max;
@@ -108,23 +142,82 @@ static void set_inout_interval(Vector *regs, LiveInterval *intervals, int nip) {
   }
 }
 
-static void check_live_interval(BBContainer *bbcon, int vreg_count, LiveInterval *intervals) {
+static void map_bb_indices(Vector *bbs, Table *indices) {
+  table_init(indices);
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    table_put(indices, bb->label, (void*)(intptr_t)(i + 1));
+  }
+}
+
+static int bb_index(Table *indices, BB *bb) {
+  return (intptr_t)table_get(indices, bb->label) - 1;
+}
+
+// Calculate loop depth for each basic block:
+// a jump to the preceding block (or itself) is regarded as a back edge,
+// and blocks between them are regarded as a loop body.
+static int *calc_loop_depths(BBContainer *bbcon) {
+  Vector *bbs = bbcon->bbs;
+  int *depths = malloc_or_die((bbs->len + 1) * sizeof(*depths));
+  memset(depths, 0, (bbs->len + 1) * sizeof(*depths));
+
+  Table indices;
+  map_bb_indices(bbs, &indices);
+
+  // Count differences at the head and the tail of the loops, and then accumulate them.
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    for (int j = 0; j < bb->from_bbs->len; ++j) {
+      int k = bb_index(&indices, bb->from_bbs->data[j]);
+      if (k >= i) {
+        ++depths[i];
+        --depths[k + 1];
+      }
+    }
+  }
+  for (int i = 1; i < bbs->len; ++i)
+    depths[i] += depths[i - 1];
+  return depths;
+}
+
+static void check_live_interval(BBContainer *bbcon, const int *loop_depths, Vector *vregs,
+                                LiveInterval *intervals) {
+  // Weight for references: 8^depth
+  static const int kMaxWeightDepth = 5;
+  static const int kWeightShift = 3;
+  int vreg_count = vregs->len;
+
   for (int i = 0; i < vreg_count; ++i) {
     LiveInterval *li = &intervals[i];
     li->virt = i;
     li->phys = -1;
     li->start = li->end = -1;
     li->state = LI_NORMAL;
+    li->spill_cost = 0;
+    li->weighted_length = 0;
   }
 
+  int ir_count = 0;
+  for (int i = 0; i < bbcon->bbs->len; ++i) {
+    BB *bb = bbcon->bbs->data[i];
+    ir_count += bb->irs->len;
+  }
+  // Sum of the weights before each position (and the ones after the last IR).
+  int64_t *weight_sums = malloc_or_die(sizeof(*weight_sums) * (ir_count + 3));
+  weight_sums[0] = 0;
+
   int nip = 0;
   for (int i = 0; i < bbcon->bbs->len; ++i) {
     BB *bb = bbcon->bbs->data[i];
+    int depth = loop_depths[i];
+    int weight = 1 << ((depth < kMaxWeightDepth ? depth : kMaxWeightDepth) * kWeightShift);
 
     set_inout_interval(bb->in_regs, intervals, nip);
 
     for (int j = 0; j < bb->irs->len; ++j, ++nip) {
       IR *ir = bb->irs->data[j];
+      weight_sums[nip + 1] = weight_sums[nip] + weight;
       VReg *regs[] = {ir->dst, ir->opr1, ir->opr2};
       for (int k = 0; k < 3; ++k) {
         VReg *reg = regs[k];
@@ -135,11 +228,29 @@ static void check_live_interval(BBContainer *bbcon, int vreg_count, LiveInterval
           li->start = nip;
         if (li->end < nip)
           li->end = nip;
+        li->spill_cost += weight;
       }
     }
 
     set_inout_interval(bb->out_regs, intervals, nip);
   }
+  weight_sums[nip + 1] = weight_sums[nip] + 1;
+  weight_sums[nip + 2] = weight_sums[nip + 1] + 1;
+
+  for (int i = 0; i < vreg_count; ++i) {
+    LiveInterval *li = &intervals[i];
+    // Function parameter is live from the entry of the function,
+    // and all of them are assigned there at once (even if unused),
+    // so make them overlap each other.
+    if (((VReg*)vregs->data[i])->param_index >= 0) {
+      li->start = 0;
+      if (li->end < 1)
+        li->end = 1;
+    }
+    if (li->start >= 0)
+      li->weighted_length = weight_sums[li->end + 1] - weight_sums[li->start];
+  }
+  free(weight_sums);
 }
 
 static void linear_scan_register_allocation(RegAlloc *ra, LiveInterval **sorted_intervals,
@@ -254,6 +365,10 @@ static int insert_load_store_spilled_irs(RegAlloc *ra, BBContainer *bbcon) {
       case IR_CMP:
       case IR_NEG:  // unary ops
       case IR_BITNOT:
+      case IR_SQRT:
+      case IR_FABS:
+      case IR_FLOOR:
+      case IR_CEIL:
       case IR_COND:
       case IR_JMP:
       case IR_TJMP:
@@ -304,6 +419,462 @@ static int insert_load_store_spilled_irs(RegAlloc *ra, BBContainer *bbcon) {
   return inserted;
 }
 
+static bool is_same_reg(RegAlloc *ra, VReg *a, VReg *b) {
+  LiveInterval *la = &ra->intervals[a->virt], *lb = &ra->intervals[b->virt];
+  if (la->phys != lb->phys)
+    return false;
+#ifndef __NO_FLONUM
+  if ((a->vtype->flag ^ b->vtype->flag) & VRTF_FLONUM)
+    return false;
+#endif
+  return true;
+}
+
+// Spilled vregs are loaded into temporary registers on every use.
+// Within a basic block, reuse the register which already holds the value
+// (loaded or stored before) as long as it is not overwritten,
+// instead of loading it from the stack frame again.
+static void reuse_spilled_values(RegAlloc *ra, BBContainer *bbcon) {
+  Vector *spilleds = new_vector();  // <VReg*>
+  Vector *holders = new_vector();  // <VReg*>, holds the value of corresponding spilled vreg.
+  for (int i = 0; i < bbcon->bbs->len; ++i) {
+    BB *bb = bbcon->bbs->data[i];
+    vec_clear(spilleds);
+    vec_clear(holders);
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      VReg *spilled = NULL, *holder = NULL;
+      switch (ir->kind) {
+      case IR_PRECALL:
+      case IR_CALL:
+      case IR_ASM:
+        // Registers might be destroyed.
+        vec_clear(spilleds);
+        vec_clear(holders);
+        continue;
+      case IR_LOAD_SPILLED:
+        spilled = ir->opr1;
+        holder = ir->dst;
+        if (!(spilled->flag & VRF_REF)) {
+          for (int k = 0; k < spilleds->len; ++k) {
+            if (spilleds->data[k] == spilled) {
+              // Replace with register move (or nothing, if the register is same),
+              // to keep the positions for the live intervals.
+              ir->kind = IR_MOV;
+              ir->opr1 = holders->data[k];
+              break;
+            }
+          }
+        }
+        break;
+      case IR_STORE_SPILLED:
+        spilled = ir->opr2;
+        holder = ir->opr1;
+        break;
+      default:
+        break;
+      }
+
+      if (ir->dst != NULL) {
+        // The value in the register is overwritten.
+        for (int k = holders->len; --k >= 0; ) {
+          if (is_same_reg(ra, holders->data[k], ir->dst)) {
+            vec_remove_at(spilleds, k);
+            vec_remove_at(holders, k);
+          }
+        }
+      }
+
+      if (spilled != NULL && !(spilled->flag & VRF_REF)) {
+        int k;
+        for (k = 0; k < spilleds->len; ++k) {
+          if (spilleds->data[k] == spilled)
+            break;
+        }
+        if (k < spilleds->len) {
+          holders->data[k] = holder;
+        } else {
+          vec_push(spilleds, spilled);
+          vec_push(holders, holder);
+        }
+      }
+    }
+  }
+}
+
+// Live range splitting at loops:
+//   Spilled vreg which is used in a loop is replaced with a new vreg in the loop,
+//   which is loaded at the entry and stored at the exits of the loop,
+//   so it can stay in a register in the loop and is spilled only outside of it.
+//   This is done only if a register is left free all through the loop by vregs used in it,
+//   otherwise the new vreg would just push another one out.
+//   Registers are allocated again after splitting, and if the new vreg is spilled after all,
+//   the original vreg is put back.
+
+// Blocks from `head` to `tail` which are entered only through `entry`.
+typedef struct {
+  int head;
+  int tail;
+  int entry;
+} LoopRange;
+
+// IRs to be put on the edge `from` -> `to`.
+typedef struct {
+  BB *from;
+  BB *to;
+  Vector *irs;  // <IR*>
+} EdgeCode;
+
+static Vector *detect_loop_ranges(Vector *bbs, Table *indices) {
+  Vector *ranges = new_vector();
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    int tail = -1;
+    for (int j = 0; j < bb->from_bbs->len; ++j) {
+      int k = bb_index(indices, bb->from_bbs->data[j]);
+      if (k >= i && k > tail)
+        tail = k;
+    }
+    if (tail < 0)
+      continue;
+
+    // Loop might be entered at the condition placed at the bottom.
+    int entry = -1;
+    for (int j = i; j <= tail && entry != -2; ++j) {
+      BB *body = bbs->data[j];
+      for (int l = 0; l < body->from_bbs->len; ++l) {
+        int k = bb_index(indices, body->from_bbs->data[l]);
+        if (k < i || k > tail) {
+          entry = entry < 0 || entry == j ? j : -2;
+          break;
+        }
+      }
+    }
+    if (entry < 0)
+      continue;
+
+    LoopRange *range = malloc_or_die(sizeof(*range));
+    range->head = i;
+    range->tail = tail;
+    range->entry = entry;
+    vec_push(ranges, range);
+  }
+  return ranges;
+}
+
+static void add_edge_code(Vector *edges, BB *from, BB *to, IR *ir) {
+  EdgeCode *edge = NULL;
+  for (int i = 0; i < edges->len; ++i) {
+    EdgeCode *p = edges->data[i];
+    if (p->from == from && p->to == to) {
+      edge = p;
+      break;
+    }
+  }
+  if (edge == NULL) {
+    edge = malloc_or_die(sizeof(*edge));
+    edge->from = from;
+    edge->to = to;
+    edge->irs = new_vector();
+    vec_push(edges, edge);
+  }
+  vec_push(edge->irs, ir);
+}
+
+static void put_edge_code(BBContainer *bbcon, EdgeCode *edge) {
+  BB *bb = need_split_edge(edge->from) ? split_edge(bbcon, edge->from, edge->to) : edge->from;
+  Vector *irs = bb->irs;
+  int pos = irs->len;
+  if (pos > 0) {
+    IR *ir = irs->data[pos - 1];
+    if (ir->kind == IR_JMP) {
+      assert(ir->jmp.cond == COND_ANY);
+      --pos;
+    }
+  }
+  for (int i = 0; i < edge->irs->len; ++i)
+    vec_insert(irs, pos++, edge->irs->data[i]);
+}
+
+static void split_in_range(RegAlloc *ra, Vector *bbs, Table *indices, LoopRange *range,
+                           VReg *vreg, Vector *edges, Vector *origins) {
+  VReg *split = reg_alloc_spawn(ra, vreg->vtype, 0);
+  while (origins->len < split->virt)
+    vec_push(origins, NULL);
+  vec_push(origins, vreg);
+  bool assigned = false;
+  for (int i = range->head; i <= range->tail; ++i) {
+    BB *bb = bbs->data[i];
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->opr1 == vreg)
+        ir->opr1 = split;
+      if (ir->opr2 == vreg)
+        ir->opr2 = split;
+      if (ir->dst == vreg) {
+        ir->dst = split;
+        assigned = true;
+      }
+    }
+  }
+
+  BB *entry = bbs->data[range->entry];
+  if (vec_contains(entry->in_regs, vreg)) {
+    for (int i = 0; i < entry->from_bbs->len; ++i) {
+      BB *from = entry->from_bbs->data[i];
+      int k = bb_index(indices, from);
+      if (k < range->head || k > range->tail)
+        add_edge_code(edges, from, entry, new_ir_mov(split, vreg));
+    }
+  }
+
+  // Value in the stack frame is not changed if the loop does not assign it.
+  if (!assigned)
+    return;
+  Vector *succs = new_vector();
+  for (int i = range->head; i <= range->tail; ++i) {
+    BB *bb = bbs->data[i];
+    vec_clear(succs);
+    collect_succs(bb, succs);
+    for (int j = 0; j < succs->len; ++j) {
+      BB *to = succs->data[j];
+      int k = bb_index(indices, to);
+      if ((k < range->head || k > range->tail) && vec_contains(to->in_regs, vreg))
+        add_edge_code(edges, bb, to, new_ir_mov(vreg, split));
+    }
+  }
+}
+
+static bool is_flonum_vreg(VReg *vreg) {
+#ifndef __NO_FLONUM
+  return (vreg->vtype->flag & VRTF_FLONUM) != 0;
+#else
+  UNUSED(vreg);
+  return false;
+#endif
+}
+
+// Count registers at each position in the range, for integer and flonum.
+// Only vregs used in the outermost loop `outer` around the range are counted:
+// ones just living through it are spilled instead of the split vreg, at low cost.
+static void count_range_pressure(LiveInterval *intervals, Vector *bbs, LoopRange *outer,
+                                 int start, int end, int *marks, int stamp, int *pressures[2]) {
+  int len = end - start + 1;
+  for (int c = 0; c < 2; ++c) {
+    pressures[c] = malloc_or_die(sizeof(*pressures[c]) * (len + 1));
+    memset(pressures[c], 0, sizeof(*pressures[c]) * (len + 1));
+  }
+
+  for (int i = outer->head; i <= outer->tail; ++i) {
+    BB *bb = bbs->data[i];
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      VReg *regs[] = {ir->dst, ir->opr1, ir->opr2};
+      for (int k = 0; k < 3; ++k) {
+        VReg *reg = regs[k];
+        if (reg == NULL || marks[reg->virt] == stamp)
+          continue;
+        marks[reg->virt] = stamp;
+        LiveInterval *li = &intervals[reg->virt];
+        if (li->state != LI_NORMAL)
+          continue;
+        int s = li->start - start;
+        int e = (li->end > li->start ? li->end : li->start + 1) - start;
+        if (s >= len || e <= 0)
+          continue;
+        int *pressure = pressures[is_flonum_vreg(reg)];
+        ++pressure[s > 0 ? s : 0];
+        --pressure[e < len ? e : len];
+      }
+    }
+  }
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 1; i < len; ++i)
+      pressures[c][i] += pressures[c][i - 1];
+  }
+}
+
+// Split vregs which are going to be spilled, at the outermost loops where they are used.
+// Vregs are tried only once: `tried` is indexed by original vregs, up to `split_limit`.
+// `origins` maps split vregs to the original ones.
+static bool split_spilled_at_loops(RegAlloc *ra, BBContainer *bbcon, LiveInterval *intervals,
+                                   int split_limit, bool *tried, Vector *origins) {
+  Vector *bbs = bbcon->bbs;
+  int vreg_count = ra->vregs->len;
+
+  // Blocks which refer each candidate, in ascending order.
+  Vector **ref_bbs = calloc(vreg_count, sizeof(*ref_bbs));
+  Vector *candidates = new_vector();
+  for (int i = 0; i < split_limit; ++i) {
+    VReg *vreg = ra->vregs->data[i];
+    if (intervals[i].state == LI_SPILL && !tried[i] &&
+        !(vreg->flag & (VRF_SPILLED | VRF_REF | VRF_CONST | VRF_NO_SPILL))) {
+      ref_bbs[i] = new_vector();
+      vec_push(candidates, vreg);
+    }
+  }
+  if (candidates->len == 0) {
+    free(ref_bbs);
+    return false;
+  }
+  Table indices;
+  map_bb_indices(bbs, &indices);
+  Vector *ranges = detect_loop_ranges(bbs, &indices);
+  if (ranges->len == 0) {
+    free(ref_bbs);
+    return false;
+  }
+
+  int *bb_pos = malloc_or_die(sizeof(*bb_pos) * (bbs->len + 1));
+  bb_pos[0] = 0;
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    bb_pos[i + 1] = bb_pos[i] + bb->irs->len;
+
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      VReg *regs[] = {ir->dst, ir->opr1, ir->opr2};
+      for (int k = 0; k < 3; ++k) {
+        VReg *reg = regs[k];
+        if (reg == NULL || ref_bbs[reg->virt] == NULL)
+          continue;
+        Vector *refs = ref_bbs[reg->virt];
+        if (refs->len == 0 || (intptr_t)refs->data[refs->len - 1] != i)
+          vec_push(refs, (void*)(intptr_t)i);
+      }
+    }
+  }
+
+  // Register pressure in each range, on which split vregs are added.
+  int *marks = calloc(vreg_count, sizeof(*marks));
+  int **range_pressures = malloc_or_die(sizeof(*range_pressures) * ranges->len * 2);
+  for (int i = 0; i < ranges->len; ++i) {
+    LoopRange *range = ranges->data[i];
+    LoopRange *outer = range;
+    for (int j = 0; j < i; ++j) {
+      LoopRange *p = ranges->data[j];
+      if (p->tail >= range->tail) {
+        outer = p;
+        break;
+      }
+    }
+    count_range_pressure(intervals, bbs, outer, bb_pos[range->head], bb_pos[range->tail + 1],
+                         marks, i + 1, &range_pressures[i * 2]);
+  }
+
+  bool split = false;
+  Vector *edges = new_vector();  // <EdgeCode*>
+  for (int i = 0; i < candidates->len; ++i) {
+    VReg *vreg = candidates->data[i];
+    Vector *refs = ref_bbs[vreg->virt];
+    if (refs->len == 0)
+      continue;
+    int first = (intptr_t)refs->data[0], last = (intptr_t)refs->data[refs->len - 1];
+    tried[vreg->virt] = true;
+    bool flonum = is_flonum_vreg(vreg);
+    int phys_max = flonum ? ra->fphys_max : ra->phys_max;
+    int done = -1;
+    for (int j = 0; j < ranges->len; ++j) {
+      LoopRange *range = ranges->data[j];
+      // Worth to split only if it is used both in the loop and out of the loop.
+      if (range->head <= done || (first >= range->head && last <= range->tail))
+        continue;
+      bool used = false;
+      for (int k = 0; k < refs->len; ++k) {
+        int index = (intptr_t)refs->data[k];
+        if (index >= range->head && index <= range->tail) {
+          used = true;
+          break;
+        }
+      }
+      if (!used)
+        continue;
+
+      int start = bb_pos[range->head], end = bb_pos[range->tail + 1];
+      int *pressure = range_pressures[j * 2 + flonum];
+      int len = end - start + 1;
+      int k;
+      for (k = 0; k < len; ++k) {
+        if (pressure[k] >= phys_max)
+          break;
+      }
+      if (k < len)  // No room: might be in an inner loop.
+        continue;
+
+      // Ranges overlapping this one get the register occupied, too.
+      for (int l = 0; l < ranges->len; ++l) {
+        LoopRange *other = ranges->data[l];
+        int *p = range_pressures[l * 2 + flonum];
+        if (other->tail < range->head || other->head > range->tail)
+          continue;
+        int s = bb_pos[other->head];
+        int from = start > s ? start : s;
+        int to = end < bb_pos[other->tail + 1] ? end : bb_pos[other->tail + 1];
+        for (int m = from; m <= to; ++m)
+          ++p[m - s];
+      }
+
+      split_in_range(ra, bbs, &indices, range, vreg, edges, origins);
+      done = range->tail;
+      split = true;
+    }
+  }
+
+  for (int i = 0; i < edges->len; ++i)
+    put_edge_code(bbcon, edges->data[i]);
+
+  for (int i = 0; i < ranges->len * 2; ++i)
+    free(range_pressures[i]);
+  free(range_pressures);
+  free(marks);
+  free(bb_pos);
+  free(ref_bbs);
+
+  if (split) {
+    detect_from_bbs(bbcon);
+    analyze_reg_flow(bbcon);
+  }
+  return split;
+}
+
+// Split vreg which is spilled after all would only add moves on the edges:
+// put the original vreg back.
+static bool undo_spilled_splits(RegAlloc *ra, BBContainer *bbcon, LiveInterval *intervals,
+                                Vector *origins) {
+  VReg **replaces = NULL;
+  for (int i = 0; i < origins->len; ++i) {
+    VReg *origin = origins->data[i];
+    if (origin == NULL || intervals[i].state != LI_SPILL)
+      continue;
+    if (replaces == NULL)
+      replaces = calloc(ra->vregs->len, sizeof(*replaces));
+    replaces[i] = origin;
+    origins->data[i] = NULL;
+  }
+  if (replaces == NULL)
+    return false;
+
+  for (int i = 0; i < bbcon->bbs->len; ++i) {
+    BB *bb = bbcon->bbs->data[i];
+    Vector *irs = bb->irs;
+    for (int j = 0; j < irs->len; ++j) {
+      IR *ir = irs->data[j];
+      VReg **regs[] = {&ir->dst, &ir->opr1, &ir->opr2};
+      for (int k = 0; k < 3; ++k) {
+        VReg *reg = *regs[k];
+        if (reg != NULL && reg->virt < origins->len && replaces[reg->virt] != NULL)
+          *regs[k] = replaces[reg->virt];
+      }
+      if (ir->kind == IR_MOV && ir->dst == ir->opr1)
+        vec_remove_at(irs, j--);
+    }
+  }
+  free(replaces);
+
+  analyze_reg_flow(bbcon);
+  return true;
+}
+
 void alloc_physical_registers(RegAlloc *ra, BBContainer *bbcon) {
   assert(ra->phys_max < (int)(sizeof(ra->used_reg_bits) * CHAR_BIT));
 #ifndef __NO_FLONUM
@@ -312,11 +883,15 @@ void alloc_physical_registers(RegAlloc *ra, BBContainer *bbcon) {
 
   LiveInterval *intervals = NULL;
   LiveInterval **sorted_intervals = NULL;
+  int *loop_depths = calc_loop_depths(bbcon);
+  int split_limit = ra->vregs->len;
+  bool *split_tried = calloc(split_limit, sizeof(*split_tried));
+  Vector *origins = new_vector();  // <VReg*>
 
   for (;;) {
     int vreg_count = ra->vregs->len;
     intervals = realloc_or_die(intervals, sizeof(LiveInterval) * vreg_count);
-    check_live_interval(bbcon, vreg_count, intervals);
+    check_live_interval(bbcon, loop_depths, ra->vregs, intervals);
 
     for (int i = 0; i < vreg_count; ++i) {
       LiveInterval *li = &intervals[i];
@@ -327,12 +902,6 @@ void alloc_physical_registers(RegAlloc *ra, BBContainer *bbcon) {
         continue;
       }
 
-      // Force function parameter spilled.
-      if (vreg->param_index >= 0) {
-        spill_vreg(vreg);
-        li->start = 0;
-        li->state = LI_SPILL;
-      }
       if (vreg->flag & VRF_SPILLED) {
         li->state = LI_SPILL;
         li->phys = vreg->phys;
@@ -348,6 +917,15 @@ void alloc_physical_registers(RegAlloc *ra, BBContainer *bbcon) {
 
     linear_scan_register_allocation(ra, sorted_intervals, vreg_count);
 
+    // Allocate again after live ranges are split or put back, before spilling any.
+    if (undo_spilled_splits(ra, bbcon, intervals, origins))
+      continue;
+    if (split_spilled_at_loops(ra, bbcon, intervals, split_limit, split_tried, origins)) {
+      free(loop_depths);
+      loop_depths = calc_loop_depths(bbcon);
+      continue;
+    }
+
     // Spill vregs.
     for (int i = 0; i < vreg_count; ++i) {
       LiveInterval *li = &intervals[i];
@@ -362,7 +940,11 @@ void alloc_physical_registers(RegAlloc *ra, BBContainer *bbcon) {
     if (insert_load_store_spilled_irs(ra, bbcon) <= 0)
       break;
   }
+  free(loop_depths);
+  free(split_tried);
 
   ra->intervals = intervals;
   ra->sorted_intervals = sorted_intervals;
+
+  reuse_spilled_values(ra, bbcon);
 }
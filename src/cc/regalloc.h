@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>  // size_t
+#include <stdint.h>  // int64_t
 
 typedef struct BBContainer BBContainer;
 typedef struct Function Function;
@@ -23,6 +24,8 @@ typedef struct LiveInterval {
   int end;
   int virt;  // Virtual reg no.
   int phys;  // Mapped physical reg no.
+  int spill_cost;  // Reference count, weighted by loop depth.
+  int64_t weighted_length;  // Length, weighted by loop depth in the same way.
 } LiveInterval;
 
 typedef struct RegAlloc {
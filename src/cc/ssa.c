@@ -0,0 +1,615 @@
+// Static Single Assignment form
+
+#include "../config.h"
+#include "ssa.h"
+
+#include <assert.h>
+#include <limits.h>  // CHAR_BIT
+#include <stdlib.h>  // calloc
+#include <string.h>  // memcmp
+
+#include "ir.h"
+#include "regalloc.h"
+#include "table.h"
+#include "util.h"
+
+// Bit set
+
+typedef unsigned long BitWord;
+#define WORD_BITS  ((int)(sizeof(BitWord) * CHAR_BIT))
+#define BITSET_WORDS(n)  (((n) + WORD_BITS - 1) / WORD_BITS)
+
+static BitWord *new_bitset(int nbits) {
+  return calloc(BITSET_WORDS(nbits) + 1, sizeof(BitWord));
+}
+
+static bool bitset_test(const BitWord *bits, int i) {
+  return (bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+static void bitset_set(BitWord *bits, int i) {
+  bits[i / WORD_BITS] |= (BitWord)1 << (i % WORD_BITS);
+}
+
+static void bitset_reset(BitWord *bits, int i) {
+  bits[i / WORD_BITS] &= ~((BitWord)1 << (i % WORD_BITS));
+}
+
+// Control flow graph
+
+typedef struct BBInfo {
+  BB *bb;
+  int index;             // Index in BBContainer.
+  int order;             // Reverse post order, -1 if unreachable.
+  struct BBInfo *idom;   // Immediate dominator.
+  Vector *succs;         // <BBInfo*>, distinct.
+  Vector *preds;         // <BBInfo*>, distinct.
+  Vector *children;      // <BBInfo*>, in dominator tree.
+  Vector *frontier;      // <BBInfo*>, dominance frontier.
+  BitWord *use;          // Registers used before assigned.
+  BitWord *def;          // Registers assigned.
+  BitWord *live_in;
+  Vector *phi_vars;      // <VReg*>, original register for each phi.
+} BBInfo;
+
+typedef struct Ssa {
+  RegAlloc *ra;
+  BBContainer *bbcon;
+  Table bbtbl;           // <BB label, BBInfo*>
+  BBInfo *infos;
+  BBInfo **rpo;          // Reachable blocks in reverse post order.
+  int rpo_count;
+  int vreg_count;        // Register count before renaming.
+  BitWord *targets;      // Registers to be renamed.
+  Vector **stacks;       // <VReg*>, renamed registers for each original.
+} Ssa;
+
+static void push_distinct(Vector *vec, void *elem) {
+  if (!vec_contains(vec, elem))
+    vec_push(vec, elem);
+}
+
+static IR *last_ir(BB *bb) {
+  int len = bb->irs->len;
+  return len > 0 ? bb->irs->data[len - 1] : NULL;
+}
+
+// Enumerate distinct successor blocks.
+void collect_succs(BB *bb, Vector *succs) {
+  IR *ir = last_ir(bb);
+  if (ir != NULL) {
+    switch (ir->kind) {
+    case IR_JMP:
+      push_distinct(succs, ir->jmp.bb);
+      if (ir->jmp.cond == COND_ANY)
+        return;
+      break;
+    case IR_TJMP:
+      for (size_t i = 0; i < ir->tjmp.len; ++i)
+        push_distinct(succs, ir->tjmp.bbs[i]);
+      return;
+    default: break;
+    }
+  }
+  if (bb->next != NULL)
+    push_distinct(succs, bb->next);
+}
+
+static void remove_unreachable_bbs(BBContainer *bbcon) {
+  Vector *bbs = bbcon->bbs;
+  Table reached;
+  table_init(&reached);
+  Vector *stack = new_vector();
+  BB *bb0 = bbs->data[0];
+  table_put(&reached, bb0->label, bb0);
+  vec_push(stack, bb0);
+  Vector *succs = new_vector();
+  while (stack->len > 0) {
+    BB *bb = vec_pop(stack);
+    vec_clear(succs);
+    collect_succs(bb, succs);
+    for (int i = 0; i < succs->len; ++i) {
+      BB *succ = succs->data[i];
+      if (table_get(&reached, succ->label) == NULL) {
+        table_put(&reached, succ->label, succ);
+        vec_push(stack, succ);
+      }
+    }
+  }
+
+  // Keep the last block, which falls into the function epilogue.
+  for (int i = bbs->len - 1; --i >= 1; ) {
+    BB *bb = bbs->data[i];
+    if (table_get(&reached, bb->label) == NULL) {
+      BB *prev = bbs->data[i - 1];
+      prev->next = bb->next;
+      vec_remove_at(bbs, i);
+    }
+  }
+
+  // Conditional jump to the next block is redundant.
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    IR *ir = last_ir(bb);
+    if (ir != NULL && ir->kind == IR_JMP && ir->jmp.bb == bb->next)
+      vec_pop(bb->irs);
+  }
+}
+
+static BBInfo *get_info(Ssa *ssa, BB *bb) {
+  BBInfo *info = table_get(&ssa->bbtbl, bb->label);
+  assert(info != NULL);
+  return info;
+}
+
+static void dfs_postorder(Ssa *ssa, BBInfo *info, int *count) {
+  info->order = 0;  // Visited.
+  for (int i = 0; i < info->succs->len; ++i) {
+    BBInfo *succ = info->succs->data[i];
+    if (succ->order < 0)
+      dfs_postorder(ssa, succ, count);
+  }
+  ssa->rpo[(*count)++] = info;
+}
+
+static void build_cfg(Ssa *ssa) {
+  Vector *bbs = ssa->bbcon->bbs;
+  int bb_count = bbs->len;
+  ssa->infos = calloc(bb_count, sizeof(*ssa->infos));
+  table_init(&ssa->bbtbl);
+  for (int i = 0; i < bb_count; ++i) {
+    BBInfo *info = &ssa->infos[i];
+    info->bb = bbs->data[i];
+    info->index = i;
+    info->order = -1;
+    info->idom = NULL;
+    info->succs = new_vector();
+    info->preds = new_vector();
+    info->children = new_vector();
+    info->frontier = new_vector();
+    info->phi_vars = new_vector();
+    table_put(&ssa->bbtbl, info->bb->label, info);
+  }
+
+  Vector *succs = new_vector();
+  for (int i = 0; i < bb_count; ++i) {
+    BBInfo *info = &ssa->infos[i];
+    vec_clear(succs);
+    collect_succs(info->bb, succs);
+    for (int j = 0; j < succs->len; ++j) {
+      BBInfo *succ = get_info(ssa, succs->data[j]);
+      vec_push(info->succs, succ);
+      vec_push(succ->preds, info);
+    }
+  }
+
+  // Reverse post order.
+  ssa->rpo = malloc_or_die(sizeof(*ssa->rpo) * bb_count);
+  int count = 0;
+  dfs_postorder(ssa, &ssa->infos[0], &count);
+  for (int i = 0, j = count - 1; i < j; ++i, --j) {
+    BBInfo *tmp = ssa->rpo[i];
+    ssa->rpo[i] = ssa->rpo[j];
+    ssa->rpo[j] = tmp;
+  }
+  for (int i = 0; i < count; ++i)
+    ssa->rpo[i]->order = i;
+  ssa->rpo_count = count;
+}
+
+// Dominator tree, by Cooper, Harvey and Kennedy: "A Simple, Fast Dominance Algorithm".
+
+static BBInfo *intersect_dom(BBInfo *b1, BBInfo *b2) {
+  while (b1 != b2) {
+    while (b1->order > b2->order)
+      b1 = b1->idom;
+    while (b2->order > b1->order)
+      b2 = b2->idom;
+  }
+  return b1;
+}
+
+static void build_dominators(Ssa *ssa) {
+  BBInfo *entry = ssa->rpo[0];
+  entry->idom = entry;
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (int i = 1; i < ssa->rpo_count; ++i) {
+      BBInfo *info = ssa->rpo[i];
+      BBInfo *idom = NULL;
+      for (int j = 0; j < info->preds->len; ++j) {
+        BBInfo *pred = info->preds->data[j];
+        if (pred->idom == NULL)
+          continue;
+        idom = idom == NULL ? pred : intersect_dom(pred, idom);
+      }
+      if (info->idom != idom) {
+        info->idom = idom;
+        changed = true;
+      }
+    }
+  }
+
+  for (int i = 1; i < ssa->rpo_count; ++i) {
+    BBInfo *info = ssa->rpo[i];
+    vec_push(info->idom->children, info);
+  }
+
+  for (int i = 0; i < ssa->rpo_count; ++i) {
+    BBInfo *info = ssa->rpo[i];
+    if (info->preds->len < 2)
+      continue;
+    for (int j = 0; j < info->preds->len; ++j) {
+      BBInfo *runner = info->preds->data[j];
+      if (runner->order < 0)
+        continue;
+      for (; runner != info->idom; runner = runner->idom)
+        push_distinct(runner->frontier, info);
+    }
+  }
+}
+
+// Liveness
+
+static bool is_target(Ssa *ssa, VReg *vreg) {
+  return vreg != NULL && vreg->virt < ssa->vreg_count && bitset_test(ssa->targets, vreg->virt);
+}
+
+static void analyze_liveness(Ssa *ssa) {
+  int vreg_count = ssa->vreg_count;
+  for (int i = 0; i < ssa->rpo_count; ++i) {
+    BBInfo *info = ssa->rpo[i];
+    info->use = new_bitset(vreg_count);
+    info->def = new_bitset(vreg_count);
+    info->live_in = new_bitset(vreg_count);
+    Vector *irs = info->bb->irs;
+    for (int j = 0; j < irs->len; ++j) {
+      IR *ir = irs->data[j];
+      VReg *oprs[] = {ir->opr1, ir->opr2};
+      for (int k = 0; k < 2; ++k) {
+        VReg *opr = oprs[k];
+        if (is_target(ssa, opr) && !bitset_test(info->def, opr->virt))
+          bitset_set(info->use, opr->virt);
+      }
+      if (is_target(ssa, ir->dst))
+        bitset_set(info->def, ir->dst->virt);
+    }
+    memcpy(info->live_in, info->use, sizeof(BitWord) * BITSET_WORDS(vreg_count));
+  }
+
+  int nwords = BITSET_WORDS(vreg_count);
+  BitWord *live_in = new_bitset(vreg_count);
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (int i = ssa->rpo_count; --i >= 0; ) {
+      BBInfo *info = ssa->rpo[i];
+      for (int w = 0; w < nwords; ++w) {
+        BitWord out = 0;
+        for (int j = 0; j < info->succs->len; ++j) {
+          BBInfo *succ = info->succs->data[j];
+          out |= succ->live_in[w];
+        }
+        live_in[w] = info->use[w] | (out & ~info->def[w]);
+      }
+      if (memcmp(live_in, info->live_in, sizeof(BitWord) * nwords) != 0) {
+        memcpy(info->live_in, live_in, sizeof(BitWord) * nwords);
+        changed = true;
+      }
+    }
+  }
+  free(live_in);
+}
+
+// Phi placement: iterated dominance frontier, pruned by liveness.
+
+static void insert_phi(BBInfo *info, VReg *vreg) {
+  BB *bb = info->bb;
+  Phi *phi = malloc_or_die(sizeof(*phi));
+  phi->dst = vreg;
+  phi->params = new_vector();
+  for (int i = 0; i < bb->from_bbs->len; ++i)
+    vec_push(phi->params, vreg);
+  if (bb->phis == NULL)
+    bb->phis = new_vector();
+  vec_push(bb->phis, phi);
+  vec_push(info->phi_vars, vreg);
+}
+
+static void place_phis(Ssa *ssa) {
+  int vreg_count = ssa->vreg_count;
+  Vector **defsites = calloc(vreg_count, sizeof(*defsites));
+  for (int i = 0; i < ssa->rpo_count; ++i) {
+    BBInfo *info = ssa->rpo[i];
+    Vector *irs = info->bb->irs;
+    for (int j = 0; j < irs->len; ++j) {
+      IR *ir = irs->data[j];
+      if (!is_target(ssa, ir->dst))
+        continue;
+      int virt = ir->dst->virt;
+      if (defsites[virt] == NULL)
+        defsites[virt] = new_vector();
+      Vector *sites = defsites[virt];
+      if (sites->len == 0 || sites->data[sites->len - 1] != info)
+        vec_push(sites, info);
+    }
+  }
+
+  int bb_count = ssa->bbcon->bbs->len;
+  int *phi_mark = calloc(bb_count, sizeof(*phi_mark));
+  int *work_mark = calloc(bb_count, sizeof(*work_mark));
+  Vector *work = new_vector();
+  for (int v = 0; v < vreg_count; ++v) {
+    Vector *sites = defsites[v];
+    if (sites == NULL)
+      continue;
+    VReg *vreg = ssa->ra->vregs->data[v];
+    int stamp = v + 1;
+    for (int i = 0; i < sites->len; ++i) {
+      BBInfo *info = sites->data[i];
+      work_mark[info->index] = stamp;
+      vec_push(work, info);
+    }
+    while (work->len > 0) {
+      BBInfo *info = vec_pop(work);
+      for (int i = 0; i < info->frontier->len; ++i) {
+        BBInfo *df = info->frontier->data[i];
+        if (phi_mark[df->index] == stamp)
+          continue;
+        phi_mark[df->index] = stamp;
+        if (bitset_test(df->live_in, v))
+          insert_phi(df, vreg);
+        if (work_mark[df->index] != stamp) {
+          work_mark[df->index] = stamp;
+          vec_push(work, df);
+        }
+      }
+    }
+  }
+  free(phi_mark);
+  free(work_mark);
+  free(defsites);
+}
+
+// Renaming
+
+static VReg *current_name(Ssa *ssa, VReg *vreg) {
+  Vector *stack = ssa->stacks[vreg->virt];
+  // Original register stands for the value at the function entry.
+  return stack == NULL || stack->len == 0 ? vreg : stack->data[stack->len - 1];
+}
+
+static VReg *new_name(Ssa *ssa, VReg *vreg, Vector *pushed) {
+  VReg *renamed = reg_alloc_spawn(ssa->ra, vreg->vtype, 0);
+  Vector *stack = ssa->stacks[vreg->virt];
+  if (stack == NULL)
+    ssa->stacks[vreg->virt] = stack = new_vector();
+  vec_push(stack, renamed);
+  vec_push(pushed, vreg);
+  return renamed;
+}
+
+static void rename_block(Ssa *ssa, BBInfo *info) {
+  BB *bb = info->bb;
+  Vector *pushed = new_vector();
+
+  for (int i = 0; i < info->phi_vars->len; ++i) {
+    Phi *phi = bb->phis->data[i];
+    phi->dst = new_name(ssa, info->phi_vars->data[i], pushed);
+  }
+
+  Vector *irs = bb->irs;
+  for (int i = 0; i < irs->len; ++i) {
+    IR *ir = irs->data[i];
+    if (is_target(ssa, ir->opr1))
+      ir->opr1 = current_name(ssa, ir->opr1);
+    if (is_target(ssa, ir->opr2))
+      ir->opr2 = current_name(ssa, ir->opr2);
+    if (is_target(ssa, ir->dst))
+      ir->dst = new_name(ssa, ir->dst, pushed);
+  }
+
+  for (int i = 0; i < info->succs->len; ++i) {
+    BBInfo *succ = info->succs->data[i];
+    Vector *from_bbs = succ->bb->from_bbs;
+    for (int j = 0; j < from_bbs->len; ++j) {
+      if (from_bbs->data[j] != bb)
+        continue;
+      for (int k = 0; k < succ->phi_vars->len; ++k) {
+        Phi *phi = succ->bb->phis->data[k];
+        phi->params->data[j] = current_name(ssa, succ->phi_vars->data[k]);
+      }
+    }
+  }
+
+  for (int i = 0; i < info->children->len; ++i)
+    rename_block(ssa, info->children->data[i]);
+
+  for (int i = 0; i < pushed->len; ++i) {
+    VReg *vreg = pushed->data[i];
+    vec_pop(ssa->stacks[vreg->virt]);
+  }
+}
+
+void make_ssa(RegAlloc *ra, BBContainer *bbcon) {
+  remove_unreachable_bbs(bbcon);
+  detect_from_bbs(bbcon);
+
+  // Entry block must not have predecessors, to hold the initial values.
+  BB *bb0 = bbcon->bbs->data[0];
+  if (bb0->from_bbs->len > 0) {
+    BB *entry = new_bb();
+    entry->next = bb0;
+    vec_insert(bbcon->bbs, 0, entry);
+    detect_from_bbs(bbcon);
+  }
+
+  Ssa ssa;
+  ssa.ra = ra;
+  ssa.bbcon = bbcon;
+  ssa.vreg_count = ra->vregs->len;
+
+  ssa.targets = new_bitset(ssa.vreg_count);
+  for (int i = 0; i < ssa.vreg_count; ++i) {
+    VReg *vreg = ra->vregs->data[i];
+    if (!(vreg->flag & (VRF_CONST | VRF_SPILLED | VRF_REF)) &&
+        !(vreg->vtype->flag & VRTF_NON_REG))
+      bitset_set(ssa.targets, i);
+  }
+  // Register whose address is taken lives in memory.
+  for (int i = 0; i < bbcon->bbs->len; ++i) {
+    BB *bb = bbcon->bbs->data[i];
+    for (int j = 0; j < bb->irs->len; ++j) {
+      IR *ir = bb->irs->data[j];
+      if (ir->kind == IR_BOFS && ir->opr1 != NULL)
+        bitset_reset(ssa.targets, ir->opr1->virt);
+    }
+  }
+
+  build_cfg(&ssa);
+  build_dominators(&ssa);
+  analyze_liveness(&ssa);
+  place_phis(&ssa);
+
+  ssa.stacks = calloc(ssa.vreg_count, sizeof(*ssa.stacks));
+  rename_block(&ssa, ssa.rpo[0]);
+
+  free(ssa.stacks);
+  free(ssa.targets);
+}
+
+// Destruction
+
+// Code on an edge cannot be put at the end of a block which has multiple successors.
+bool need_split_edge(BB *from) {
+  IR *ir = last_ir(from);
+  if (ir != NULL && ir->kind == IR_TJMP)
+    return true;
+  Vector *succs = new_vector();
+  collect_succs(from, succs);
+  return succs->len > 1;
+}
+
+static int index_of_bb(BBContainer *bbcon, BB *bb) {
+  Vector *bbs = bbcon->bbs;
+  for (int i = 0; i < bbs->len; ++i) {
+    if (bbs->data[i] == bb)
+      return i;
+  }
+  assert(false);
+  return -1;
+}
+
+// Insert a new block on the edge, and returns it.
+BB *split_edge(BBContainer *bbcon, BB *from, BB *to) {
+  BB *bb = new_bb();
+  bool need_jmp = true;
+  IR *ir = last_ir(from);
+  if (ir != NULL && ir->kind == IR_TJMP) {
+    for (size_t i = 0; i < ir->tjmp.len; ++i) {
+      if (ir->tjmp.bbs[i] == to)
+        ir->tjmp.bbs[i] = bb;
+    }
+  } else if (ir != NULL && ir->kind == IR_JMP && ir->jmp.bb == to) {
+    // Invert the condition to fall into the new block, which jumps to the destination.
+    assert(ir->jmp.cond != COND_ANY && from->next != to);
+    ir->jmp.cond = invert_cond(ir->jmp.cond);
+    ir->jmp.bb = from->next;
+  } else {
+    assert(from->next == to);
+    need_jmp = false;
+  }
+
+  if (need_jmp) {
+    BB *saved = curbb;
+    curbb = bb;
+    new_ir_jmp(COND_ANY, to);
+    curbb = saved;
+  }
+
+  bb->next = from->next;
+  from->next = bb;
+  vec_insert(bbcon->bbs, index_of_bb(bbcon, from) + 1, bb);
+  return bb;
+}
+
+// Sequentialize parallel copies and insert them at the end of the block.
+static void insert_copies(RegAlloc *ra, BB *bb, Vector *dsts, Vector *srcs) {
+  Vector *irs = bb->irs;
+  int pos = irs->len;
+  IR *ir = last_ir(bb);
+  if (ir != NULL && ir->kind == IR_JMP) {
+    assert(ir->jmp.cond == COND_ANY);
+    --pos;
+  }
+
+  while (dsts->len > 0) {
+    bool progress = false;
+    for (int i = 0; i < dsts->len; ++i) {
+      VReg *dst = dsts->data[i];
+      if (vec_contains(srcs, dst))
+        continue;
+      vec_insert(irs, pos++, new_ir_mov(dst, srcs->data[i]));
+      vec_remove_at(dsts, i);
+      vec_remove_at(srcs, i);
+      --i;
+      progress = true;
+    }
+    if (!progress) {
+      // Break the cycle with a temporary register.
+      VReg *dst = dsts->data[0];
+      VReg *tmp = reg_alloc_spawn(ra, dst->vtype, 0);
+      vec_insert(irs, pos++, new_ir_mov(tmp, dst));
+      for (int i = 0; i < srcs->len; ++i) {
+        if (srcs->data[i] == dst)
+          srcs->data[i] = tmp;
+      }
+    }
+  }
+}
+
+void resolve_phis(RegAlloc *ra, BBContainer *bbcon) {
+  Vector *bbs = new_vector();
+  for (int i = 0; i < bbcon->bbs->len; ++i)
+    vec_push(bbs, bbcon->bbs->data[i]);
+
+  Vector *dsts = new_vector();
+  Vector *srcs = new_vector();
+  for (int i = 0; i < bbs->len; ++i) {
+    BB *bb = bbs->data[i];
+    Vector *phis = bb->phis;
+    bb->phis = NULL;
+    if (phis == NULL || phis->len == 0)
+      continue;
+
+    Vector *from_bbs = bb->from_bbs;
+    for (int j = 0; j < from_bbs->len; ++j) {
+      BB *from = from_bbs->data[j];
+      int k;
+      for (k = 0; k < j; ++k) {
+        if (from_bbs->data[k] == from)
+          break;
+      }
+      if (k < j)  // Already handled.
+        continue;
+
+      vec_clear(dsts);
+      vec_clear(srcs);
+      for (k = 0; k < phis->len; ++k) {
+        Phi *phi = phis->data[k];
+        VReg *src = phi->params->data[j];
+        if (src != phi->dst) {
+          vec_push(dsts, phi->dst);
+          vec_push(srcs, src);
+        }
+      }
+      if (dsts->len == 0)
+        continue;
+
+      if (need_split_edge(from))
+        from = split_edge(bbcon, from, bb);
+      insert_copies(ra, from, dsts, srcs);
+    }
+  }
+
+  detect_from_bbs(bbcon);
+}
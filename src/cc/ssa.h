@@ -0,0 +1,26 @@
+// Static Single Assignment form
+
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct BB BB;
+typedef struct BBContainer BBContainer;
+typedef struct RegAlloc RegAlloc;
+typedef struct Vector Vector;
+
+// Rename non-spilled virtual registers so that each one is assigned only once,
+// and insert phi nodes at the join points.
+void make_ssa(RegAlloc *ra, BBContainer *bbcon);
+
+// Replace phi nodes with moves at the end of predecessor blocks.
+void resolve_phis(RegAlloc *ra, BBContainer *bbcon);
+
+// Enumerate distinct successor blocks.
+void collect_succs(BB *bb, Vector *succs);
+
+// Code on an edge cannot be put at the end of a block which has multiple successors.
+bool need_split_edge(BB *from);
+
+// Insert a new block on the edge, and returns it.
+BB *split_edge(BBContainer *bbcon, BB *from, BB *to);
@@ -2,6 +2,7 @@
 
 #include <string.h>
 
+#include "pch.h"
 #include "preprocessor.h"
 #include "util.h"
 
@@ -25,6 +26,9 @@ int main(int argc, char *argv[]) {
   enum {
     OPT_ISYSTEM = 128,
     OPT_IDIRAFTER,
+    OPT_TIME_REPORT,
+    OPT_EMIT_PCH,
+    OPT_INCLUDE_PCH,
   };
 
   static const struct option options[] = {
@@ -32,9 +36,15 @@ int main(int argc, char *argv[]) {
     {"isystem", required_argument, OPT_ISYSTEM},  // Add system include path
     {"idirafter", required_argument, OPT_IDIRAFTER},  // Add include path (after)
     {"D", required_argument},  // Define macro
+    {"emit-pch", required_argument, OPT_EMIT_PCH},  // Save result as precompiled header
+    {"include-pch", required_argument, OPT_INCLUDE_PCH},  // Load precompiled header
+    {"ftime-report=", required_argument, OPT_TIME_REPORT},  // Append time report to the file
+    {"ftime-report", no_argument, OPT_TIME_REPORT},
     {"-version", no_argument, 'V'},
     {0},
   };
+  const char *emit_pch = NULL;
+  const char *include_pch = NULL;
   int opt;
   while ((opt = optparse(argc, argv, options)) != -1) {
     switch (opt) {
@@ -53,9 +63,30 @@ int main(int argc, char *argv[]) {
     case 'D':
       define_macro(optarg);
       break;
+    case OPT_TIME_REPORT:
+      enable_time_report(optarg);
+      break;
+    case OPT_EMIT_PCH:
+      emit_pch = optarg;
+      break;
+    case OPT_INCLUDE_PCH:
+      include_pch = optarg;
+      break;
     }
   }
 
+  char *pch_text = NULL;
+  size_t pch_size = 0;
+  if (emit_pch != NULL) {
+    ofp = open_memstream(&pch_text, &pch_size);
+    if (ofp == NULL)
+      error("Cannot open memory stream");
+    set_preprocess_output(ofp);
+  }
+
+  begin_phase("preprocess");
+  if (include_pch != NULL)
+    load_pch(include_pch, ofp);
   int iarg = optind;
   if (iarg < argc) {
     for (int i = iarg; i < argc; ++i) {
@@ -70,5 +101,17 @@ int main(int argc, char *argv[]) {
   } else {
     preprocess(stdin, "*stdin*");
   }
+  end_phase("preprocess");
+
+  if (emit_pch != NULL) {
+    fclose(ofp);
+    FILE *fp = fopen(emit_pch, "wb");
+    if (fp == NULL)
+      error("Cannot open output file: %s", emit_pch);
+    save_pch(fp, pch_text, pch_size);
+    fclose(fp);
+  }
+
+  output_time_report();
   return 0;
 }
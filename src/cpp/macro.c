@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <limits.h>  // INT_MAX
+#include <stdint.h>  // uintptr_t
 #include <stdlib.h>  // malloc
 #include <string.h>
 
@@ -37,85 +38,89 @@ Macro *new_macro(Vector *params, const Name *vaargs_ident, Vector *body) {
 
 //
 
-typedef Table HideSet;
-
-static Vector hideset_array;
-
-static int search_hideset(const Token *tok) {
-  int n = hideset_array.len >> 1;
-  int lo = -1, hi = n;
-  while (hi - lo > 1) {
-    int m = lo + ((hi - lo) >> 1);
-    const Token *t = hideset_array.data[m << 1];
-    if (t < tok)
-      lo = m;
-    else
-      hi = m;
-  }
-  return hi << 1;
-}
-
-static HideSet *get_hideset(const Token *tok) {
-  int i = search_hideset(tok);
-  assert(i >= 0 && i <= hideset_array.len);
-  if (i < hideset_array.len) {
-    const Token *t = hideset_array.data[i];
-    if (t == tok)
-      return hideset_array.data[i + 1];
-  }
-  return NULL;
-}
-
-static void set_token_hideset(const Token *tok, HideSet *hs) {
-  int i = search_hideset(tok);
-  assert(i >= 0 && i <= hideset_array.len);
-  if (i < hideset_array.len &&
-      ((Token*)hideset_array.data[i]) == tok) {
-    hideset_array.data[i + 1] = hs;
-  } else {
-    vec_insert(&hideset_array, i, tok);
-    vec_insert(&hideset_array, i + 1, hs);
+// Hideset: Set of macro names, shared among tokens.
+// Names are kept sorted by address and each set is a node in a trie from the empty set,
+// so equal sets are always the same object and can be compared by pointer.
+typedef struct HideSet {
+  const Name *name;  // Largest element.
+  const HideSet *parent;  // Rest of the elements.
+  Table children;  // <HideSet*>: Sets which extend this one with a larger name.
+} HideSet;
+
+static HideSet empty_hideset;
+
+static const HideSet *hideset_child(const HideSet *hs, const Name *name) {
+  HideSet *child = table_get((Table*)&hs->children, name);
+  if (child == NULL) {
+    child = malloc_or_die(sizeof(*child));
+    child->name = name;
+    child->parent = hs;
+    table_init(&child->children);
+    table_put((Table*)&hs->children, name, child);
   }
+  return child;
 }
 
-static HideSet *clone_hideset(HideSet *hs) {
-  HideSet *cloned = alloc_table();
-  if (hs != NULL) {
-    const Name *name;
-    void *value;
-    for (int it = 0; (it = table_iterate(hs, it, &name, &value)) != -1; )
-      table_put(cloned, name, value);
+static bool hideset_contains(const HideSet *hs, const Name *name) {
+  for (; hs != NULL && hs->name != NULL; hs = hs->parent) {
+    if (hs->name == name)
+      return true;
+    if ((uintptr_t)hs->name < (uintptr_t)name)
+      break;
   }
-  return cloned;
+  return false;
 }
 
-static void hideset_put(HideSet *hs, const Name *token) {
-  assert(hs != NULL);
-  table_put(hs, token, (void*)token);
+// Collects the names in descending order.
+static void hideset_names(const HideSet *hs, Vector *names) {
+  vec_clear(names);
+  for (; hs != NULL && hs->name != NULL; hs = hs->parent)
+    vec_push(names, hs->name);
 }
 
-static void union_hideset(HideSet *hs, HideSet *hs2) {
-  assert(hs != NULL);
-  if (hs2 != NULL) {
+static const HideSet *union_hideset(const HideSet *hs1, const HideSet *hs2) {
+  if (hs2 == NULL || hs2 == &empty_hideset || hs1 == hs2)
+    return hs1;
+  if (hs1 == NULL || hs1 == &empty_hideset)
+    return hs2;
+
+  static Vector names1, names2;
+  hideset_names(hs1, &names1);
+  hideset_names(hs2, &names2);
+  const HideSet *hs = &empty_hideset;
+  int i = names1.len, j = names2.len;
+  while (i > 0 || j > 0) {
+    const Name *n1 = i > 0 ? names1.data[i - 1] : NULL;
+    const Name *n2 = j > 0 ? names2.data[j - 1] : NULL;
     const Name *name;
-    void *value;
-    for (int it = 0; (it = table_iterate(hs2, it, &name, &value)) != -1; )
-      table_put(hs, name, value);
+    if (n2 == NULL || (n1 != NULL && (uintptr_t)n1 <= (uintptr_t)n2)) {
+      name = n1;
+      --i;
+      if (n1 == n2)
+        --j;
+    } else {
+      name = n2;
+      --j;
+    }
+    hs = hideset_child(hs, name);
   }
+  return hs;
 }
 
-static void intersection_hideset(HideSet *hs, HideSet *hs2) {
-  assert(hs != NULL);
-  if (hs2 == NULL) {
-    table_init(hs);
-  } else {
-    const Name *name;
-    void *value;
-    for (int it = 0; (it = table_iterate(hs, it, &name, &value)) != -1; ) {
-      if (!table_try_get(hs2, name, NULL))
-        table_delete(hs, name);
+static const HideSet *intersection_hideset(const HideSet *hs1, const HideSet *hs2) {
+  if (hs1 == hs2)
+    return hs1;
+  const HideSet *hs = &empty_hideset;
+  if (hs1 != NULL && hs2 != NULL) {
+    static Vector names;
+    hideset_names(hs1, &names);
+    for (int i = names.len; --i >= 0; ) {
+      const Name *name = names.data[i];
+      if (hideset_contains(hs2, name))
+        hs = hideset_child(hs, name);
     }
   }
+  return hs;
 }
 
 static void glue1(Vector *ls, const Token *tok2) {
@@ -172,22 +177,23 @@ static Token *stringize(const Vector *arg) {
   return tok;
 }
 
-static void hsadd(HideSet *hs, Vector *ts) {
+static void hsadd(const HideSet *hs, Vector *ts) {
   for (int i = 0; i < ts->len; ++i) {
     const Token *tok = ts->data[i];
     if (tok->kind == TK_IDENT || tok->kind == TK_RPAR) {
-      HideSet *h = get_hideset(tok);
-      if (h == NULL) {
-        h = clone_hideset(hs);
-        set_token_hideset(tok, h);
-      } else {
-        union_hideset(h, hs);
+      const HideSet *h = union_hideset(tok->hideset, hs);
+      if (h != tok->hideset) {
+        // Tokens are shared with the macro body or the arguments, so give each occurrence a copy.
+        Token *copied = malloc_or_die(sizeof(*copied));
+        *copied = *tok;
+        copied->hideset = h;
+        ts->data[i] = copied;
       }
     }
   }
 }
 
-static Vector *subst(Vector *body, Table *param_table, Vector *args, HideSet *hs) {
+static Vector *subst(Vector *body, Table *param_table, Vector *args, const HideSet *hs) {
   Vector *os = new_vector();
   if (body == NULL)
     return os;
@@ -289,25 +295,45 @@ void macro_delete(const Name *name) {
   table_delete(&macro_table, name);
 }
 
+int macro_iterate(int iterator, const Name **name, Macro **macro) {
+  return table_iterate(&macro_table, iterator, name, (void**)macro);
+}
+
+// Places `ts` in front of the unscanned tokens starting at `index`,
+// reusing the area already consumed, and returns the new start index.
+static int unshift_tokens(Vector *tokens, int out, int index, const Vector *ts) {
+  int n = ts->len;
+  if (index - out < n) {
+    // Move the rest backward, with extra room for successive expansions.
+    int rest = tokens->len - index;
+    int grow = n + rest;
+    for (int i = 0; i < grow; ++i)
+      vec_push(tokens, NULL);
+    memmove(&tokens->data[index + grow], &tokens->data[index], rest * sizeof(*tokens->data));
+    index += grow;
+  }
+  index -= n;
+  memcpy(&tokens->data[index], ts->data, n * sizeof(*tokens->data));
+  return index;
+}
+
 void macro_expand(Vector *tokens) {
-  for (int i = 0; i < tokens->len; ++i) {
+  // Expand in place as a gap buffer:
+  // [0, out) is the result, [out, i) is free, and [i, len) is to be scanned.
+  int out = 0;
+  for (int i = 0; i < tokens->len; ) {
     const Token *tok = tokens->data[i];
-    if (tok->kind != TK_IDENT)
-      continue;
-    Macro *macro = macro_get(tok->ident);
-    if (macro == NULL)
-      continue;
-    HideSet *hs = get_hideset(tok);
-    if (hs != NULL &&
-        table_try_get(hs, tok->ident, NULL)) {
+    Macro *macro;
+    if (tok->kind != TK_IDENT || (macro = macro_get(tok->ident)) == NULL ||
+        hideset_contains(tok->hideset, tok->ident)) {
+      tokens->data[out++] = tokens->data[i++];
       continue;
     }
 
     int next = i + 1;
     const Vector *replaced = NULL;
     if (macro->params_len < 0) {  // "()-less macro"
-      hs = clone_hideset(hs);
-      hideset_put(hs, tok->ident);
+      const HideSet *hs = union_hideset(tok->hideset, hideset_child(&empty_hideset, tok->ident));
       replaced = subst(macro->body, NULL, NULL, hs);
     } else {  // "()'d macro"
       Vector *args = pp_funargs(tokens, &next, macro->vaargs_ident != NULL ? macro->params_len : INT_MAX);
@@ -319,20 +345,18 @@ void macro_expand(Vector *tokens) {
         }
 
         assert(next > 0);
-        HideSet *hs2 = get_hideset(tokens->data[next - 1]);
-        hs = clone_hideset(hs);
-        intersection_hideset(hs, hs2);
-        hideset_put(hs, tok->ident);
+        const Token *rpar = tokens->data[next - 1];
+        const HideSet *hs = intersection_hideset(tok->hideset, rpar->hideset);
+        hs = union_hideset(hs, hideset_child(&empty_hideset, tok->ident));
         replaced = subst(macro->body, macro->param_table, args, hs);
       }
     }
 
-    if (replaced != NULL) {
-      for (int n = next - i; n > 0; --n)
-        vec_remove_at(tokens, i);
-      for (int j = 0; j < replaced->len; ++j)
-        vec_insert(tokens, i + j, replaced->data[j]);
-      --i;
+    if (replaced == NULL) {
+      tokens->data[out++] = tokens->data[i++];
+      continue;
     }
+    i = unshift_tokens(tokens, out, next, replaced);
   }
+  tokens->len = out;
 }
@@ -22,4 +22,5 @@ Macro *new_macro(Vector *params, const Name *vaargs_ident, Vector *body);
 void macro_add(const Name *name, Macro *macro);
 Macro *macro_get(const Name *name);
 void macro_delete(const Name *name);
+int macro_iterate(int iterator, const Name **name, Macro **macro);  // -1 => end
 void macro_expand(Vector *tokens);
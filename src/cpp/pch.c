@@ -0,0 +1,270 @@
+#include "../config.h"
+#include "pch.h"
+
+#include <stdint.h>
+#include <stdlib.h>  // malloc
+#include <string.h>
+
+#include "lexer.h"
+#include "macro.h"
+#include "preprocessor.h"
+#include "table.h"
+#include "util.h"
+
+// File layout:
+//   Magic
+//   Option signature, preprocessed text
+//   Number of files, {file name, guard macro name}
+//   Number of macros, {name, params_len + 1, params, vaargs_ident, body->len + 1, tokens}
+// Numbers are in unsigned LEB128, strings are prefixed with their length,
+// and names which can be NULL are prefixed with their length + 1 (0 for NULL).
+
+static const char kMagic[] = "XCCPCH1\n";
+#define MAGIC_SIZE  (sizeof(kMagic) - 1)
+
+static void write_uleb128(FILE *fp, uint64_t val) {
+  do {
+    unsigned char byte = val & 0x7f;
+    val >>= 7;
+    if (val != 0)
+      byte |= 0x80;
+    fputc(byte, fp);
+  } while (val != 0);
+}
+
+static void write_bytes(FILE *fp, const void *data, size_t size) {
+  write_uleb128(fp, size);
+  fwrite(data, size, 1, fp);
+}
+
+static void write_name(FILE *fp, const Name *name) {
+  if (name == NULL) {
+    write_uleb128(fp, 0);
+  } else {
+    write_uleb128(fp, name->bytes + 1);
+    fwrite(name->chars, name->bytes, 1, fp);
+  }
+}
+
+static void write_token(FILE *fp, const Token *tok) {
+  write_uleb128(fp, tok->kind);
+  write_bytes(fp, tok->begin, tok->end - tok->begin);
+  switch (tok->kind) {
+  case TK_INTLIT: case TK_CHARLIT: case TK_LONGLIT: case TK_LLONGLIT:
+  case TK_UINTLIT: case TK_UCHARLIT: case TK_ULONGLIT: case TK_ULLONGLIT:
+    write_uleb128(fp, tok->fixnum);
+    break;
+#ifndef __NO_FLONUM
+  case TK_FLOATLIT: case TK_DOUBLELIT:
+    {
+      uint64_t bits;
+      memcpy(&bits, &tok->flonum, sizeof(bits));
+      write_uleb128(fp, bits);
+    }
+    break;
+#endif
+  case TK_STR:
+    write_bytes(fp, tok->str.buf, tok->str.size);
+    break;
+  default: break;
+  }
+}
+
+static void write_macro(FILE *fp, const Macro *macro) {
+  int params_len = macro->params_len;
+  write_uleb128(fp, params_len + 1);
+  if (params_len > 0) {
+    const Name **params = malloc_or_die(sizeof(*params) * params_len);
+    const Name *name;
+    void *value;
+    for (int it = 0; (it = table_iterate(macro->param_table, it, &name, &value)) != -1; ) {
+      int index = (intptr_t)value;
+      if (index < params_len)
+        params[index] = name;
+    }
+    for (int i = 0; i < params_len; ++i)
+      write_name(fp, params[i]);
+    free(params);
+  }
+  write_name(fp, macro->vaargs_ident);
+
+  Vector *body = macro->body;
+  write_uleb128(fp, body != NULL ? body->len + 1 : 0);
+  if (body != NULL) {
+    for (int i = 0; i < body->len; ++i)
+      write_token(fp, body->data[i]);
+  }
+}
+
+void save_pch(FILE *fp, const char *text, size_t size) {
+  fwrite(kMagic, MAGIC_SIZE, 1, fp);
+  const char *signature = get_option_signature();
+  write_bytes(fp, signature, strlen(signature));
+  write_bytes(fp, text, size);
+
+  Vector *names = new_vector();
+  Vector *values = new_vector();
+  const Name *name;
+  const Name *guard;
+  for (int it = 0; (it = include_once_iterate(it, &name, &guard)) != -1; ) {
+    vec_push(names, name);
+    vec_push(values, guard);
+  }
+  write_uleb128(fp, names->len);
+  for (int i = 0; i < names->len; ++i) {
+    write_name(fp, names->data[i]);
+    write_name(fp, values->data[i]);
+  }
+
+  vec_clear(names);
+  vec_clear(values);
+  Macro *macro;
+  for (int it = 0; (it = macro_iterate(it, &name, &macro)) != -1; ) {
+    if (macro != NULL) {  // Restored `__FILE__' and `__LINE__' can be NULL.
+      vec_push(names, name);
+      vec_push(values, macro);
+    }
+  }
+  write_uleb128(fp, names->len);
+  for (int i = 0; i < names->len; ++i) {
+    write_name(fp, names->data[i]);
+    write_macro(fp, values->data[i]);
+  }
+}
+
+//
+
+typedef struct {
+  const char *p;
+  const char *end;
+  const char *filename;
+} PchReader;
+
+static void broken_pch(PchReader *reader) {
+  error("%s: broken precompiled header", reader->filename);
+}
+
+static uint64_t read_uleb128(PchReader *reader) {
+  uint64_t val = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (reader->p >= reader->end || shift >= 64)
+      broken_pch(reader);
+    unsigned char byte = *reader->p++;
+    val |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return val;
+  }
+}
+
+static const char *read_bytes(PchReader *reader, size_t size) {
+  if (size > (size_t)(reader->end - reader->p))
+    broken_pch(reader);
+  const char *p = reader->p;
+  reader->p += size;
+  return p;
+}
+
+static const Name *read_name(PchReader *reader) {
+  size_t size = read_uleb128(reader);
+  if (size == 0)
+    return NULL;
+  const char *p = read_bytes(reader, size - 1);
+  return alloc_name(p, p + (size - 1), false);
+}
+
+static Token *read_token(PchReader *reader) {
+  enum TokenKind kind = read_uleb128(reader);
+  size_t size = read_uleb128(reader);
+  const char *begin = read_bytes(reader, size);
+  Token *tok = alloc_token(kind, NULL, begin, begin + size);
+  switch (kind) {
+  case TK_IDENT:
+    tok->ident = alloc_name(begin, begin + size, false);
+    break;
+  case TK_INTLIT: case TK_CHARLIT: case TK_LONGLIT: case TK_LLONGLIT:
+  case TK_UINTLIT: case TK_UCHARLIT: case TK_ULONGLIT: case TK_ULLONGLIT:
+    tok->fixnum = read_uleb128(reader);
+    break;
+#ifndef __NO_FLONUM
+  case TK_FLOATLIT: case TK_DOUBLELIT:
+    {
+      uint64_t bits = read_uleb128(reader);
+      memcpy(&tok->flonum, &bits, sizeof(bits));
+    }
+    break;
+#endif
+  case TK_STR:
+    tok->str.size = read_uleb128(reader);
+    tok->str.buf = read_bytes(reader, tok->str.size);
+    break;
+  default: break;
+  }
+  return tok;
+}
+
+static Macro *read_macro(PchReader *reader) {
+  int params_len = (int)read_uleb128(reader) - 1;
+  Vector *params = NULL;
+  if (params_len >= 0) {
+    params = new_vector();
+    for (int i = 0; i < params_len; ++i)
+      vec_push(params, read_name(reader));
+  }
+  const Name *vaargs_ident = read_name(reader);
+
+  Vector *body = NULL;
+  size_t len = read_uleb128(reader);
+  if (len > 0) {
+    body = new_vector();
+    for (size_t i = 1; i < len; ++i)
+      vec_push(body, read_token(reader));
+  }
+  return new_macro(params, vaargs_ident, body);
+}
+
+void load_pch(const char *filename, FILE *ofp) {
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    error("Cannot open file: %s", filename);
+  // Names and tokens refer to the buffer, so it is kept.
+  SourceReader *source = read_source(fp);
+  fclose(fp);
+
+  PchReader reader = {.p = source->p, .end = source->end, .filename = filename};
+  if (reader.end - reader.p < (ptrdiff_t)MAGIC_SIZE || memcmp(reader.p, kMagic, MAGIC_SIZE) != 0)
+    error("%s: not a precompiled header", filename);
+  reader.p += MAGIC_SIZE;
+
+  const char *signature = get_option_signature();
+  size_t size = read_uleb128(&reader);
+  const char *saved = read_bytes(&reader, size);
+  if (size != strlen(signature) || memcmp(saved, signature, size) != 0)
+    error("%s: precompiled header was made with different -D or -I options", filename);
+
+  size = read_uleb128(&reader);
+  const char *text = read_bytes(&reader, size);
+
+  for (size_t n = read_uleb128(&reader); n > 0; --n) {
+    const Name *name = read_name(&reader);
+    const Name *guard = read_name(&reader);
+    if (name == NULL)
+      broken_pch(&reader);
+    register_include_once(name, guard);
+  }
+
+  // The options are the same, so the saved macros replace all the current ones,
+  // which also drops the macros `#undef'ed in the headers.
+  const Name *name;
+  for (int it = 0; (it = macro_iterate(it, &name, NULL)) != -1; )
+    macro_delete(name);
+  for (size_t n = read_uleb128(&reader); n > 0; --n) {
+    name = read_name(&reader);
+    if (name == NULL)
+      broken_pch(&reader);
+    macro_add(name, read_macro(&reader));
+  }
+  if (reader.p != reader.end)
+    broken_pch(&reader);
+
+  fwrite(text, size, 1, ofp);
+}
@@ -0,0 +1,11 @@
+// Precompiled header
+
+#pragma once
+
+#include <stddef.h>  // size_t
+#include <stdio.h>  // FILE
+
+// Saves the preprocessed text, the macros and the files included only once,
+// which are restored by `load_pch` instead of preprocessing the headers again.
+void save_pch(FILE *fp, const char *text, size_t size);
+void load_pch(const char *filename, FILE *ofp);  // Outputs the text to `ofp`.
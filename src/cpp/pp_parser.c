@@ -121,8 +121,7 @@ Token *pp_match(enum TokenKind kind) {
         }
 
         char *line = NULL;
-        size_t capa = 0;
-        ssize_t len = getline_cont(&line, &capa, pp_stream->fp, &pp_stream->lineno);
+        ssize_t len = source_getline(pp_stream->reader, &line, &pp_stream->lineno);
         if (len == -1) {
           lex_error(comment_start, "Block comment not closed");
         }
@@ -451,11 +450,9 @@ PpResult pp_expr(void) {
 static Token *match2(enum TokenKind kind) {
   while (pp_match(TK_EOF)) {
     char *line = NULL;
-    size_t capa = 0;
-    ssize_t len = getline(&line, &capa, pp_stream->fp);
+    ssize_t len = source_getline(pp_stream->reader, &line, &pp_stream->lineno);
     if (len == -1)
       return NULL;
-    ++pp_stream->lineno;
     set_source_string(line, pp_stream->filename, pp_stream->lineno);
   }
   return pp_match(kind);
@@ -6,13 +6,14 @@
 #include "lexer.h"  // TokenKind, Token
 
 typedef struct Macro Macro;
+typedef struct SourceReader SourceReader;
 typedef struct Vector Vector;
 
 typedef intptr_t PpResult;
 
 typedef struct {
   const char *filename;
-  FILE *fp;
+  SourceReader *reader;
   int lineno;
 } Stream;
 
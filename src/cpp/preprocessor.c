@@ -41,23 +41,62 @@ static const char *find_directive(const char *line) {
 
 #define INC_ORDERS  (INC_AFTER + 1)
 
+typedef struct {
+  const char *path;  // Full path.
+  Table cache;  // <char*>: key=included path, value=full path, or NULL if not exist.
+} IncludeDir;
+
 static FILE *pp_ofp;
-static Vector sys_inc_paths[INC_ORDERS];  // <const char*>
-static Vector pragma_once_files;  // <const char*>
-
-static bool registered_pragma_once(const char *filename) {
-  for (int i = 0, len = pragma_once_files.len; i < len; ++i) {
-    const char *fn = pragma_once_files.data[i];
-    if (strcmp(fn, filename) == 0)
-      return true;
-  }
-  return false;
+static Vector sys_inc_paths[INC_ORDERS];  // <IncludeDir*>
+// Files which need not be read again: key=full path,
+// value=include guard macro, or NULL for `#pragma once'.
+static Table once_table;  // <const Name*>
+// -D and -I options in order, to reject a precompiled header made with different ones.
+static StringBuffer option_signature;
+
+static const Name *once_key(const char *filename) {
+  if (!is_fullpath(filename))
+    filename = fullpath(filename);
+  return alloc_name(filename, NULL, false);
+}
+
+// Whether the file has `#pragma once', or an include guard macro which is still defined.
+static bool is_include_skippable(const char *filename) {
+  void *guard;
+  if (!table_try_get(&once_table, once_key(filename), &guard))
+    return false;
+  return guard == NULL || macro_get(guard) != NULL;
 }
 
 static void register_pragma_once(const char *filename) {
-  if (!is_fullpath(filename))
-    filename = fullpath(filename);
-  vec_push(&pragma_once_files, filename);
+  table_put(&once_table, once_key(filename), NULL);
+}
+
+static void register_include_guard(const char *filename, const Name *guard) {
+  const Name *key = once_key(filename);
+  if (!table_try_get(&once_table, key, NULL))  // `#pragma once' precedes.
+    table_put(&once_table, key, (void*)guard);
+}
+
+// Opens the file in the include directory, remembering the paths which do not exist.
+// Returns NULL with setting `*pfn` if the file is skippable.
+static FILE *open_in_include_dir(IncludeDir *incdir, const char *path, char **pfn) {
+  const Name *key = alloc_name(path, NULL, false);
+  char *fn;
+  if (!table_try_get(&incdir->cache, key, (void**)&fn)) {
+    fn = JOIN_PATHS(incdir->path, path);
+    table_put(&incdir->cache, key, fn);
+  }
+  *pfn = fn;
+  if (fn == NULL || is_include_skippable(fn))
+    return NULL;
+
+  FILE *fp = fopen(fn, "r");
+  if (fp == NULL) {
+    table_put(&incdir->cache, key, NULL);
+    *pfn = NULL;
+  }
+  return fp;
 }
 
 static FILE *search_sysinc_next(const char *dir, const char *path, char **pfn) {
@@ -69,7 +108,8 @@ static FILE *search_sysinc_next(const char *dir, const char *path, char **pfn) {
   for (ord = 0; dir && ord < INC_ORDERS; ++ord) {
     v = &sys_inc_paths[ord];
     for (idx = 0; idx < v->len; ++idx) {
-      if (!strcmp(fullpath(v->data[idx]), dir)) {
+      const IncludeDir *incdir = v->data[idx];
+      if (!strcmp(incdir->path, dir)) {
         ++idx;
         found = true;
         break;
@@ -81,10 +121,9 @@ static FILE *search_sysinc_next(const char *dir, const char *path, char **pfn) {
   for (; ord < INC_ORDERS; ++ord) {
     v = &sys_inc_paths[ord];
     for (; idx < v->len; ++idx) {
-      FILE *fp = NULL;
-      char *fn = cat_path_cwd(v->data[idx], path);
-      if (registered_pragma_once(fn) ||
-          (fp = fopen(fn, "r")) != NULL) {
+      char *fn;
+      FILE *fp = open_in_include_dir(v->data[idx], path, &fn);
+      if (fn != NULL) {
         *pfn = fn;
         return fp;
       }
@@ -174,7 +213,7 @@ static void handle_include(const char *p, Stream *stream, bool next) {
   // Search from current directory.
   if (!next && !sys) {
     fn = cat_path_cwd(dir, path);
-    if (registered_pragma_once(fn))
+    if (is_include_skippable(fn))
       return;
     fp = fopen(fn, "r");
   }
@@ -183,7 +222,7 @@ static void handle_include(const char *p, Stream *stream, bool next) {
     else fp = search_sysinc(path, &fn);
 
     if (fp == NULL) {
-      if (fn == NULL)  // Except pragma once.
+      if (fn == NULL)  // Except pragma once or include guard.
         error("Cannot open file: %s", path);
       return;
     }
@@ -200,8 +239,7 @@ static void handle_pragma(const char **pp, const char *filename) {
   const char *begin = p;
   const char *end = read_ident(p);
   if ((end - begin) == 4 && strncmp(begin, "once", 4) == 0) {
-    if (!registered_pragma_once(filename))
-      register_pragma_once(filename);
+    register_pragma_once(filename);
     *pp = end;
   } else {
     fprintf(stderr, "Warning: unhandled #pragma: %s\n", p);
@@ -251,10 +289,8 @@ static Vector *parse_macro_body(const char *p, Stream *stream) {
 
         ssize_t len = -1;
         char *line = NULL;
-        if (stream != NULL) {
-          size_t capa = 0;
-          len = getline_cont(&line, &capa, stream->fp, &stream->lineno);
-        }
+        if (stream != NULL)
+          len = source_getline(stream->reader, &line, &stream->lineno);
         if (len == -1) {
           lex_error(comment_start, "Block comment not closed");
         }
@@ -371,8 +407,7 @@ static bool handle_block_comment(const char *begin, const char **pp, Stream *str
     fprintf(pp_ofp, "%s\n", begin);
 
     char *line = NULL;
-    size_t capa = 0;
-    ssize_t len = getline_cont(&line, &capa, stream->fp, &stream->lineno);
+    ssize_t len = source_getline(stream->reader, &line, &stream->lineno);
     if (len == -1) {
       lex_error(comment_start, "Block comment not closed");
     }
@@ -407,8 +442,7 @@ static const char *find_block_comment_end(const char *comment_start, Stream *str
       return e;
 
     char *line = NULL;
-    size_t capa = 0;
-    ssize_t len = getline_cont(&line, &capa, stream->fp, &stream->lineno);
+    ssize_t len = source_getline(stream->reader, &line, &stream->lineno);
     if (len == -1) {
       lex_error(comment_start, "Block comment not closed");
       return strchr(p, '\0');
@@ -442,15 +476,17 @@ static void process_disabled_line(const char *p, Stream *stream) {
   }
 }
 
-static void process_line(const char *line, bool enable, Stream *stream) {
+// Returns whether the line has any token other than comments.
+static bool process_line(const char *line, bool enable, Stream *stream) {
   if (!enable) {
     process_disabled_line(line, stream);
-    return;
+    return false;
   }
 
   set_source_string(line, stream->filename, stream->lineno);
 
   const char *begin = get_lex_p();
+  bool has_token = false;
 
   for (;;) {
     const char *p = get_lex_p();
@@ -464,6 +500,7 @@ static void process_line(const char *line, bool enable, Stream *stream) {
 
     if (match(TK_EOF))
       break;
+    has_token = true;
 
     if (enable) {
       Token *ident = match(TK_IDENT);
@@ -498,6 +535,7 @@ static void process_line(const char *line, bool enable, Stream *stream) {
     fprintf(pp_ofp, "%s\n", begin);
   else
     fprintf(pp_ofp, "\n");
+  return has_token;
 }
 
 static bool handle_ifdef(const char **pp) {
@@ -527,6 +565,14 @@ static intptr_t cond_value(bool enable, int satisfy) {
   return (enable ? CF_ENABLE : 0) | (satisfy << CF_SATISFY_SHIFT);
 }
 
+// Include guard detection: the whole file is wrapped by `#ifndef X' ... `#endif'.
+enum GuardState {
+  GS_START,   // Nothing but comments so far.
+  GS_INSIDE,  // In the `#ifndef' block.
+  GS_AFTER,   // After the matching `#endif'.
+  GS_NONE,    // Not guarded.
+};
+
 static void define_file_macro(const char *filename, const Name *key_file) {
   size_t len = strlen(filename);
   char *buf = malloc_or_die(len + 2 + 1);
@@ -536,6 +582,7 @@ static void define_file_macro(const char *filename, const Name *key_file) {
 
 void init_preprocessor(FILE *ofp) {
   pp_ofp = ofp;
+  sb_init(&option_signature);
 
   init_lexer();
 
@@ -557,7 +604,7 @@ int preprocess(FILE *fp, const char *filename_) {
 
   Stream stream;
   stream.filename = filename_;
-  stream.fp = fp;
+  stream.reader = read_source(fp);
   Stream *old_stream = set_pp_stream(&stream);
 
   define_file_macro(stream.filename, key_file);
@@ -568,11 +615,13 @@ int preprocess(FILE *fp, const char *filename_) {
   vec_push(lineno_tokens, tok_lineno);
   macro_add(key_line, new_macro(NULL, NULL, lineno_tokens));
 
+  enum GuardState guard_state = GS_START;
+  const Name *guard = NULL;
+
   stream.lineno = 0;
   for (;;) {
     char *line = NULL;
-    size_t capa = 0;
-    ssize_t len = getline_cont(&line, &capa, fp, &stream.lineno);
+    ssize_t len = source_getline(stream.reader, &line, &stream.lineno);
     if (len == -1)
       break;
 
@@ -581,11 +630,28 @@ int preprocess(FILE *fp, const char *filename_) {
     // Find '#'
     const char *directive = find_directive(line);
     if (directive == NULL) {
-      process_line(line, enable, &stream);
+      if (process_line(line, enable, &stream) && guard_state != GS_INSIDE)
+        guard_state = GS_NONE;
       continue;
     }
     fprintf(pp_ofp, "\n");
 
+    if (guard_state != GS_INSIDE) {
+      const char *p = guard_state == GS_START ? keyword(directive, "ifndef") : NULL;
+      const char *end = p != NULL ? read_ident(p) : NULL;
+      if (end != NULL) {
+        guard = alloc_name(p, end, false);
+        guard_state = GS_INSIDE;
+      } else {
+        guard_state = GS_NONE;
+      }
+    } else if (condstack->len == 1) {  // Directly in the guard block.
+      if (keyword(directive, "endif") != NULL)
+        guard_state = GS_AFTER;
+      else if (keyword(directive, "else") != NULL || keyword(directive, "elif") != NULL)
+        guard_state = GS_NONE;
+    }
+
     const char *next;
     if ((next = keyword(directive, "ifdef")) != NULL) {
       vec_push(condstack, (void*)cond_value(enable, satisfy));
@@ -676,6 +742,9 @@ int preprocess(FILE *fp, const char *filename_) {
   if (condstack->len > 0)
     error("#if not closed");
 
+  if (guard_state == GS_AFTER)
+    register_include_guard(filename_, guard);
+
   macro_add(key_file, old_file_macro);
   macro_add(key_line, old_line_macro);
 
@@ -688,9 +757,41 @@ void define_macro(const char *arg) {
   char *p = strchr(arg, '=');
   Macro *macro = new_macro(NULL, NULL, parse_macro_body(p != NULL ? p + 1 : "1", NULL));
   macro_add(alloc_name(arg, p, true), macro);
+
+  sb_append(&option_signature, "-D", NULL);
+  sb_append(&option_signature, arg, NULL);
+  sb_append(&option_signature, "\n", NULL);
 }
 
 void add_inc_path(enum IncludeOrder order, const char *path) {
   assert(order < INC_ORDERS);
-  vec_push(&sys_inc_paths[order], strdup(path));
+  IncludeDir *incdir = malloc_or_die(sizeof(*incdir));
+  incdir->path = fullpath(path);
+  table_init(&incdir->cache);
+  vec_push(&sys_inc_paths[order], incdir);
+
+  static const char *kOptions[] = {"-I", "-isystem", "-idirafter"};
+  sb_append(&option_signature, kOptions[order], NULL);
+  sb_append(&option_signature, incdir->path, NULL);
+  sb_append(&option_signature, "\n", NULL);
+}
+
+void set_preprocess_output(FILE *ofp) {
+  pp_ofp = ofp;
+}
+
+const char *get_option_signature(void) {
+  return sb_to_string(&option_signature);
+}
+
+int include_once_iterate(int iterator, const Name **filename, const Name **guard) {
+  void *value;
+  iterator = table_iterate(&once_table, iterator, filename, &value);
+  if (iterator >= 0)
+    *guard = value;
+  return iterator;
+}
+
+void register_include_once(const Name *filename, const Name *guard) {
+  table_put(&once_table, filename, (void*)guard);
 }
@@ -2,6 +2,8 @@
 
 #include <stdio.h>  // FILE*
 
+typedef struct Name Name;
+
 enum IncludeOrder {
   INC_NORMAL,
   INC_SYSTEM,
@@ -13,3 +15,9 @@ int preprocess(FILE *fp, const char *filename);
 
 void define_macro(const char *arg);  // "FOO" or "BAR=QUX"
 void add_inc_path(enum IncludeOrder order, const char *path);
+
+// For precompiled header.
+void set_preprocess_output(FILE *ofp);
+const char *get_option_signature(void);
+int include_once_iterate(int iterator, const Name **filename, const Name **guard);  // -1 => end
+void register_include_once(const Name *filename, const Name *guard);  // guard=NULL => `#pragma once'
@@ -346,7 +346,9 @@ static bool link_files(File *files, int nfiles, const Name *entry, uintptr_t sta
     }
   }
 
+  begin_phase("ld-relocate");
   resolve_relas(files, nfiles);
+  end_phase("ld-relocate");
 
   for (int i = 0; i < nfiles; ++i) {
     File *file = &files[i];
@@ -440,9 +442,14 @@ int main(int argc, char *argv[]) {
   const char *ofn = NULL;
   const char *entry = kDefaultEntryName;
 
+  enum {
+    OPT_TIME_REPORT = 256,
+  };
   static const struct option options[] = {
     {"o", required_argument},  // Specify output filename
     {"e", required_argument},  // Entry name
+    {"ftime-report=", required_argument, OPT_TIME_REPORT},  // Append time report to the file
+    {"ftime-report", no_argument, OPT_TIME_REPORT},
     {"-version", no_argument, 'V'},
     {NULL},
   };
@@ -458,6 +465,9 @@ int main(int argc, char *argv[]) {
     case 'e':
       entry = optarg;
       break;
+    case OPT_TIME_REPORT:
+      enable_time_report(optarg);
+      break;
     default:
       fprintf(stderr, "Warning: unknown option: %s\n", argv[optind - 1]);
       break;
@@ -473,6 +483,7 @@ int main(int argc, char *argv[]) {
 
   section_aligns[SEC_DATA] = DATA_ALIGN;
 
+  begin_phase("ld-load");
   int nfiles = 0;
   File *files = malloc_or_die(sizeof(*files) * (argc - iarg));
   for (int i = iarg; i < argc; ++i) {
@@ -504,11 +515,17 @@ int main(int argc, char *argv[]) {
     ++nfiles;
   }
 
+  end_phase("ld-load");
+
   const Name *entry_name = alloc_name(entry, NULL, false);
+  begin_phase("ld-link");
   bool result = link_files(files, nfiles, entry_name, LOAD_ADDRESS);
+  end_phase("ld-link");
   if (result) {
+    begin_phase("ld-output");
     fix_section_size(LOAD_ADDRESS);
     result = output_exe(ofn, files, nfiles, entry_name);
+    end_phase("ld-output");
   }
 
   for (int i = 0; i < nfiles; ++i) {
@@ -522,5 +539,7 @@ int main(int argc, char *argv[]) {
     default: assert(false); break;
     }
   }
+
+  output_time_report();
   return result ? 0 : 1;
 }
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stdlib.h>  // malloc
 #include <string.h>  // strcmp
+#include <time.h>  // clock_gettime
 
 #include "../version.h"
 #include "table.h"
@@ -58,7 +59,10 @@ int most_significant_bit(size_t x) {
   }
 }
 
+static size_t alloc_bytes;  // Total size requested through malloc_or_die and realloc_or_die.
+
 void *malloc_or_die(size_t size) {
+  alloc_bytes += size;
   void *p = malloc(size);
   if (p == NULL) {
     fprintf(stderr, "memory overflow\n");
@@ -68,6 +72,7 @@ void *malloc_or_die(size_t size) {
 }
 
 void *realloc_or_die(void *ptr, size_t size) {
+  alloc_bytes += size;
   void *p = realloc(ptr, size);
   if (p == NULL) {
     fprintf(stderr, "memory overflow\n");
@@ -94,41 +99,53 @@ ssize_t getline_chomp(char **lineptr, size_t *n, FILE *stream) {
   return len;
 }
 
-static ssize_t getline_cat(char **lineptr, size_t *n, FILE *stream, size_t curlen) {
-  char *nextline = NULL;
-  size_t capa = 0;
-  ssize_t len = getline_chomp(&nextline, &capa, stream);
-  if (len == -1)
-    return -1;
-  if (len > 0) {
-    char *oldline = *lineptr;
-    char *reallocated = realloc(oldline, curlen + len + 1);
-    if (reallocated == NULL)
-      return -1;
-
-    memcpy(reallocated + curlen, nextline, len + 1);
-    *lineptr = reallocated;
-    *n = curlen + len;  // '\0' is not included.
-    free(nextline);
+SourceReader *read_source(FILE *fp) {
+  size_t capa = 4096, size = 0;
+  char *buf = malloc_or_die(capa);
+  for (;;) {
+    size += fread(buf + size, 1, capa - size, fp);
+    if (size < capa)
+      break;
+    capa <<= 1;
+    buf = realloc_or_die(buf, capa);
   }
-  return curlen + len;
+  // Always room for the terminator of the last line: size < capa.
+
+  SourceReader *reader = malloc_or_die(sizeof(*reader));
+  reader->p = buf;
+  reader->end = buf + size;
+  return reader;
 }
 
-ssize_t getline_cont(char **lineptr, size_t *capa, FILE *stream, int *plineno) {
+// Returns the next line, terminated in place instead of the newline.
+// Lines continued with backslash are joined by moving the following part forward.
+ssize_t source_getline(SourceReader *reader, char **pline, int *plineno) {
+  char *p = reader->p, *end = reader->end;
+  if (p >= end)
+    return -1;
+
+  char *line = p, *q = p;  // q: Write position, behind p after joining.
   int lineno = *plineno;
-  ssize_t len = getline_chomp(lineptr, capa, stream);
-  if (len != -1) {
-    // Continue line.
-    while (++lineno, len > 0 && (*lineptr)[len - 1] == '\\') {
-      (*lineptr)[--len] = '\0';
-      ssize_t nextlen = getline_cat(lineptr, capa, stream, len);
-      if (nextlen == -1)
-        break;
-      len = nextlen;
+  for (;;) {
+    ++lineno;
+    char *nl = memchr(p, '\n', end - p);
+    char *e = nl != NULL ? nl : end;
+    if (q != p)
+      memmove(q, p, e - p);
+    q += e - p;
+    p = nl != NULL ? nl + 1 : end;
+    if (q > line && q[-1] == '\\') {  // Continue line.
+      --q;
+      if (p < end)
+        continue;
     }
+    break;
   }
+  *q = '\0';
+  reader->p = p;
+  *pline = line;
   *plineno = lineno;
-  return len;
+  return q - line;
 }
 
 bool is_fullpath(const char *filename) {
@@ -552,3 +569,112 @@ int optparse(int argc, char *const argv[], const struct option *opts) {
   return '?';
 #undef ERROR
 }
+
+// Time report
+
+#define MAX_PHASES  (16)
+
+typedef struct {
+  const char *name;
+  int count;
+  long usec;
+  size_t bytes;
+  long start_usec;
+  size_t start_bytes;
+} Phase;
+
+static bool time_report_enabled;
+static const char *time_report_fn;
+static Phase phases[MAX_PHASES];
+static int phase_count;
+
+static long current_usec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static Phase *get_phase(const char *name) {
+  for (int i = 0; i < phase_count; ++i) {
+    if (strcmp(phases[i].name, name) == 0)
+      return &phases[i];
+  }
+  if (phase_count >= MAX_PHASES)
+    return NULL;
+  Phase *phase = &phases[phase_count++];
+  phase->name = name;
+  return phase;
+}
+
+void enable_time_report(const char *filename) {
+  time_report_enabled = true;
+  time_report_fn = filename;
+}
+
+void begin_phase(const char *name) {
+  Phase *phase;
+  if (!time_report_enabled || (phase = get_phase(name)) == NULL)
+    return;
+  phase->start_usec = current_usec();
+  phase->start_bytes = alloc_bytes;
+}
+
+void end_phase(const char *name) {
+  Phase *phase;
+  if (!time_report_enabled || (phase = get_phase(name)) == NULL)
+    return;
+  phase->usec += current_usec() - phase->start_usec;
+  phase->bytes += alloc_bytes - phase->start_bytes;
+  ++phase->count;
+}
+
+void load_time_report(const char *filename) {
+  FILE *fp = fopen(filename, "r");
+  if (fp == NULL)
+    return;
+  char *line = NULL;
+  size_t capa = 0;
+  while (getline_chomp(&line, &capa, fp) != -1) {
+    // "name count usec bytes"
+    char *p = strchr(line, ' ');
+    if (p == NULL)
+      continue;
+    Phase *phase = get_phase(strndup(line, p - line));
+    if (phase == NULL)
+      continue;
+    phase->count += strtol(p, &p, 10);
+    phase->usec += strtol(p, &p, 10);
+    phase->bytes += strtoul(p, &p, 10);
+  }
+  free(line);
+  fclose(fp);
+  time_report_enabled = true;
+  time_report_fn = NULL;
+}
+
+void output_time_report(void) {
+  if (!time_report_enabled || phase_count == 0)
+    return;
+
+  if (time_report_fn != NULL) {
+    // Appended, to be summed up by the driver.
+    FILE *fp = fopen(time_report_fn, "a");
+    if (fp == NULL)
+      return;
+    for (int i = 0; i < phase_count; ++i) {
+      Phase *phase = &phases[i];
+      fprintf(fp, "%s %d %ld %lu\n", phase->name, phase->count, phase->usec,
+              (unsigned long)phase->bytes);
+    }
+    fclose(fp);
+    return;
+  }
+
+  fprintf(stderr, "%-12s %8s %12s %12s\n", "phase", "count", "wall(ms)", "alloc(KB)");
+  for (int i = 0; i < phase_count; ++i) {
+    Phase *phase = &phases[i];
+    fprintf(stderr, "%-12s %8d %8ld.%03d %12lu\n", phase->name, phase->count,
+            phase->usec / 1000, (int)(phase->usec % 1000),
+            (unsigned long)(phase->bytes / 1024));
+  }
+}
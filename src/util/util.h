@@ -27,7 +27,6 @@ void *malloc_or_die(size_t size);
 void *realloc_or_die(void *ptr, size_t size);
 const Name *alloc_label(void);
 ssize_t getline_chomp(char **lineptr, size_t *n, FILE *stream);
-ssize_t getline_cont(char **lineptr, size_t *n, FILE *stream, int *plineno);
 bool is_fullpath(const char *filename);
 char *join_paths(const char *paths[]);
 #define JOIN_PATHS(...)  join_paths((const char*[]){__VA_ARGS__, NULL})
@@ -46,8 +45,27 @@ bool is_im32(intptr_t x);
 const char *skip_whitespaces(const char *s);
 int64_t wrap_value(int64_t value, int size, bool is_unsigned);
 
+// Time report (-ftime-report)
+
+// Output is printed to stderr if `filename` is NULL, otherwise appended to the file.
+void enable_time_report(const char *filename);
+void begin_phase(const char *name);
+void end_phase(const char *name);
+void load_time_report(const char *filename);  // Sum up the reports in the file.
+void output_time_report(void);
+
 // Container
 
+// Source text which is read at once, and handed out line by line
+// as slices in the buffer, without copying.
+typedef struct SourceReader {
+  char *p;  // Start of the next line.
+  char *end;
+} SourceReader;
+
+SourceReader *read_source(FILE *fp);
+ssize_t source_getline(SourceReader *reader, char **pline, int *plineno);
+
 typedef struct Buffer {
   unsigned char *data;
   size_t capa;
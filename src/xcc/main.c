@@ -1,6 +1,7 @@
 #include "../config.h"
 
 #include <assert.h>
+#include <ctype.h>  // isdigit
 #include <fcntl.h>  // open
 #include <libgen.h>  // dirname
 #include <signal.h>
@@ -16,6 +17,21 @@
 
 #include "util.h"
 
+#if !defined(AS_USE_CC)
+#include "as_util.h"
+#include "codegen.h"
+#include "emit_code.h"
+#include "emit_util.h"
+#include "lexer.h"
+#include "parser.h"
+#include "pch.h"
+#include "preprocessor.h"
+#include "var.h"
+
+// Run preprocessor, compiler and assembler in the driver process.
+#define INTEGRATED_PIPELINE
+#endif
+
 static pid_t fork1(void) {
   pid_t pid = fork();
   if (pid < 0)
@@ -142,6 +158,11 @@ static void usage(FILE *fp) {
       "  -c                  Output object file\n"
       "  -S                  Output assembly code\n"
       "  -E                  Output preprocess result\n"
+      "  -emit-pch <file>    Save preprocessed headers as precompiled header\n"
+      "  -include-pch <file> Include precompiled header\n"
+      "  -j <number>         Compile sources in parallel\n"
+      "  -fno-integrated-as  Run cpp, cc1 and as as separate processes\n"
+      "  -ftime-report       Show time and allocation of each phase\n"
   );
 }
 
@@ -152,24 +173,46 @@ enum OutType {
   OutExecutable,
 };
 
-static int compile_csource(const char *source_fn, enum OutType out_type, const char *ofn, int ofd,
-                           Vector *cpp_cmd, Vector *cc1_cmd, Vector *as_cmd, Vector *ld_cmd) {
-  const char *objfn = NULL;
-  int obj_fd = -1;
-  if (out_type > OutAssembly) {
-    if (ofn != NULL && out_type < OutExecutable) {
-      objfn = ofn;
-    } else {
-      char template[] = "/tmp/xcc-XXXXXX.o";
-      obj_fd = mkstemps(template, 2);
-      if (obj_fd == -1) {
-        perror("Failed to open output file");
-        exit(1);
-      }
-      objfn = strdup(template);
-    }
+enum SourceType {
+  UnknownSource,
+  Assembly,
+  Clanguage,
+  ObjectFile,
+  ArchiveFile,
+};
+
+typedef struct {
+  Vector *cpp_cmd;
+  Vector *cc1_cmd;
+  Vector *as_cmd;
+  bool integrated;
+} Commands;
+
+static const char *get_object_filename(const char *source_fn, enum SourceType st,
+                                       enum OutType out_type, const char *ofn) {
+  if (ofn != NULL && out_type < OutExecutable)
+    return ofn;
+
+  if (st == Assembly) {
+    size_t len = strlen(source_fn);
+    char *p = malloc_or_die(len + 3);
+    memcpy(p, source_fn, len);
+    strcpy(p + len, ".o");
+    return p;
   }
 
+  char template[] = "/tmp/xcc-XXXXXX.o";
+  int obj_fd = mkstemps(template, 2);
+  if (obj_fd == -1) {
+    perror("Failed to open output file");
+    exit(1);
+  }
+  close(obj_fd);
+  return strdup(template);
+}
+
+static int compile_csource(const char *source_fn, enum OutType out_type, const char *objfn, int ofd,
+                           Vector *cpp_cmd, Vector *cc1_cmd, Vector *as_cmd) {
   int as_fd[2];
   pid_t as_pid = -1;
 
@@ -181,13 +224,10 @@ static int compile_csource(const char *source_fn, enum OutType out_type, const c
 
   int res = compile(source_fn, cpp_cmd, out_type == OutPreprocess ? NULL : cc1_cmd, ofd);
 
-  if (out_type >= OutExecutable)
-    vec_push(ld_cmd, objfn);
-
   if (res != 0 && as_pid != -1) {
 #if !defined(__XV6)
     kill(as_pid, SIGKILL);
-    remove(ofn);
+    remove(objfn);
 #endif
   }
   if (as_pid != -1) {
@@ -196,27 +236,13 @@ static int compile_csource(const char *source_fn, enum OutType out_type, const c
     as_pid = -1;
     res |= wait_process(as_pid);
   }
-  if (obj_fd != -1) {
-    close(obj_fd);
-  }
   return res;
 }
 
-static int compile_asm(const char *source_fn, enum OutType out_type, const char *ofn, int ofd,
-                       Vector *as_cmd, Vector *ld_cmd) {
-  const char *objfn = NULL;
-  if (out_type > OutAssembly) {
-    if (ofn != NULL && out_type < OutExecutable) {
-      objfn = ofn;
-    } else {
-      size_t len = strlen(source_fn);
-      char *p = malloc_or_die(len + 3);
-      memcpy(p, source_fn, len);
-      strcpy(p + len, ".o");
-      objfn = p;
-    }
+static int compile_asm(const char *source_fn, enum OutType out_type, const char *objfn, int ofd,
+                       Vector *as_cmd) {
+  if (out_type > OutAssembly)
     as_cmd->data[as_cmd->len - 2] = (void*)objfn;
-  }
 
   vec_pop(as_cmd);
   vec_push(as_cmd, source_fn);
@@ -229,11 +255,267 @@ static int compile_asm(const char *source_fn, enum OutType out_type, const char
   vec_pop(as_cmd);
   vec_pop(as_cmd);
   vec_push(as_cmd, NULL);
+  return res;
+}
+
+#if defined(INTEGRATED_PIPELINE)
+extern void install_builtins(void);
+
+// Options are taken from the command line for cpp.
+static void init_integrated_preprocessor(FILE *ofp, const Vector *cpp_cmd) {
+  init_preprocessor(ofp);
+
+  define_macro("__XCC");
+#if defined(__XV6)
+  define_macro("__XV6");
+#elif defined(__linux__)
+  define_macro("__linux__");
+#elif defined(__APPLE__)
+  define_macro("__APPLE__");
+#endif
+#if defined(__NO_FLONUM)
+  define_macro("__NO_FLONUM");
+#endif
 
-  if (out_type >= OutExecutable)
-    vec_push(ld_cmd, objfn);
+  const char *include_pch = NULL;
+  for (int i = 1; i < cpp_cmd->len && cpp_cmd->data[i] != NULL; ++i) {
+    const char *arg = cpp_cmd->data[i];
+    if (strncmp(arg, "-D", 2) == 0)
+      define_macro(arg[2] != '\0' ? &arg[2] : cpp_cmd->data[++i]);
+    else if (strcmp(arg, "-I") == 0)
+      add_inc_path(INC_NORMAL, cpp_cmd->data[++i]);
+    else if (strcmp(arg, "-isystem") == 0)
+      add_inc_path(INC_SYSTEM, cpp_cmd->data[++i]);
+    else if (strcmp(arg, "-idirafter") == 0)
+      add_inc_path(INC_AFTER, cpp_cmd->data[++i]);
+    else if (strcmp(arg, "-include-pch") == 0)
+      include_pch = cpp_cmd->data[++i];
+  }
+  // Loaded after all the options, as cpp does.
+  if (include_pch != NULL)
+    load_pch(include_pch, ofp);
+}
+
+// Options are taken from the command line for cc1.
+static void init_integrated_compiler(const Vector *cc1_cmd) {
+  init_lexer();
+  init_global();
+  install_builtins();
+
+  for (int i = 1; i < cc1_cmd->len && cc1_cmd->data[i] != NULL; ++i) {
+    const char *arg = cc1_cmd->data[i];
+    if (strcmp(arg, "-W") == 0) {
+      if (strcmp(cc1_cmd->data[++i], "error") == 0)
+        error_warning = true;
+    } else if (strcmp(arg, "-O") == 0) {
+      const char *value = cc1_cmd->data[++i];
+      optimize_level = isdigit(*value) ? atoi(value) : 1;  // -Os, -Og, etc.
+    }
+  }
+}
+
+static const AsmSink kAssemblerSink = {
+  .label = assemble_label,
+  .op = assemble_op,
+};
+
+// Preprocessed source is kept in a temporary file,
+// and compiled code is passed to the assembler by each instruction, not by lines.
+// Global states are not cleared, so this must be called once in a process.
+static int compile_integrated(const char *src, enum SourceType st, enum OutType out_type,
+                              const char *objfn, int ofd, const Commands *cmds) {
+  const char *filename = src != NULL ? src : "*stdin*";
+  FILE *ifp = stdin;
+  if (src != NULL) {
+    ifp = fopen(src, "r");
+    if (ifp == NULL)
+      error("Cannot open file: %s\n", src);
+  }
+
+  FILE *ofp = stdout;
+  if (out_type <= OutAssembly && ofd != STDOUT_FILENO) {
+    ofp = fdopen(ofd, "w");
+    if (ofp == NULL)
+      error("Cannot open output file");
+  }
+
+  if (st == Assembly) {
+    init_assembler();
+    assemble_file(ifp, filename);
+    return output_object(objfn);
+  }
+
+  FILE *ppout = out_type == OutPreprocess ? ofp : tmpfile();
+  if (ppout == NULL)
+    error("Cannot open temporary file");
+  init_integrated_preprocessor(ppout, cmds->cpp_cmd);
+  if (src != NULL)
+    fprintf(ppout, "# 1 \"%s\" 1\n", src);
+  begin_phase("preprocess");
+  preprocess(ifp, filename);
+  end_phase("preprocess");
+  if (out_type == OutPreprocess) {
+    fflush(ppout);
+    return 0;
+  }
+  if (fseek(ppout, 0, SEEK_SET) != 0)
+    error("fseek failed");
+
+  init_integrated_compiler(cmds->cc1_cmd);
+  if (out_type == OutAssembly) {
+    init_emit(ofp);
+  } else {
+    init_assembler();
+    init_emit_sink(&kAssemblerSink);
+  }
+
+  toplevel = new_vector();
+  set_source_file(ppout, filename);
+  begin_phase("parse");
+  parse(toplevel);
+  end_phase("parse");
+  if (compile_error_count != 0)
+    return 1;
+  if (error_warning && compile_warning_count != 0)
+    return 2;
+
+  begin_phase("gen");
+  gen(toplevel);
+  end_phase("gen");
+  begin_phase("emit");
+  emit_code(toplevel);
+  end_phase("emit");
+  if (out_type == OutAssembly) {
+    fflush(ofp);
+    return 0;
+  }
+
+  int res = output_object(objfn);
+  if (res != 0)
+    remove(objfn);
   return res;
 }
+#endif
+
+static int compile_source(const char *src, enum SourceType st, enum OutType out_type,
+                          const char *outfn, const char *objfn, int *pofd, const Commands *cmds) {
+#if !defined(__XCC) && !defined(__XV6)
+  if (out_type <= OutAssembly && outfn != NULL && strcmp(outfn, "-") != 0) {
+    close(STDOUT_FILENO);
+    *pofd = open(outfn, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (*pofd == -1) {
+      perror("Failed to open output file");
+      exit(1);
+    }
+  }
+#else
+  UNUSED(outfn);
+#endif
+
+#if defined(INTEGRATED_PIPELINE)
+  if (cmds->integrated && (st == Clanguage || out_type > OutAssembly))
+    return compile_integrated(src, st, out_type, objfn, *pofd, cmds);
+#endif
+  if (st == Clanguage)
+    return compile_csource(src, out_type, objfn, *pofd, cmds->cpp_cmd, cmds->cc1_cmd, cmds->as_cmd);
+  return compile_asm(src, out_type, objfn, *pofd, cmds->as_cmd);
+}
+
+// Integrated pipeline leaves global states, so each source is compiled in its own process.
+static int compile_source_in_child(const char *src, enum SourceType st, enum OutType out_type,
+                                   const char *outfn, const char *objfn, int ofd,
+                                   const Commands *cmds) {
+  pid_t pid = fork1();
+  if (pid == 0) {
+    int res = compile_source(src, st, out_type, outfn, objfn, &ofd, cmds);
+    output_time_report();
+    exit(res == 0 ? 0 : 1);
+  }
+  return wait_process(pid);
+}
+
+// Parallel compilation
+
+typedef struct {
+  pid_t pid;
+  int err_fd;  // Diagnostics are kept until preceding sources are reported.
+  int result;
+  bool done;
+} Job;
+
+typedef struct {
+  Vector *jobs;  // <Job*>
+  int running;
+  int reported;
+  int result;
+} JobQueue;
+
+static void report_jobs(JobQueue *queue) {
+  for (; queue->reported < queue->jobs->len; ++queue->reported) {
+    Job *job = queue->jobs->data[queue->reported];
+    if (!job->done)
+      break;
+
+    if (lseek(job->err_fd, 0, SEEK_SET) == 0) {
+      char buf[4096];
+      ssize_t n;
+      while ((n = read(job->err_fd, buf, sizeof(buf))) > 0) {
+        if (write(STDERR_FILENO, buf, n) != n)
+          break;
+      }
+    }
+    close(job->err_fd);
+    if (job->result != 0)
+      queue->result = 1;
+  }
+}
+
+static void wait_job(JobQueue *queue) {
+  int r;
+  pid_t pid = waitpid(-1, &r, 0);
+  if (pid < 0)
+    error("wait failed");
+  for (int i = 0; i < queue->jobs->len; ++i) {
+    Job *job = queue->jobs->data[i];
+    if (job->pid == pid && !job->done) {
+      job->done = true;
+      job->result = r;
+      --queue->running;
+      break;
+    }
+  }
+  report_jobs(queue);
+}
+
+static void start_job(JobQueue *queue, const char *src, enum SourceType st, enum OutType out_type,
+                      const char *outfn, const char *objfn, int ofd, const Commands *cmds) {
+  char template[] = "/tmp/xcc-XXXXXX";
+  int err_fd = mkstemp(template);
+  if (err_fd == -1) {
+    perror("Failed to open temporary file");
+    exit(1);
+  }
+  unlink(template);
+
+  pid_t pid = fork1();
+  if (pid == 0) {
+    close(STDERR_FILENO);
+    if (dup(err_fd) == -1)
+      exit(1);
+    close(err_fd);
+    int res = compile_source(src, st, out_type, outfn, objfn, &ofd, cmds);
+    output_time_report();
+    exit(res == 0 ? 0 : 1);
+  }
+
+  Job *job = malloc_or_die(sizeof(*job));
+  job->pid = pid;
+  job->err_fd = err_fd;
+  job->result = 0;
+  job->done = false;
+  vec_push(queue->jobs, job);
+  ++queue->running;
+}
 
 int main(int argc, char *argv[]) {
   const char *root = dirname(strdup(argv[0]));
@@ -248,6 +530,12 @@ int main(int argc, char *argv[]) {
 #endif
   bool nodefaultlibs = false, nostdlib = false, nostdinc = false;
   bool use_ld = false;
+  bool time_report = false;
+#if defined(INTEGRATED_PIPELINE)
+  bool integrated = true;
+#else
+  bool integrated = false;
+#endif
 
   Vector *cpp_cmd = new_vector();
   vec_push(cpp_cmd, cpp_path);
@@ -271,16 +559,10 @@ int main(int argc, char *argv[]) {
 
   enum OutType out_type = OutExecutable;
 
-  enum SourceType {
-    UnknownSource,
-    Assembly,
-    Clanguage,
-    ObjectFile,
-    ArchiveFile,
-  };
   enum SourceType src_type = UnknownSource;
 
   const char *ofn = NULL;
+  int njobs = 1;
 
   enum {
     OPT_HELP = 128,
@@ -296,6 +578,8 @@ int main(int argc, char *argv[]) {
     OPT_PEDANTIC,
     OPT_MMD,
     OPT_NO_PIE,
+    OPT_EMIT_PCH,
+    OPT_INCLUDE_PCH,
   };
 
   static const struct option options[] = {
@@ -306,8 +590,12 @@ int main(int argc, char *argv[]) {
     {"isystem", required_argument, OPT_ISYSTEM},  // Add system include path
     {"idirafter", required_argument, OPT_IDIRAFTER},  // Add include path (after)
     {"D", required_argument},  // Define macro
+    {"emit-pch", required_argument, OPT_EMIT_PCH},  // Save precompiled header
+    {"include-pch", required_argument, OPT_INCLUDE_PCH},  // Load precompiled header
     {"o", required_argument},  // Specify output filename
     {"x", required_argument},  // Specify code type
+    {"O", required_argument},  // Optimization level
+    {"j", required_argument},  // Number of parallel jobs
     {"nodefaultlibs", no_argument, OPT_NODEFAULTLIBS},
     {"nostdlib", no_argument, OPT_NOSTDLIB},
     {"nostdinc", no_argument, OPT_NOSTDINC},
@@ -316,7 +604,6 @@ int main(int argc, char *argv[]) {
 
     // Suppress warnings
     {"W", required_argument},
-    {"O", required_argument},
     {"g", required_argument},  // Debug info
     {"f", required_argument},
     {"ansi", no_argument, OPT_ANSI},
@@ -354,6 +641,19 @@ int main(int argc, char *argv[]) {
       vec_push(cpp_cmd, "-D");
       vec_push(cpp_cmd, optarg);
       break;
+    case OPT_EMIT_PCH:
+      // Only preprocessed, by cpp which writes the file.
+      vec_push(cpp_cmd, "-emit-pch");
+      vec_push(cpp_cmd, optarg);
+      out_type = OutPreprocess;
+      if (src_type == UnknownSource)
+        src_type = Clanguage;
+      integrated = false;
+      break;
+    case OPT_INCLUDE_PCH:
+      vec_push(cpp_cmd, "-include-pch");
+      vec_push(cpp_cmd, optarg);
+      break;
     case 'o':
       ofn = optarg;
       break;
@@ -382,6 +682,15 @@ int main(int argc, char *argv[]) {
       vec_push(cc1_cmd, "-W");
       vec_push(cc1_cmd, optarg);
       break;
+    case 'O':
+      vec_push(cc1_cmd, "-O");
+      vec_push(cc1_cmd, optarg);
+      break;
+    case 'j':
+      njobs = atoi(optarg);
+      if (njobs <= 0)
+        error("invalid number of jobs: %s", optarg);
+      break;
     case OPT_NODEFAULTLIBS:
       nodefaultlibs = true;
       break;
@@ -392,7 +701,11 @@ int main(int argc, char *argv[]) {
       nostdinc = true;
       break;
     case 'f':
-      if (strncmp(optarg, "use-ld", 6) == 0) {
+      if (strcmp(optarg, "no-integrated-as") == 0) {
+        integrated = false;
+      } else if (strcmp(optarg, "time-report") == 0) {
+        time_report = true;
+      } else if (strncmp(optarg, "use-ld", 6) == 0) {
         if (optarg[6] == '=') {
           ld_path = &optarg[7];
         } else if (optarg[6] == '\0' && optind < argc) {
@@ -414,7 +727,6 @@ int main(int argc, char *argv[]) {
       }
       break;
 
-    case 'O':
     case 'g':
     case OPT_ANSI:
     case OPT_STD:
@@ -441,6 +753,28 @@ int main(int argc, char *argv[]) {
     vec_push(cpp_cmd, JOIN_PATHS(root, "include"));
   }
 
+  // Each process appends its report to the file, and they are summed up at last.
+  char time_report_fn[] = "/tmp/xcc-time-XXXXXX";
+  char *time_report_opt = NULL;
+  if (time_report) {
+    int fd = mkstemp(time_report_fn);
+    if (fd == -1) {
+      perror("Failed to open temporary file");
+      exit(1);
+    }
+    close(fd);
+    enable_time_report(time_report_fn);
+
+    size_t size = sizeof("-ftime-report=") + strlen(time_report_fn);
+    time_report_opt = malloc_or_die(size);
+    snprintf(time_report_opt, size, "-ftime-report=%s", time_report_fn);
+    vec_push(cpp_cmd, time_report_opt);
+    vec_push(cc1_cmd, time_report_opt);
+#if !defined(AS_USE_CC)
+    vec_push(as_cmd, time_report_opt);
+#endif
+  }
+
   vec_push(cpp_cmd, NULL);  // Buffer for src.
   vec_push(cpp_cmd, NULL);  // Terminator.
   vec_push(cc1_cmd, NULL);  // Buffer for label prefix.
@@ -464,6 +798,10 @@ int main(int argc, char *argv[]) {
   } else {
     vec_push(ld_cmd, "-o");
     vec_push(ld_cmd, ofn != NULL ? ofn : "a.out");
+#if !defined(AS_USE_CC)
+    if (time_report_opt != NULL)
+      vec_push(ld_cmd, time_report_opt);
+#endif
   }
 
   int ofd = STDOUT_FILENO;
@@ -484,6 +822,14 @@ int main(int argc, char *argv[]) {
 #endif
   }
 
+  Commands cmds = {
+    .cpp_cmd = cpp_cmd,
+    .cc1_cmd = cc1_cmd,
+    .as_cmd = as_cmd,
+    .integrated = integrated,
+  };
+  JobQueue queue = {.jobs = new_vector(), .running = 0, .reported = 0, .result = 0};
+
   int res = 0;
   for (int i = 0; i < sources->len; ++i) {
     char *src = sources->data[i];
@@ -504,23 +850,13 @@ int main(int argc, char *argv[]) {
       }
     }
 
-#if !defined(__XCC) && !defined(__XV6)
-    if (out_type <= OutAssembly && outfn != NULL && strcmp(outfn, "-") != 0) {
-      close(STDOUT_FILENO);
-      ofd = open(outfn, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-      if (ofd == -1) {
-        perror("Failed to open output file");
-        exit(1);
-      }
-    }
-#endif
-
     enum SourceType st = UnknownSource;
     if (src == NULL) {
       st = src_type;
     } else {
       char *ext = get_ext(src);
       if      (strcasecmp(ext, "c") == 0)  st = Clanguage;
+      else if (strcasecmp(ext, "h") == 0)  st = Clanguage;  // For -E or -emit-pch.
       else if (strcasecmp(ext, "s") == 0)  st = Assembly;
       else if (strcasecmp(ext, "o") == 0)  st = ObjectFile;
       else if (strcasecmp(ext, "a") == 0)  st = ArchiveFile;
@@ -532,10 +868,33 @@ int main(int argc, char *argv[]) {
       res = -1;
       break;
     case Clanguage:
-      res = compile_csource(src, out_type, outfn, ofd, cpp_cmd, cc1_cmd, as_cmd, ld_cmd);
-      break;
     case Assembly:
-      res = compile_asm(src, out_type, outfn, ofd, as_cmd, ld_cmd);
+      {
+        const char *objfn = NULL;
+        if (out_type > OutAssembly) {
+          objfn = get_object_filename(src, st, out_type, outfn);
+          if (out_type >= OutExecutable)
+            vec_push(ld_cmd, objfn);
+        }
+
+        // Output to stdout or input from stdin is processed in order.
+        if (njobs > 1 && out_type > OutAssembly && src != NULL) {
+          while (queue.running >= njobs)
+            wait_job(&queue);
+          if (queue.result != 0)
+            break;
+          start_job(&queue, src, st, out_type, outfn, objfn, ofd, &cmds);
+        } else {
+          while (queue.running > 0)
+            wait_job(&queue);
+          if (queue.result != 0)
+            break;
+          if (integrated)
+            res = compile_source_in_child(src, st, out_type, outfn, objfn, ofd, &cmds);
+          else
+            res = compile_source(src, st, out_type, outfn, objfn, &ofd, &cmds);
+        }
+      }
       break;
     case ObjectFile:
     case ArchiveFile:
@@ -543,9 +902,12 @@ int main(int argc, char *argv[]) {
         vec_push(ld_cmd, src);
       break;
     }
-    if (res != 0)
+    if (res != 0 || queue.result != 0)
       break;
   }
+  while (queue.running > 0)
+    wait_job(&queue);
+  res |= queue.result;
 
   if (res == 0 && out_type >= OutExecutable) {
     vec_push(ld_cmd, NULL);
@@ -553,5 +915,11 @@ int main(int argc, char *argv[]) {
     waitpid(ld_pid, &res, 0);
   }
 
+  if (time_report) {
+    load_time_report(time_report_fn);
+    remove(time_report_fn);
+    output_time_report();
+  }
+
   return res == 0 ? 0 : 1;
 }
@@ -0,0 +1,198 @@
+#!/bin/bash
+
+# Benchmark suite: compile throughput of each tool, and run time of
+# programs compiled by xcc.
+#
+# Results are printed as tab separated lines:
+#   <kind>  <name>  <value>  <unit>
+# and also written to $BENCH_OUT if it is set.
+
+ROOT=${ROOT:-..}
+PREFIX=${PREFIX:-}
+XCC=${XCC:-$ROOT/${PREFIX}xcc}
+CPP=${CPP:-$ROOT/${PREFIX}cpp}
+CC1=${CC1:-$ROOT/${PREFIX}cc1}
+AS=${AS:-$ROOT/${PREFIX}as}
+LD=${LD:-$ROOT/${PREFIX}ld}
+BENCH_CFLAGS=${BENCH_CFLAGS:--O1}
+BENCH_FUNCS=${BENCH_FUNCS:-4000}  # Function count in the generated corpus.
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+now_ns() {
+  date +%s%N
+}
+
+report() {
+  printf '%s\t%s\t%s\t%s\n' "$1" "$2" "$3" "$4" | tee -a "${BENCH_OUT:-/dev/null}"
+}
+
+# Lines per second from a line count and elapsed nanoseconds.
+lines_per_sec() {
+  awk -v lines="$1" -v ns="$2" 'BEGIN { printf "%.0f", (ns > 0 ? lines * 1e9 / ns : 0) }'
+}
+
+fail() {
+  echo "bench: $*" 1>&2
+  exit 1
+}
+
+# Target architecture, detected in the same way as the top Makefile.
+if [[ -z "$ARCHTYPE" ]]; then
+  case "$(uname -m)" in
+  arm64|aarch64)  ARCHTYPE=aarch64 ;;
+  *)              ARCHTYPE=x64 ;;
+  esac
+fi
+case "$ARCHTYPE" in
+x64)      ARCH_MACRO=__x86_64__ ;;
+aarch64)  ARCH_MACRO=__aarch64__ ;;
+*)        fail "unknown ARCHTYPE: $ARCHTYPE" ;;
+esac
+
+# Same macros as the xcc driver defines.
+CPP_FLAGS=(-D__LP64__ -D"$ARCH_MACRO" -idirafter "$ROOT/include")
+if [[ "$(uname)" == Darwin ]]; then
+  CPP_FLAGS+=(-D__APPLE__)
+fi
+# Same as CFLAGS in the top Makefile, to preprocess xcc's own sources.
+SRC_FLAGS=(-D_DEFAULT_SOURCE -DSELF_HOSTING -I"$ROOT/src/cc" -I"$ROOT/src/cpp" -I"$ROOT/src/as"
+           -I"$ROOT/src/util" -I"$ROOT/src/cc/arch/$ARCHTYPE")
+
+# Generate a program with `n` usual sized functions, and a few large ones
+# which grow with `n`, like generated parsers and interpreters have:
+# a dispatcher with a case for each function, and a checker with a branch
+# for each and a loop for every 8 of them.
+gen_corpus() {
+  local n="$1"
+  echo '#include <stdio.h>'
+  echo '#include <stdlib.h>'
+  echo '#include <string.h>'
+  for ((i = 0; i < n; ++i)); do
+    cat <<EOS
+struct S$i { int a, b; long c; char name[16]; };
+static int f$i(struct S$i *s, int n) {
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    if ((i & 3) == 0)
+      sum += s->a * i;
+    else
+      sum -= s->b >> 1;
+    s->c += sum;
+  }
+  switch (n % 4) {
+  case 0:  return sum + (int)s->c;
+  case 1:  return sum - s->a;
+  default: return (int)strlen(s->name) + sum;
+  }
+}
+EOS
+  done
+
+  echo 'static long dispatch(int op) {'
+  echo '  switch (op) {'
+  for ((i = 0; i < n; ++i)); do
+    echo "  case $i: { struct S$i s = {$i, $((i * 7)), 0, \"f$i\"}; return f$i(&s, $((i % 32))); }"
+  done
+  echo '  default: return 0;'
+  echo '  }'
+  echo '}'
+
+  echo 'static long check(const int *a, int len) {'
+  echo '  long r = 0;'
+  for ((i = 0; i < n; ++i)); do
+    echo "  if (a[$((i % 64))] > $i) r += $i; else r ^= $((i * 3));"
+    if ((i % 8 == 7)); then
+      echo "  for (int j = 0; j < len; ++j) r += a[j] * $i;"
+    fi
+  done
+  echo '  return r;'
+  echo '}'
+
+  echo 'int main(void) {'
+  echo '  int a[64];'
+  echo '  for (int i = 0; i < 64; ++i)'
+  echo '    a[i] = i * 37 % 101;'
+  echo '  long total = check(a, 64);'
+  echo "  for (int op = 0; op < $n; ++op)"
+  echo '    total += dispatch(op);'
+  echo '  printf("%ld\n", total);'
+  echo '  return 0;'
+  echo '}'
+}
+
+# Run cpp, cc1 and as separately over the sources and report the
+# throughput of each, measured in input lines.
+bench_tools() {
+  local name="$1"; shift
+  local cpp_lines=0 cc1_lines=0 as_lines=0
+  local cpp_ns=0 cc1_ns=0 as_ns=0
+  local src base t0 t1
+  for src in "$@"; do
+    base="$WORK/$(basename "${src%.c}")"
+    cpp_lines=$((cpp_lines + $(wc -l < "$src")))
+    t0=$(now_ns)
+    "$CPP" "${CPP_FLAGS[@]}" "${SRC_FLAGS[@]}" "$src" > "$base.i" || fail "cpp failed: $src"
+    t1=$(now_ns)
+    cpp_ns=$((cpp_ns + t1 - t0))
+
+    cc1_lines=$((cc1_lines + $(wc -l < "$base.i")))
+    t0=$(now_ns)
+    "$CC1" $BENCH_CFLAGS "$base.i" > "$base.s" || fail "cc1 failed: $src"
+    t1=$(now_ns)
+    cc1_ns=$((cc1_ns + t1 - t0))
+
+    as_lines=$((as_lines + $(wc -l < "$base.s")))
+    t0=$(now_ns)
+    "$AS" -o "$base.o" "$base.s" || fail "as failed: $src"
+    t1=$(now_ns)
+    as_ns=$((as_ns + t1 - t0))
+  done
+  report compile "cpp:$name" "$(lines_per_sec $cpp_lines $cpp_ns)" lines/s
+  report compile "cc1:$name" "$(lines_per_sec $cc1_lines $cc1_ns)" lines/s
+  report compile "as:$name" "$(lines_per_sec $as_lines $as_ns)" lines/s
+}
+
+bench_compile() {
+  gen_corpus "$BENCH_FUNCS" > "$WORK/corpus.c"
+  bench_tools corpus "$WORK/corpus.c"
+
+  # ld: throughput in source lines of the linked program.
+  local lines t0 t1
+  lines=$(wc -l < "$WORK/corpus.c")
+  t0=$(now_ns)
+  "$LD" -o "$WORK/corpus" "$WORK/corpus.o" "$ROOT/lib/crt0.a" "$ROOT/lib/libc.a" || fail 'ld failed'
+  t1=$(now_ns)
+  report compile ld:corpus "$(lines_per_sec $lines $((t1 - t0)))" lines/s
+  "$WORK/corpus" > /dev/null || fail 'corpus run failed'
+
+  local srcs=("$ROOT"/src/cc/*.c "$ROOT"/src/cc/arch/"$ARCHTYPE"/*.c "$ROOT"/src/cpp/*.c
+              "$ROOT"/src/as/*.c "$ROOT"/src/ld/*.c "$ROOT"/src/util/*.c
+              "$ROOT"/src/xcc/*.c)
+  bench_tools self "${srcs[@]}"
+}
+
+# Run a program compiled by xcc `repeat` times and report seconds per run.
+bench_run() {
+  local name="$1"; local repeat="$2"; local src="$3"; shift 3
+  local exe="$WORK/$name" t0 t1
+  "$XCC" -o "$exe" $BENCH_CFLAGS "$src" || fail "compile failed: $src"
+  t0=$(now_ns)
+  for ((i = 0; i < repeat; ++i)); do
+    (cd "$WORK" && "$exe" "$@" > /dev/null) || fail "run failed: $name"
+  done
+  t1=$(now_ns)
+  report run "$name" "$(awk -v ns=$((t1 - t0)) -v n="$repeat" 'BEGIN { printf "%.4f", ns / n / 1e9 }')" s
+}
+
+bench_runtime() {
+  bench_run fib 20 "$ROOT/examples/fib.c"
+  bench_run mandelbrot 1 "$ROOT/examples/mandelbrot.c"
+  bench_run sort 1 bench_sort.c 3
+  bench_run string 1 bench_string.c 10
+}
+
+printf 'kind\tname\tvalue\tunit\n' | tee "${BENCH_OUT:-/dev/null}"
+bench_compile
+bench_runtime
@@ -0,0 +1,89 @@
+// Benchmark: qsort and malloc stress
+//
+// Run:
+//   $ ./bench_sort [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int rand_state = 12345;
+
+static unsigned int next_rand(void) {
+  rand_state = rand_state * 1103515245U + 12345U;
+  return rand_state >> 8;
+}
+
+static int cmp_int(const void *pa, const void *pb) {
+  int a = *(const int*)pa, b = *(const int*)pb;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static int cmp_str(const void *pa, const void *pb) {
+  return strcmp(*(char**)pa, *(char**)pb);
+}
+
+#define BLOCKS  (1024)
+#define WORDS   (20000)
+
+static unsigned long sort_blocks(void) {
+  int *blocks[BLOCKS];
+  size_t sizes[BLOCKS];
+  for (int i = 0; i < BLOCKS; ++i) {
+    size_t n = 1 + next_rand() % 1000;
+    int *p = malloc(n * sizeof(*p));
+    for (size_t j = 0; j < n; ++j)
+      p[j] = next_rand();
+    blocks[i] = p;
+    sizes[i] = n;
+  }
+
+  unsigned long sum = 0;
+  for (int i = 0; i < BLOCKS; ++i) {
+    qsort(blocks[i], sizes[i], sizeof(int), cmp_int);
+    sum += blocks[i][sizes[i] / 2];
+  }
+
+  // Free in scattered order and reallocate to churn the heap.
+  for (int i = 0; i < BLOCKS; ++i) {
+    int k = next_rand() % BLOCKS;
+    free(blocks[k]);
+    sizes[k] = 1 + next_rand() % 64;
+    blocks[k] = malloc(sizes[k] * sizeof(int));
+    blocks[k][0] = i;
+    sum += blocks[k][0];
+  }
+  for (int i = 0; i < BLOCKS; ++i)
+    free(blocks[i]);
+  return sum;
+}
+
+static unsigned long sort_words(void) {
+  char **words = malloc(WORDS * sizeof(*words));
+  for (int i = 0; i < WORDS; ++i) {
+    int len = 1 + next_rand() % 12;
+    char *s = malloc(len + 1);
+    for (int j = 0; j < len; ++j)
+      s[j] = 'a' + next_rand() % 26;
+    s[len] = '\0';
+    words[i] = s;
+  }
+  qsort(words, WORDS, sizeof(*words), cmp_str);
+
+  unsigned long sum = 0;
+  for (int i = 0; i < WORDS; i += WORDS / 16)
+    sum += (unsigned char)words[i][0];
+  for (int i = 0; i < WORDS; ++i)
+    free(words[i]);
+  free(words);
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  unsigned long sum = 0;
+  for (int i = 0; i < rounds; ++i)
+    sum += sort_blocks() + sort_words();
+  printf("%lu\n", sum);
+  return 0;
+}
@@ -0,0 +1,119 @@
+// Benchmark: string processing kernel
+//
+// Builds a text, splits it into words, counts them in a hash table
+// and searches substrings.
+//
+// Run:
+//   $ ./bench_string [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *kVocabulary[] = {
+  "int", "char", "return", "while", "for", "struct", "static", "const",
+  "unsigned", "long", "void", "sizeof", "switch", "case", "break", "continue",
+  "identifier", "expression", "statement", "declaration", "preprocessor",
+  "optimization", "register", "allocation",
+};
+
+#define VOCABULARY_COUNT  (sizeof(kVocabulary) / sizeof(*kVocabulary))
+#define TEXT_WORDS        (200000)
+#define HASH_SIZE         (256)
+
+typedef struct Entry {
+  struct Entry *next;
+  const char *word;
+  size_t len;
+  int count;
+} Entry;
+
+static unsigned int hash_word(const char *s, size_t len) {
+  unsigned int h = 2166136261U;
+  for (size_t i = 0; i < len; ++i)
+    h = (h ^ (unsigned char)s[i]) * 16777619U;
+  return h;
+}
+
+static char *build_text(void) {
+  size_t size = TEXT_WORDS * 16, len = 0;
+  char *text = malloc(size);
+  unsigned int r = 1;
+  for (int i = 0; i < TEXT_WORDS; ++i) {
+    r = r * 1103515245U + 12345U;
+    const char *w = kVocabulary[(r >> 8) % VOCABULARY_COUNT];
+    size_t n = strlen(w);
+    memcpy(text + len, w, n);
+    len += n;
+    text[len++] = (r >> 20) % 8 == 0 ? '\n' : ' ';
+  }
+  text[len] = '\0';
+  return text;
+}
+
+static unsigned long count_words(const char *text) {
+  Entry *table[HASH_SIZE];
+  memset(table, 0, sizeof(table));
+  unsigned long distinct = 0;
+  for (const char *p = text; *p != '\0';) {
+    const char *q = strchr(p, ' ');
+    const char *nl = memchr(p, '\n', q != NULL ? (size_t)(q - p) : strlen(p));
+    if (nl != NULL)
+      q = nl;
+    size_t len = q != NULL ? (size_t)(q - p) : strlen(p);
+
+    Entry **pp = &table[hash_word(p, len) % HASH_SIZE], *e;
+    for (e = *pp; e != NULL; e = e->next) {
+      if (e->len == len && memcmp(e->word, p, len) == 0)
+        break;
+    }
+    if (e == NULL) {
+      e = malloc(sizeof(*e));
+      e->next = *pp;
+      e->word = p;
+      e->len = len;
+      e->count = 0;
+      *pp = e;
+      ++distinct;
+    }
+    ++e->count;
+
+    if (q == NULL)
+      break;
+    p = q + 1;
+  }
+
+  unsigned long sum = distinct;
+  for (int i = 0; i < HASH_SIZE; ++i) {
+    for (Entry *e = table[i], *next; e != NULL; e = next) {
+      next = e->next;
+      sum += e->count;
+      free(e);
+    }
+  }
+  return sum;
+}
+
+static unsigned long search_text(const char *text) {
+  static const char *kPatterns[] = {"optimization register", "static const", "for for", "xyz"};
+  unsigned long sum = 0;
+  for (size_t i = 0; i < sizeof(kPatterns) / sizeof(*kPatterns); ++i) {
+    for (const char *p = text; (p = strstr(p, kPatterns[i])) != NULL; ++p)
+      ++sum;
+  }
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  unsigned long sum = 0;
+  for (int i = 0; i < rounds; ++i) {
+    char *text = build_text();
+    char *copy = strdup(text);
+    sum += count_words(text) + search_text(copy) + (strcmp(text, copy) == 0);
+    free(copy);
+    free(text);
+  }
+  printf("%lu\n", sum);
+  return 0;
+}
@@ -34,10 +34,11 @@ try_run() {
   local expected
   expected=$(echo -e "$2")
   local input="$3"
+  local opts="$4"
 
   begin_test "$title"
 
-  echo -e "$input" | $XCC -o "$AOUT" -Werror -xc -I. -Itmp_include - || exit 1
+  echo -e "$input" | $XCC -o "$AOUT" -Werror -xc -I. -Itmp_include $opts - || exit 1
 
   $RUN_AOUT
   local actual="$?"
@@ -59,6 +60,20 @@ pp_error() {
   end_test "$err"
 }
 
+compile_error() {
+  local title="$1"
+  local input="$2"
+  local opts="$3"
+
+  begin_test "$title"
+
+  echo -e "$input" | $XCC -o "$AOUT" -xc -I. -Itmp_include $opts - > /dev/null 2>&1
+  local result="$?"
+
+  local err=''; [[ "$result" -ne 0 ]] || err="Compile error expected, but succeeded"
+  end_test "$err"
+}
+
 test_misc() {
   begin_test_suite "Misc"
 
@@ -112,6 +127,8 @@ test_misc() {
   try 'recursive macro in expr' 'false' "#define SELF SELF\n#if SELF\ntrue\n#else\nfalse\n#endif"
   try 'Nested' 'H(987)' "#define F(x) C(G(x))\n#define G(x) C(H(x))\n#define C(x) x\nF(987)"
   try 'recursive in arg' 'SELF' "#define I(v)  v\n#define SELF  I(SELF)\nSELF"
+  try 'mutual recursion' 'AA BB' "#define AA BB\n#define BB AA\nAA BB"
+  try 'X macro' 'int a; int b; int c;' "#define LIST X(a) X(b) X(c)\n#define X(n) int n;\nLIST"
   try 'Empty arg' '"" ""' "#define F(x, y) #x #y\nF(  ,  )"
   try 'vaarg' '1 2 (3, 4, 5)' "#define VAARG(x, y, ...)  x y (__VA_ARGS__)\nVAARG(1, 2, 3, 4, 5)"
   try 'no vaarg' '1 2 ()' "#define VAARG(x, y, ...)  x y (__VA_ARGS__)\nVAARG(1, 2)"
@@ -193,6 +210,22 @@ test_run() {
   echo -e "#include_next <tmp.h>\n#define FOO (29)" > tmp.h
   try_run "Include with include_next" 42 "#include <tmp.h>\nint main(){return FOO+BAR;}"
 
+  echo -e "/* guard */\n#ifndef TMP_H\n#define TMP_H\nx += 1;\n#endif // TMP_H" > tmp.h
+  try_run 'Include guard' 2 "int main(){int x = 0;\n#include \"tmp.h\"\n#include \"tmp.h\"\n#undef TMP_H\n#include \"tmp.h\"\nreturn x;}"
+  echo -e "#ifndef TMP_H\n#define TMP_H\n#endif\nx += 1;" > tmp.h
+  try_run 'Token after guard' 2 "int main(){int x = 0;\n#include \"tmp.h\"\n#include \"tmp.h\"\nreturn x;}"
+  echo -e "#ifndef TMP_H\n#define TMP_H\n#else\nx += 1;\n#endif" > tmp.h
+  try_run 'Guard with else' 1 "int main(){int x = 0;\n#include \"tmp.h\"\n#include \"tmp.h\"\nreturn x;}"
+
+  echo -e "#ifndef TMP_H\n#define TMP_H\n#define ADD(x, y)  ((x) + (y))\n#define STR(x)  #x\nstatic int twice(int x) {return x * 2;}\n#endif" > tmp.h
+  $XCC -I. -Itmp_include -emit-pch tmp.pch tmp.h || exit 1
+  try_run 'Precompiled header' 42 "#include \"tmp.h\"\nint main(){return ADD(twice(sizeof(STR(abc))), 34);}" '-include-pch tmp.pch'
+  compile_error 'Precompiled header with different options' 'int main(){return 0;}' '-DFOO -include-pch tmp.pch'
+
+  echo -e "#ifndef TMP_H\n#define TMP_H\n#undef FOO\n#endif" > tmp.h
+  $XCC -I. -Itmp_include -DFOO -emit-pch tmp.pch tmp.h || exit 1
+  try_run 'Precompiled header with undef' 2 "#ifdef FOO\nint main(){return 1;}\n#else\nint main(){return 2;}\n#endif" '-DFOO -include-pch tmp.pch'
+
   end_test_suite
 }
 
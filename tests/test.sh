@@ -152,6 +152,7 @@ test_function() {
   compile_error 'return non-void' 'int main(){ return; }'
   compile_error 'no return' 'int sub(){} int main(){return 0;}'
   try_direct 'no return in main' 0 'int main(){}'
+  try_direct 'same name as builtin' 43 'static int ceil(int a, int b){return (a + b - 1) / b;} long fabs(long x){return x < 0 ? -x : x;} int main(){return ceil(7, 2) * 10 + (int)fabs(-3L);}'
   compile_error 'funparam static' 'void main(static int argc){}'
   compile_error 'funparam extern' 'void main(extern int argc){}'
   compile_error 'duplicate func' 'void main(){} void main(){}'
@@ -253,12 +254,65 @@ test_error() {
   end_test_suite
 }
 
+test_driver() {
+  begin_test_suite "Driver"
+
+  echo -e "int sub1(int x){return x * 2;}" > tmp_sub1.c
+  echo -e "int sub2(int x){return x + 3;}" > tmp_sub2.c
+  echo -e "int sub1(int); int sub2(int);\nint main(){return sub1(sub2(18));}" > tmp_main.c
+  echo -e "int sub3(int x){return x +;}" > tmp_err.c
+
+  begin_test '-j link'
+  local err=''
+  rm -f "$AOUT"
+  if eval $XCC -j 2 -o "$AOUT" tmp_sub1.c tmp_main.c tmp_sub2.c $SILENT; then
+    $RUN_AOUT
+    local actual="$?"
+    [[ "$actual" == 42 ]] || err="42 expected, but ${actual}"
+  else
+    err='Compile failed'
+  fi
+  end_test "$err"
+
+  begin_test '-j objects'
+  err=''
+  rm -f "$AOUT" tmp_sub1.o tmp_sub2.o tmp_main.o
+  if eval $XCC -j 2 -c tmp_sub1.c tmp_sub2.c tmp_main.c $SILENT &&
+     eval $XCC -o "$AOUT" tmp_main.o tmp_sub1.o tmp_sub2.o $SILENT; then
+    $RUN_AOUT
+    local actual="$?"
+    [[ "$actual" == 42 ]] || err="42 expected, but ${actual}"
+  else
+    err='Compile failed'
+  fi
+  end_test "$err"
+
+  begin_test '-j error'
+  err=''
+  rm -f "$AOUT"
+  if eval $XCC -j 2 -o "$AOUT" tmp_sub1.c tmp_err.c tmp_sub2.c tmp_main.c $SILENT; then
+    err='Compile error expected, but succeeded'
+  elif [[ -e "$AOUT" ]]; then
+    err='Linked despite the error'
+  fi
+  end_test "$err"
+
+  begin_test '-j error in object'
+  err=''
+  eval $XCC -j 2 -c tmp_err.c tmp_sub1.c tmp_sub2.c $SILENT && err='Compile error expected, but succeeded'
+  end_test "$err"
+
+  rm -f tmp_sub1.c tmp_sub2.c tmp_main.c tmp_err.c tmp_sub1.o tmp_sub2.o tmp_main.o tmp_err.o
+  end_test_suite
+}
+
 test_basic
 test_struct
 test_bitfield
 test_initializer
 test_function
 test_error
+test_driver
 
 if [[ $FAILED_SUITE_COUNT -ne 0 ]]; then
   exit $FAILED_SUITE_COUNT
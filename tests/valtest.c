@@ -1216,6 +1216,23 @@ TEST(struct) {
     EXPECT("struct copy", 51, x.x);
   }
 
+  {
+    typedef struct {char a[3]; int b[25]; char c[5];} S;
+    S s, x;
+    for (int i = 0; i < 25; ++i)
+      s.b[i] = i;
+    s.a[2] = 11;
+    s.c[4] = 22;
+    x = s;
+    EXPECT("large struct copy", 339, x.a[2] + x.b[24] * 10 + x.c[4] * 4);
+
+    S z = {{1}};
+    int sum = z.a[1] + z.a[2] + z.c[4];
+    for (int i = 0; i < 25; ++i)
+      sum += z.b[i];
+    EXPECT("large struct clear", 0, sum);
+  }
+
   {
     struct empty {};
     EXPECT("empty struct size", 0, sizeof(struct empty));
@@ -1617,9 +1634,15 @@ void empty_function(void){}
 int more_params(int a, int b, int c, int d, int e, int f, char g, int h) { return a + b + c + d + e + f + g + h; }
 typedef struct {int x;} MoreParamsReturnsStruct;
 MoreParamsReturnsStruct more_params_returns_struct(int a, int b, int c, int d, int e, int f, int g) { return (MoreParamsReturnsStruct){f + g}; }
+int unused_param(int a, int b, const char *unused, int c) { return a == 2 ? b * 10 + c : -1; }
+int loop_at_entry(int x, int n) { for (;;) { if (n <= 0) return x; x = x * 3 + 1; --n; } }
 int array_arg_wo_size(int arg[]) { return arg[1]; }
 long long long_immediate(unsigned long long x) { return x / 11; }
 static inline int inline_func(void) { return 93; }
+static inline int inline_abs(int x) { if (x < 0) return -x; return x; }
+static inline int inline_loop(int n) { int s = 0; for (int i = 0; i < n; ++i) s += inline_abs(i - 3); return s; }
+static inline int inline_ref(int x) { int *p = &x; *p += 1; return x; }
+static inline int inline_recur(int n) { return n <= 1 ? 1 : n * inline_recur(n - 1); }
 
 int mul2(int x) {return x * 2;}
 int div2(int x) {return x / 2;}
@@ -1654,6 +1677,8 @@ int 漢字(int χ) { return χ * χ; }
 TEST(function) {
   empty_function();
   EXPECT("more params", 36, more_params(1, 2, 3, 4, 5, 6, 7, 8));
+  EXPECT("unused param", 34, unused_param(2, 3, "x", 4));
+  EXPECT("loop at entry", 67, loop_at_entry(2, 3));
   {
     MoreParamsReturnsStruct s = more_params_returns_struct(11, 22, 33, 44, 55, 66, 77);
     EXPECT("more params w/ struct", 143, s.x);
@@ -1691,6 +1716,10 @@ TEST(function) {
 
   EXPECT("long immediate", 119251678860344574LL, long_immediate(0x123456789abcdef0));
   EXPECT("inline", 93, inline_func());
+  EXPECT("inline multiple return", 5, inline_abs(-5) * inline_abs(1));
+  EXPECT("inline nested", 12, inline_loop(7));
+  EXPECT("inline param ref", 43, inline_ref(42));
+  EXPECT("inline recursive", 120, inline_recur(5));
   EXPECT("const typedef-ed type", 65, const_typedefed(66));
 
   EXPECT("stdarg", 55, vaarg_and_array(10, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
@@ -1709,6 +1738,110 @@ int extern_array_wo_size[] = {11, 22, 33};
 
 //
 
+long loop_sum_ints(const int *a, int n) { long s = 0; for (int i = 0; i < n; ++i) s += a[i]; return s; }
+int loop_sum_shorts_down(const short *a, int n) { int s = 0; for (int i = n; --i >= 0; ) s += a[i] * (i + 1); return s; }
+int loop_stride(const char *p, int n) { int h = 0; for (int i = 0; i != n; i += 3) h = h * 31 + p[i]; return h; }
+int loop_index_after(const int *a, int n) { int i; for (i = 0; i < n; ++i) if (a[i] < 0) break; return i; }
+int loop_unsigned(const int *a, unsigned n) { int s = 0; for (unsigned i = 0; i < n; ++i) s += a[i]; return s; }
+int loop_nested(const int a[][4], int n) { int s = 0; for (int i = 0; i < n; ++i) for (int j = 0; j < 4; ++j) s += a[i][j] * (j - i); return s; }
+int loop_invariant(const int *a, int n, int x, int y) { int s = 0; for (int i = 0; i < n; ++i) s += a[i] * (x * y + 1); return s; }
+int loop_invariant_div(int n, int x, int d) { int s = 0; for (int i = 0; i < n; ++i) if (d != 0) s += x / d; else s += i; return s; }
+int loop_irreducible(int n) { int s = 0; if (n & 1) goto inside; while (n > 0) { s += n; inside: s += 2; --n; } return s; }
+int loop_latches(const int *a, int n) { int s = 0, i = 0; while (i < n) { if (a[i] & 1) { ++i; continue; } s += a[i++]; } return s; }
+long loop_same_elem(const int *a, int n, long k1, long k2, long k3) { long s = 0; for (int i = 0; i < n; ++i) s += a[i] * k1 + (a[i] ^ k2) + (a[i] & k3); return s; }
+
+TEST(loop) {
+  int a[10], b[3][4];
+  short c[8];
+  for (int i = 0; i < 10; ++i)
+    a[i] = i * i - 3;
+  for (int i = 0; i < 8; ++i)
+    c[i] = 10 - i;
+  for (int i = 0; i < 12; ++i)
+    b[i / 4][i % 4] = i;
+
+  EXPECT("strength reduction", 255, loop_sum_ints(a, 10));
+  EXPECT("strength reduction, no iteration", 0, loop_sum_ints(NULL, 0));
+  EXPECT("strength reduction, negative count", 0, loop_sum_ints(NULL, -5));
+  EXPECT("strength reduction, count down", 192, loop_sum_shorts_down(c, 8));
+  EXPECT("strength reduction, stride", 2989126, loop_stride("abcdefghijkl", 12));
+  EXPECT("induction variable used after loop", 0, loop_index_after(a, 10));
+  EXPECT("induction variable used after loop 2", 8, loop_index_after(a + 2, 8));
+  EXPECT("unsigned induction variable", 255, loop_unsigned(a, 10));
+  EXPECT("nested loop", 16, loop_nested(b, 3));
+  EXPECT("loop invariant", 3315, loop_invariant(a, 10, 3, 4));
+  EXPECT("loop invariant division", 15, loop_invariant_div(5, 10, 3));
+  EXPECT("loop invariant division by zero", 10, loop_invariant_div(5, 10, 0));
+  EXPECT("irreducible loop", 20, loop_irreducible(5));
+  EXPECT("irreducible loop 2", 18, loop_irreducible(4));
+  EXPECT("multiple latches", 150, loop_latches(a, 10));
+  EXPECT("same element", 1038, loop_same_elem(a, 10, 3, 5, 6));
+} END_TEST()
+
+// Values outnumber the registers, and spilled ones share the stack slots.
+long spill_share(long x) {
+  long a0 = x + 1, a1 = x * 3, a2 = x ^ 5, a3 = x - 7, a4 = x << 2, a5 = x | 9, a6 = x * x, a7 = x + 11, a8 = x & 13, a9 = x - 15;
+  long s = a0 * a9 + a1 * a8 + a2 * a7 + a3 * a6 + a4 * a5 + a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9;
+  long b0 = s + 2, b1 = s * 5, b2 = s ^ 6, b3 = s - 8, b4 = s << 1, b5 = s | 10, b6 = s * 3, b7 = s + 12, b8 = s & 14, b9 = s - 16;
+  return b0 * b9 + b1 * b8 + b2 * b7 + b3 * b6 + b4 * b5 + b0 + b1 + b2 + b3 + b4 + b5 + b6 + b7 + b8 + b9;
+}
+
+// Reloaded value is reused in the block until it is overwritten.
+long spill_reload(long *p, long x) {
+  long a0 = p[0] + x, a1 = p[1] * x, a2 = p[2] ^ x, a3 = p[3] - x, a4 = p[4] + 1, a5 = p[5] * 3, a6 = p[6] ^ 7, a7 = p[7] - 9;
+  long v = a0 + a7;
+  long t = v * a1 + v * a2 + v * a3;
+  v = v * 3 + a4;
+  t += v * a5 + v * a6 + v;
+  return t + a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7 + v;
+}
+
+// Value from the outer scope is spilled before the loop, but kept in a register in it.
+long spill_split_loop(const long *p, int n) {
+  long k = p[0] * 3 + 1;
+  long a0 = p[1], a1 = p[2], a2 = p[3], a3 = p[4], a4 = p[5], a5 = p[6], a6 = p[7];
+  for (int j = 0; j < 3; ++j) {
+    a0 = a0 * a1 + a2; a1 = a1 ^ a3; a2 = a2 + a4 * a5; a3 = a3 - a6;
+    a4 = a4 + a0; a5 = a5 * 3 + a1; a6 = a6 ^ a2;
+  }
+  long t = a0 * a1 + a2 * a3 + a4 * a5 + a6;
+  long s = 0;
+  for (int i = 0; i < n; ++i) {
+    s = s * k + (p[i] ^ k);
+    if (s > 1000000)
+      s -= k * 7;
+  }
+  return s + t + k;
+}
+
+// Accumulator is kept in a register in the loop, and stored at the exit.
+long spill_split_store(const long *p, int n) {
+  long q = p[0];
+  for (int i = 0; i < n; ++i)
+    q = q * 3 + (p[i] ^ 5);
+  long a0 = p[1], a1 = p[2], a2 = p[3], a3 = p[4], a4 = p[5], a5 = p[6], a6 = p[7];
+  for (int j = 0; j < 3; ++j) {
+    a0 = a0 * a1 + a2; a1 = a1 ^ a3; a2 = a2 + a4 * a5; a3 = a3 - a6;
+    a4 = a4 + a0; a5 = a5 * 3 + a1; a6 = a6 ^ a2;
+  }
+  return q + a0 * a1 + a2 * a3 + a4 * a5 + a6;
+}
+
+TEST(spill) {
+  long p[10] = {3, -4, 5, 100, -7, 8, 9, 1000, 11, -12};
+
+  EXPECT("share slots", 2849239, spill_share(7));
+  EXPECT("share slots 2", -1646513472261046102L, spill_share(-123456));
+  EXPECT("reuse reloaded", 180751, spill_reload(p, 11));
+  EXPECT("reuse reloaded 2", 225847, spill_reload(p, -3));
+  EXPECT("split at loop", 8455113080L, spill_split_loop(p, 10));
+  EXPECT("split at loop, no iteration", 196368442, spill_split_loop(p, 0));
+  EXPECT("split at loop, store", 196697940, spill_split_store(p, 10));
+  EXPECT("split at loop, store, no iteration", 196368435, spill_split_store(p, 0));
+} END_TEST()
+
+//
+
 int main(void) {
   return RUN_ALL_TESTS(
     test_all,
@@ -1717,5 +1850,7 @@ int main(void) {
     test_bitfield,
     test_initializer,
     test_function,
+    test_loop,
+    test_spill,
   );
 }